@@ -0,0 +1,65 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <stdint.h>
+#include "command_queue.h"
+
+// Light transport backends (wiz_backend.h, hue_backend.h, loopback_backend.h).
+//
+// lights.cpp owns everything that is the same for every kind of light:
+// the command queue, coalescing, the acked-state cache and liveness. A
+// backend only puts commands on the wire and hands back replies. Each one
+// is a concrete class deriving from LightBackend<Self> and providing:
+//
+//   void begin();
+//   bool send(int bulb, uint32_t id, const PilotCommand& cmd);  // false = not sent
+//   bool probe(int bulb, uint32_t id);                          // Ask for the current state
+//   void endBatch();                                            // Transmit anything send() buffered
+//   bool poll(BackendReply* reply);                             // Next reply, false when none left
+//
+// lights.cpp switches on Bulb::backend and calls the concrete type, so the
+// per-command path has no virtual calls.
+// Header-only and Arduino-free so host tools can use it.
+
+enum BackendKind : uint8_t {
+  BACKEND_WIZ = 0,   // WiZ UDP JSON (default for bulbs in secrets.h)
+  BACKEND_LOOPBACK,  // In-memory, see loopback_backend.h
+  BACKEND_HUE,       // Hue bridge over HTTP, see hue_backend.h
+  BACKEND_KIND_COUNT
+};
+
+struct BackendReply {
+  int bulb;
+  bool hasId;    // False if the reply does not say which command it answers
+  uint32_t id;
+  bool success;  // Command was applied (replies to probes are never matched)
+  PilotCommand state;  // State a probe reply reported (fields = 0 if none)
+};
+
+struct BatchEntry {
+  int bulb;
+  uint32_t id;
+  PilotCommand cmd;
+  bool sent;  // Set by sendBatch()
+};
+
+template <typename Derived>
+class LightBackend {
+ public:
+  // Send every entry of one loop pass, then let the backend flush; returns
+  // the number sent
+  int sendBatch(BatchEntry* entries, int count) {
+    Derived& self = static_cast<Derived&>(*this);
+    int sent = 0;
+    for (int i = 0; i < count; i++) {
+      entries[i].sent = self.send(entries[i].bulb, entries[i].id, entries[i].cmd);
+      if (entries[i].sent) sent++;
+    }
+    self.endBatch();
+    return sent;
+  }
+
+  void endBatch() {}  // Default: send() transmits immediately
+};
+
+#endif
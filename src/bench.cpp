@@ -0,0 +1,158 @@
+#include <Arduino.h>
+#include "bench.h"
+#include "brightness_predictor.h"
+#include "command_queue.h"
+#include "dimmer.h"
+#include "event_bus.h"
+#include "histogram.h"
+#include "lights.h"
+#include "rules_vm.h"
+#include "timer_wheel.h"
+#include "wiz_json.h"
+#include "zones.h"
+
+static uint32_t samples[BENCH_ITERATIONS];
+
+static void sortSamples() {
+  for (int i = 1; i < BENCH_ITERATIONS; i++) {
+    uint32_t v = samples[i];
+    int j = i - 1;
+    while (j >= 0 && samples[j] > v) {
+      samples[j + 1] = samples[j];
+      j--;
+    }
+    samples[j + 1] = v;
+  }
+}
+
+template <typename Fn>
+static void runCase(const char* name, Fn fn) {
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    uint32_t start = ESP.getCycleCount();
+    fn(i);
+    samples[i] = ESP.getCycleCount() - start;
+  }
+  sortSamples();
+  Serial.printf("BENCH %s min=%u med=%u\n", name, samples[0], samples[BENCH_ITERATIONS / 2]);
+}
+
+void benchRun() {
+  static CommandQueue<BULB_COUNT> queue;
+  runCase("queue_push_pop", [](int i) {
+    PilotCommand cmd = {};
+    cmd.fields = PILOT_DIMMING;
+    cmd.dimming = (uint8_t)(10 + i % 90);
+    queue.push(i % BULB_COUNT, cmd, PRIORITY_STREAM);
+    int bulb;
+    queue.pop(0, 0, &bulb, &cmd);
+  });
+
+  static char json[160];
+  runCase("wiz_format", [](int i) {
+    PilotCommand cmd = {};
+    cmd.fields = PILOT_DIMMING | PILOT_TEMP;
+    cmd.dimming = (uint8_t)(10 + i % 90);
+    cmd.temp = 2700;
+    wizFormatPilot(json, sizeof(json), cmd);
+  });
+
+  runCase("wiz_parse_reply", [](int i) {
+    static const char* reply =
+      "{\"method\":\"getPilot\",\"env\":\"pro\",\"result\":{\"mac\":\"a8bb50000000\","
+      "\"rssi\":-60,\"state\":true,\"sceneId\":0,\"temp\":2700,\"dimming\":50}}";
+    PilotCommand state;
+    wizParsePilot(reply, &state);
+  });
+
+  static BrightnessPredictor predictor(MIN_BRIGHTNESS, MAX_BRIGHTNESS, BRIGHTNESS_STEP);
+  runCase("predictor_update", [](int i) {
+    predictor.update((unsigned long)i * 8, MIN_BRIGHTNESS + (i % 40) * BRIGHTNESS_STEP);
+  });
+
+  static LatencyHistogram hist;
+  runCase("hist_record", [](int i) {
+    hist.record((uint32_t)i * 97);
+  });
+
+  // "when click study if time >= 22:00 || time < 6:00 do temp 2200" with
+  // the clock unset, as a fixed program so runs stay comparable
+  static const uint8_t rules[] = {
+    0x57, 0x5a, 0x52, 0x31, 0x00, 0x00, 1,
+    RULE_EVENT_CLICK, RULE_BUTTON_STUDY, 21,
+    RULE_OP_VAR, RULE_VAR_TIME, 0, RULE_OP_PUSH, 0x28, 0x05, RULE_OP_GE,
+    RULE_OP_VAR, RULE_VAR_TIME, 0, RULE_OP_PUSH, 0x68, 0x01, RULE_OP_LT, RULE_OP_OR,
+    RULE_OP_JUMP_IF_FALSE, 4, RULE_OP_PUSH, 0x98, 0x08, RULE_OP_TEMP,
+  };
+  struct BenchEnv {
+    int32_t var(RuleVar v, uint8_t bulb) { return -1; }
+    void action(RuleOp op, uint8_t bulb, int32_t value) {}
+  };
+  runCase("rules_run", [](int i) {
+    BenchEnv env;
+    rulesRun(rules, sizeof(rules), RULE_EVENT_CLICK, RULE_BUTTON_STUDY, env);
+  });
+
+  // Two subscribers without wake-ups, drained every call so nothing drops
+  static EventBus<2, 32> bus;
+  static int ids[2] = {bus.subscribe(EVENT_ALL_TYPES, NULL, NULL), bus.subscribe(eventMask(EVENT_BRIGHTNESS), NULL, NULL)};
+  runCase("event_publish", [](int i) {
+    bus.publish(EVENT_BRIGHTNESS, 3, (int16_t)(MIN_BRIGHTNESS + i % 90), (uint32_t)i);
+    BusEvent e;
+    bus.poll(ids[0], &e);
+    bus.poll(ids[1], &e);
+  });
+
+  // Restarting a timer, as every encoder detent does to the usage settle timer
+  static TimerWheel wheel;
+  static WheelTimer timer([](void*) {});
+  runCase("timer_restart", [](int i) {
+    wheel.start(&timer, (uint32_t)i, 2000);
+  });
+
+  // The loop's pass over the knobs with one and four encoders. The rows are
+  // copies sharing the first encoder, so the live zones keep their counts;
+  // reading one PCNT unit costs the same as reading another.
+  static Zone scratch[ZONE_MAX];
+  for (int z = 0; z < ZONE_MAX; z++) scratch[z] = zones[0];
+  runCase("zones_scan_1", [](int i) {
+    zonesScan(scratch, 1);
+  });
+  runCase("zones_scan_4", [](int i) {
+    zonesScan(scratch, ZONE_MAX);
+  });
+
+  runCase("lights_poll_idle", [](int i) {
+    lightsPoll();
+  });
+
+  // Encoder step to packet, through the real queue and backend. The QEMU
+  // build sends to the bulbfarm behind qemu_bridge; on hardware the study
+  // lamp is switched to the loopback backend for the run, so the real lamp
+  // gets nothing. Streams only go to a light that is on and alive, and only
+  // every push reaches the wire with no send interval, so all three are
+  // forced for the run and the bulb's state is put back afterwards.
+  Bulb saved = bulbs[BULB_STUDY];
+  uint32_t savedInterval = brightnessIntervalMs;
+  brightnessIntervalMs = 0;
+  bulbs[BULB_STUDY].alive = true;
+#ifndef QEMU_TARGET
+  bulbs[BULB_STUDY].backend = BACKEND_LOOPBACK;
+#endif
+  sendLightCommand(BULB_STUDY, true, MIN_BRIGHTNESS);
+  lightsFlush();
+#ifdef QEMU_TARGET
+  runCase("stream_to_packet", [](int i) {
+#else
+  runCase("stream_to_loopback", [](int i) {
+#endif
+    streamLightBrightness(BULB_STUDY, MIN_BRIGHTNESS + (i % 2) * BRIGHTNESS_STEP);
+    lightsFlush();
+  });
+  sendLightCommand(BULB_STUDY, saved.desiredOn, saved.desiredDimming);
+  lightsFlush();
+  lightsPoll();
+  bulbs[BULB_STUDY] = saved;
+  brightnessIntervalMs = savedInterval;
+
+  Serial.println("BENCH done");
+}
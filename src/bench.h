@@ -0,0 +1,18 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Cycle-count microbenchmarks of the controller's hot path (bench.cpp).
+// Console "bench" runs them; BENCH_AT_BOOT builds run them at the end of
+// setup(). Each case runs BENCH_ITERATIONS times and prints one line
+//
+//   BENCH <case> min=<cycles> med=<cycles>
+//
+// followed by "BENCH done", so tools/qemu_run.sh can collect and compare
+// them. Under QEMU the cycle counter follows the emulated instruction
+// stream: good for spotting regressions, not for absolute timings.
+
+const int BENCH_ITERATIONS = 101;
+
+void benchRun();
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef BRIGHTNESS_PREDICTOR_H
+#define BRIGHTNESS_PREDICTOR_H
+
+#include <stdint.h>
+
+// Guesses where a fast encoder spin will stop, so the bulbs can be sent
+// there early instead of trailing the knob by a send interval or two.
+//
+// update() is called with each new brightness and returns the level to
+// send. From the last five changes it estimates velocity (over the older
+// and the newer half) and deceleration; until five have arrived in the
+// current spin it returns the position unchanged. While the knob slows
+// down the target is the point where it would stop (v^2 / 2a ahead),
+// otherwise the position horizonMs ahead. The lead is capped at maxLead
+// and only used while the knob is moving faster than minSpeed. Once no
+// change has arrived for settleMs, correction() returns the real position
+// if the last target was anything else.
+// Header-only and Arduino-free so tools/predict_sim.cpp can replay spins.
+
+class BrightnessPredictor {
+ public:
+  float horizonMs;
+  float minSpeed;     // Brightness points per ms below which nothing is predicted
+  int maxLead;        // Brightness points
+  unsigned long settleMs;
+
+  BrightnessPredictor(int minLevel, int maxLevel, int step)
+    : horizonMs(100), minSpeed(0.05f), maxLead(20), settleMs(50),
+      minLevel_(minLevel), maxLevel_(maxLevel), step_(step), count_(0), lastTarget_(-1),
+      lastPosition_(0), lastChange_(0) {}
+
+  int update(unsigned long now, int position) {
+    if (count_ > 0 && now - times_[count_ - 1] > settleMs) count_ = 0;  // New spin
+    if (count_ == HISTORY) {
+      for (int i = 1; i < HISTORY; i++) {
+        times_[i - 1] = times_[i];
+        positions_[i - 1] = positions_[i];
+      }
+      count_--;
+    }
+    times_[count_] = now;
+    positions_[count_] = position;
+    count_++;
+    lastPosition_ = position;
+    lastChange_ = now;
+
+    lastTarget_ = predict(position);
+    return lastTarget_;
+  }
+
+  // Real position to send once the knob has stopped, if the last target was a guess
+  bool correction(unsigned long now, int* level) {
+    if (lastTarget_ < 0 || now - lastChange_ < settleMs) return false;
+    bool wrong = lastTarget_ != lastPosition_;
+    lastTarget_ = -1;
+    count_ = 0;
+    if (wrong) *level = lastPosition_;
+    return wrong;
+  }
+
+ private:
+  static const int HISTORY = 5;
+
+  int predict(int position) const {
+    if (count_ < HISTORY) return position;
+
+    // Velocity over the older and newer half of the history
+    const int mid = HISTORY / 2;
+    float dt1 = (float)(times_[mid] - times_[0]);
+    float dt2 = (float)(times_[HISTORY - 1] - times_[mid]);
+    if (dt1 <= 0 || dt2 <= 0) return position;
+    float v1 = (positions_[mid] - positions_[0]) / dt1;
+    float v2 = (positions_[HISTORY - 1] - positions_[mid]) / dt2;
+    if ((v2 > 0 ? v2 : -v2) < minSpeed || v1 * v2 <= 0) return position;  // Slow or reversing
+
+    float lead = v2 * horizonMs;
+    float accel = (v2 - v1) / ((dt1 + dt2) / 2);
+    if (accel * v2 < 0) {
+      float stop = v2 * v2 / (2 * (accel > 0 ? accel : -accel));  // Distance left until it stops
+      if (stop < (lead > 0 ? lead : -lead)) lead = v2 > 0 ? stop : -stop;
+    }
+    if (lead > maxLead) lead = (float)maxLead;
+    if (lead < -maxLead) lead = (float)-maxLead;
+
+    int steps = (int)(lead / step_);  // Round toward the knob: overshoot costs a correction
+    int target = position + steps * step_;
+    return target < minLevel_ ? minLevel_ : target > maxLevel_ ? maxLevel_ : target;
+  }
+
+  int minLevel_;
+  int maxLevel_;
+  int step_;
+  unsigned long times_[HISTORY];
+  int positions_[HISTORY];
+  int count_;
+  int lastTarget_;     // -1 = nothing predicted since the last correction
+  int lastPosition_;
+  unsigned long lastChange_;
+};
+
+#endif
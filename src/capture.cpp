@@ -0,0 +1,249 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+#include "capture.h"
+#include "capture_codec.h"
+#include "lights.h"
+#include "scheduler.h"
+#include "wiz_backend.h"
+
+// Ring entries are a CaptureEntry followed by the payload and may wrap
+// around the end of the buffer. head and tail are free-running byte
+// counts, so head - tail is the space in use.
+struct CaptureEntry {
+  int64_t us;      // esp_timer_get_time(): microseconds since boot
+  uint16_t len;    // Payload bytes stored
+  uint8_t bulb;
+  uint8_t dir;     // CaptureDirection
+};
+
+const uint32_t CAPTURE_MIN_UNIX_TIME = 1600000000;  // Anything earlier means NTP has not synced
+const size_t CAPTURE_HEX_LINE_BYTES = 32;
+
+enum FlushTarget : uint8_t {
+  FLUSH_NONE,
+  FLUSH_SERIAL,
+  FLUSH_UDP,
+};
+
+bool captureEnabled = false;
+
+static uint8_t ring[CAPTURE_RING_BYTES];
+static uint32_t head = 0;
+static uint32_t tail = 0;
+static uint32_t entries = 0;
+static uint32_t overwritten = 0;
+static uint32_t truncated = 0;
+
+static FlushTarget flushTarget = FLUSH_NONE;
+static bool resumeAfterFlush = false;
+static uint32_t flushPos = 0;       // Next ring entry to write out
+static bool flushHeaderDone = false;
+static int64_t flushClockOffsetUs = 0;
+static uint8_t flushLocalIp[4];
+static uint16_t flushIpId = 0;
+static uint8_t flushBuf[CAPTURE_DATAGRAM_MAX];
+static size_t flushLen = 0;
+static size_t flushOut = 0;         // flushBuf bytes already written out
+static uint32_t flushRecords = 0;
+static uint32_t flushBytes = 0;
+static WiFiUDP flushUdp;
+static IPAddress flushTo;
+static uint16_t flushPort = 0;
+
+static void ringWrite(uint32_t pos, const void* data, size_t len) {
+  size_t at = pos & (CAPTURE_RING_BYTES - 1);
+  size_t first = len < CAPTURE_RING_BYTES - at ? len : CAPTURE_RING_BYTES - at;
+  memcpy(ring + at, data, first);
+  memcpy(ring, (const uint8_t*)data + first, len - first);
+}
+
+static void ringRead(uint32_t pos, void* data, size_t len) {
+  size_t at = pos & (CAPTURE_RING_BYTES - 1);
+  size_t first = len < CAPTURE_RING_BYTES - at ? len : CAPTURE_RING_BYTES - at;
+  memcpy(data, ring + at, first);
+  memcpy((uint8_t*)data + first, ring, len - first);
+}
+
+void captureRecordPacket(int bulb, CaptureDirection dir, const uint8_t* data, size_t len) {
+  if (len > CAPTURE_SNAP_LEN) {
+    len = CAPTURE_SNAP_LEN;
+    truncated++;
+  }
+  CaptureEntry e = {esp_timer_get_time(), (uint16_t)len, (uint8_t)bulb, (uint8_t)dir};
+  size_t need = sizeof(e) + len;
+
+  // Make room by dropping the oldest packets
+  while (CAPTURE_RING_BYTES - (head - tail) < need) {
+    CaptureEntry old;
+    ringRead(tail, &old, sizeof(old));
+    tail += sizeof(old) + old.len;
+    entries--;
+    overwritten++;
+  }
+  ringWrite(head, &e, sizeof(e));
+  ringWrite(head + sizeof(e), data, len);
+  head += need;
+  entries++;
+}
+
+void captureStart() {
+  if (flushTarget != FLUSH_NONE) {
+    resumeAfterFlush = true;
+  } else {
+    captureEnabled = true;
+  }
+}
+
+void captureStop() {
+  captureEnabled = false;
+  resumeAfterFlush = false;
+}
+
+void captureClear() {
+  flushTarget = FLUSH_NONE;
+  head = tail = 0;
+  entries = overwritten = truncated = 0;
+  if (resumeAfterFlush) captureEnabled = true;
+  resumeAfterFlush = false;
+}
+
+static void beginFlush(FlushTarget target) {
+  if (flushTarget == FLUSH_NONE) resumeAfterFlush = captureEnabled;
+  captureEnabled = false;  // Keep the ring still until the flush is done
+
+  // Map esp_timer time onto the wall clock if it is known
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  flushClockOffsetUs = tv.tv_sec >= (time_t)CAPTURE_MIN_UNIX_TIME
+    ? (int64_t)tv.tv_sec * 1000000 + tv.tv_usec - esp_timer_get_time() : 0;
+
+  IPAddress local = WiFi.localIP();
+  for (int i = 0; i < 4; i++) flushLocalIp[i] = local[i];
+  flushTarget = target;
+  flushPos = tail;
+  flushHeaderDone = false;
+  flushLen = flushOut = 0;
+  flushRecords = flushBytes = 0;
+}
+
+void captureDumpSerial() {
+  beginFlush(FLUSH_SERIAL);
+}
+
+bool captureSendUdp(const char* target) {
+  char host[16];
+  const char* colon = strchr(target, ':');
+  size_t hostLen = colon ? (size_t)(colon - target) : strlen(target);
+  if (hostLen == 0 || hostLen >= sizeof(host)) return false;
+  memcpy(host, target, hostLen);
+  host[hostLen] = '\0';
+
+  long port = CAPTURE_DEFAULT_PORT;
+  if (colon) {
+    char* end;
+    port = strtol(colon + 1, &end, 10);
+    if (end == colon + 1 || *end || port <= 0 || port > 65535) return false;
+  }
+  IPAddress ip;
+  if (!ip.fromString(host)) return false;
+
+  flushTo = ip;
+  flushPort = (uint16_t)port;
+  beginFlush(FLUSH_UDP);
+  return true;
+}
+
+// Fill flushBuf with the file header (first time) and as many whole
+// records as fit
+static void refillFlushBuffer() {
+  flushLen = flushOut = 0;
+  if (!flushHeaderDone) {
+    flushLen = pcapFileHeader(flushBuf, CAPTURE_SNAP_LEN + PCAP_IP_UDP_LEN);
+    flushHeaderDone = true;
+  }
+  while (flushPos != head) {
+    CaptureEntry e;
+    ringRead(flushPos, &e, sizeof(e));
+    size_t recordLen = PCAP_RECORD_HEADER_LEN + PCAP_IP_UDP_LEN + e.len;
+    if (flushLen + recordLen > sizeof(flushBuf)) break;
+
+    uint8_t bulbIp[4];
+    for (int i = 0; i < 4; i++) bulbIp[i] = e.bulb < BULB_COUNT ? bulbs[e.bulb].ip[i] : 0;
+    uint64_t us = (uint64_t)(e.us + flushClockOffsetUs);
+    uint8_t* out = flushBuf + flushLen;
+    if (e.dir == CAPTURE_SENT) {
+      out += pcapRecordHeader(out, us, flushLocalIp, WIZ_LOCAL_PORT, bulbIp, WIZ_PORT, e.len, flushIpId++);
+    } else {
+      out += pcapRecordHeader(out, us, bulbIp, WIZ_PORT, flushLocalIp, WIZ_LOCAL_PORT, e.len, flushIpId++);
+    }
+    ringRead(flushPos + sizeof(e), out, e.len);
+    flushLen += recordLen;
+    flushPos += sizeof(e) + e.len;
+    flushRecords++;
+  }
+  flushBytes += flushLen;
+}
+
+static void writeHexLines() {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  char text[5 + 2 * CAPTURE_HEX_LINE_BYTES + 1];
+  memcpy(text, "PCAP ", 5);
+
+  // Only what fits in the UART buffer, so the loop never waits on Serial
+  while (flushOut < flushLen && Serial.availableForWrite() >= (int)sizeof(text)) {
+    size_t n = flushLen - flushOut < CAPTURE_HEX_LINE_BYTES ? flushLen - flushOut : CAPTURE_HEX_LINE_BYTES;
+    char* p = text + 5;
+    for (size_t i = 0; i < n; i++) {
+      *p++ = HEX_DIGITS[flushBuf[flushOut + i] >> 4];
+      *p++ = HEX_DIGITS[flushBuf[flushOut + i] & 15];
+    }
+    *p++ = '\n';
+    Serial.write((const uint8_t*)text, p - text);
+    flushOut += n;
+  }
+}
+
+void capturePoll() {
+  if (flushTarget == FLUSH_NONE) return;
+  schedulerStayAwake(LOOP_POLL_MS);
+
+  if (flushOut == flushLen) {
+    refillFlushBuffer();
+    if (flushLen == 0) {
+      Serial.printf("  Capture flushed: %u packets, %u bytes of pcap\n", flushRecords, flushBytes);
+      flushTarget = FLUSH_NONE;
+      captureEnabled = resumeAfterFlush;
+      resumeAfterFlush = false;
+      return;
+    }
+  }
+
+  if (flushTarget == FLUSH_SERIAL) {
+    writeHexLines();
+  } else {
+    // One datagram per pass; a lost one costs its records, not the file
+    flushUdp.beginPacket(flushTo, flushPort);
+    flushUdp.write(flushBuf, flushLen);
+    flushUdp.endPacket();
+    flushOut = flushLen;
+  }
+}
+
+void capturePrintStatus() {
+  bool on = captureEnabled || resumeAfterFlush;
+  Serial.printf("  Capture: %s  Packets: %u  Ring: %u of %u bytes\n",
+    on ? "on" : "off", entries, (unsigned)(head - tail), (unsigned)CAPTURE_RING_BYTES);
+  if (entries) {
+    CaptureEntry oldest;
+    ringRead(tail, &oldest, sizeof(oldest));
+    Serial.printf("  Oldest: %lu ms ago  Overwritten: %u  Truncated: %u\n",
+      (unsigned long)((esp_timer_get_time() - oldest.us) / 1000), overwritten, truncated);
+  }
+  if (flushTarget != FLUSH_NONE) {
+    Serial.printf("  Flushing to %s: %u packets so far (recording paused)\n",
+      flushTarget == FLUSH_SERIAL ? "serial" : "UDP", flushRecords);
+  }
+}
@@ -0,0 +1,47 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Packet capture (capture.cpp): every WiZ datagram the backend sends or
+// receives, with a microsecond timestamp, kept in a RAM ring that
+// overwrites the oldest packets. Off by default (console "capture on").
+//
+// "capture dump" prints the ring as a pcap file in hex lines starting
+// "PCAP ", only as fast as the UART drains; rebuild it on the host with
+//   grep '^PCAP ' console.txt | cut -c6- | xxd -r -p > dimmer.pcap
+// "capture send <ip>[:port]" streams the same file as UDP datagrams:
+//   socat -u UDP-RECV:5555 CREATE:dimmer.pcap
+// Recording pauses while a flush is in progress so the file is a
+// consistent snapshot. Timestamps are wall clock once NTP has synced,
+// otherwise time since boot.
+
+const size_t CAPTURE_RING_BYTES = 16384;               // Power of two
+const size_t CAPTURE_SNAP_LEN = 256;                   // Longer payloads are truncated
+const size_t CAPTURE_DATAGRAM_MAX = 1400;              // Records are packed whole into datagrams
+const uint16_t CAPTURE_DEFAULT_PORT = 5555;
+
+enum CaptureDirection : uint8_t {
+  CAPTURE_SENT,
+  CAPTURE_RECEIVED,
+};
+
+extern bool captureEnabled;
+
+void captureStart();
+void captureStop();
+void captureClear();
+void captureDumpSerial();
+bool captureSendUdp(const char* target);  // "a.b.c.d[:port]"; false if malformed
+void capturePoll();  // Call every loop pass
+void capturePrintStatus();
+
+void captureRecordPacket(int bulb, CaptureDirection dir, const uint8_t* data, size_t len);
+
+// Inline check so the hot path costs one load and branch while off
+inline void capturePacket(int bulb, CaptureDirection dir, const uint8_t* data, size_t len) {
+  if (captureEnabled) captureRecordPacket(bulb, dir, data, len);
+}
+
+#endif
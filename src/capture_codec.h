@@ -0,0 +1,85 @@
+#ifndef CAPTURE_CODEC_H
+#define CAPTURE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Classic pcap output for the packet capture ring (capture.cpp).
+//
+// Files use microsecond timestamps and LINKTYPE_RAW, so each record is a
+// bare IPv4 header plus UDP header in front of the WiZ JSON payload. The
+// dimmer never sees those headers; they are rebuilt from the bulb and
+// controller addresses so Wireshark can filter and dissect by address and
+// port. The UDP checksum is left at 0 (not computed), which IPv4 allows.
+
+const uint32_t PCAP_MAGIC_US = 0xA1B2C3D4;
+const uint32_t PCAP_LINKTYPE_RAW = 101;
+const size_t PCAP_FILE_HEADER_LEN = 24;
+const size_t PCAP_RECORD_HEADER_LEN = 16;
+const size_t PCAP_IP_UDP_LEN = 28;
+
+inline void pcapPut16(uint8_t* p, uint16_t v) {  // Little-endian (pcap headers)
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+inline void pcapPut32(uint8_t* p, uint32_t v) {
+  pcapPut16(p, (uint16_t)v);
+  pcapPut16(p + 2, (uint16_t)(v >> 16));
+}
+
+inline void pcapPutBe16(uint8_t* p, uint16_t v) {  // Network order (IP/UDP)
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+inline size_t pcapFileHeader(uint8_t* out, uint32_t snapLen) {
+  pcapPut32(out, PCAP_MAGIC_US);
+  pcapPut16(out + 4, 2);  // Version 2.4
+  pcapPut16(out + 6, 4);
+  pcapPut32(out + 8, 0);  // Timezone, sigfigs
+  pcapPut32(out + 12, 0);
+  pcapPut32(out + 16, snapLen);
+  pcapPut32(out + 20, PCAP_LINKTYPE_RAW);
+  return PCAP_FILE_HEADER_LEN;
+}
+
+// Record header plus IPv4/UDP headers for a payload of len bytes; the
+// payload itself goes right after. Addresses are in network order
+// (a.b.c.d = {a, b, c, d}). Returns the bytes written.
+inline size_t pcapRecordHeader(uint8_t* out, uint64_t unixUs,
+                               const uint8_t* srcIp, uint16_t srcPort,
+                               const uint8_t* dstIp, uint16_t dstPort,
+                               size_t len, uint16_t ipId) {
+  uint32_t total = (uint32_t)(PCAP_IP_UDP_LEN + len);
+  pcapPut32(out, (uint32_t)(unixUs / 1000000));
+  pcapPut32(out + 4, (uint32_t)(unixUs % 1000000));
+  pcapPut32(out + 8, total);
+  pcapPut32(out + 12, total);
+
+  uint8_t* ip = out + PCAP_RECORD_HEADER_LEN;
+  ip[0] = 0x45;  // IPv4, 20-byte header
+  ip[1] = 0;
+  pcapPutBe16(ip + 2, (uint16_t)total);
+  pcapPutBe16(ip + 4, ipId);
+  pcapPutBe16(ip + 6, 0x4000);  // Don't fragment
+  ip[8] = 64;   // TTL
+  ip[9] = 17;   // UDP
+  pcapPutBe16(ip + 10, 0);
+  memcpy(ip + 12, srcIp, 4);
+  memcpy(ip + 16, dstIp, 4);
+  uint32_t sum = 0;
+  for (int i = 0; i < 20; i += 2) sum += (uint32_t)(ip[i] << 8 | ip[i + 1]);
+  while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+  pcapPutBe16(ip + 10, (uint16_t)~sum);
+
+  uint8_t* udp = ip + 20;
+  pcapPutBe16(udp, srcPort);
+  pcapPutBe16(udp + 2, dstPort);
+  pcapPutBe16(udp + 4, (uint16_t)(8 + len));
+  pcapPutBe16(udp + 6, 0);
+  return PCAP_RECORD_HEADER_LEN + PCAP_IP_UDP_LEN;
+}
+
+#endif
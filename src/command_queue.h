@@ -0,0 +1,152 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stdint.h>
+
+// Outgoing setPilot queue with two priority classes.
+//
+// Each bulb has a single slot; a new command is merged into it (later fields
+// override earlier ones) and the slot takes the higher of the two
+// priorities. Because a bulb never has two commands queued, commands to one
+// bulb cannot be reordered: an "off" simply replaces a queued brightness, and
+// a brightness update arriving after an "off" is dropped rather than turning
+// the light back on.
+//
+// pop() returns control slots (on/off) first, oldest first, then stream
+// slots (brightness/temp) whose bulb is outside its stream interval.
+// Header-only and Arduino-free so tools/queue_trace.cpp can replay traces.
+
+enum CommandPriority : uint8_t {
+  PRIORITY_STREAM = 0,   // Brightness / color temperature updates
+  PRIORITY_CONTROL = 1,  // On/off, resync, restore
+};
+
+enum PilotField : uint8_t {
+  PILOT_STATE = 1,
+  PILOT_DIMMING = 2,
+  PILOT_TEMP = 4,
+};
+
+struct PilotCommand {
+  uint8_t fields;  // PilotField bits
+  bool on;
+  uint8_t dimming;
+  uint16_t temp;
+};
+
+template <int N>
+class CommandQueue {
+ public:
+  enum PushResult : uint8_t {
+    PUSH_QUEUED,     // Slot was empty
+    PUSH_MERGED,     // Folded into a pending command
+    PUSH_DROPPED,    // Stream update for a light that is (going) off
+  };
+
+  CommandQueue() : nextSeq_(1) {
+    for (int i = 0; i < N; i++) {
+      slots_[i] = Slot();
+      lastStreamSend_[i] = 0;
+      off_[i] = false;
+    }
+  }
+
+  PushResult push(int bulb, const PilotCommand& cmd, CommandPriority priority) {
+    Slot& slot = slots_[bulb];
+
+    if (cmd.fields & PILOT_STATE) {
+      off_[bulb] = !cmd.on;
+    } else if (off_[bulb]) {
+      // Dimming/temp alone would switch the bulb back on
+      return PUSH_DROPPED;
+    }
+
+    PushResult result = slot.cmd.fields ? PUSH_MERGED : PUSH_QUEUED;
+    if (!slot.cmd.fields) slot.seq = nextSeq_++;
+
+    if ((cmd.fields & PILOT_STATE) && !cmd.on) {
+      slot.cmd.fields = PILOT_STATE;  // Off carries nothing else
+    } else {
+      slot.cmd.fields |= cmd.fields;
+    }
+    if (cmd.fields & PILOT_STATE) slot.cmd.on = cmd.on;
+    if (slot.cmd.fields & cmd.fields & PILOT_DIMMING) slot.cmd.dimming = cmd.dimming;
+    if (slot.cmd.fields & cmd.fields & PILOT_TEMP) slot.cmd.temp = cmd.temp;
+
+    if (priority > slot.priority) {
+      slot.priority = priority;
+      slot.seq = nextSeq_++;  // Control order follows promotion time
+    }
+    return result;
+  }
+
+  // Next command due at `now`, or false if nothing may be sent yet
+  bool pop(unsigned long now, unsigned long streamIntervalMs, int* bulb, PilotCommand* cmd) {
+    int best = -1;
+    for (int i = 0; i < N; i++) {
+      const Slot& slot = slots_[i];
+      if (!slot.cmd.fields) continue;
+      if (slot.priority == PRIORITY_STREAM && now - lastStreamSend_[i] < streamIntervalMs) continue;
+      if (best < 0 || slot.priority > slots_[best].priority ||
+          (slot.priority == slots_[best].priority && (int32_t)(slot.seq - slots_[best].seq) < 0)) {
+        best = i;
+      }
+    }
+    if (best < 0) return false;
+
+    *bulb = best;
+    *cmd = slots_[best].cmd;
+    if (slots_[best].priority == PRIORITY_STREAM) lastStreamSend_[best] = now;
+    slots_[best] = Slot();
+    return true;
+  }
+
+  bool pending(int bulb) const { return slots_[bulb].cmd.fields != 0; }
+
+  int depth() const {
+    int n = 0;
+    for (int i = 0; i < N; i++) n += slots_[i].cmd.fields ? 1 : 0;
+    return n;
+  }
+
+ private:
+  struct Slot {
+    PilotCommand cmd;
+    CommandPriority priority;
+    uint32_t seq;
+    Slot() : cmd(), priority(PRIORITY_STREAM), seq(0) {}
+  };
+
+  Slot slots_[N];
+  unsigned long lastStreamSend_[N];
+  bool off_[N];  // Last state pushed was "off"
+  uint32_t nextSeq_;
+};
+
+// Packets one lightsFlush() pass sends to each bulb. The pass runs after
+// every input has queued its commands: commands popped from the queue are
+// counted first, and a probe (refresh or dead-bulb) is only allowed to a
+// bulb with nothing else going out, so no bulb gets two packets per pass.
+template <int N>
+class PassPackets {
+ public:
+  PassPackets() {
+    for (int i = 0; i < N; i++) packets_[i] = 0;
+  }
+
+  void command(int bulb) { packets_[bulb]++; }
+
+  // True if the probe may go out; it is then counted
+  bool probe(int bulb) {
+    if (packets_[bulb]) return false;
+    packets_[bulb]++;
+    return true;
+  }
+
+  int packets(int bulb) const { return packets_[bulb]; }
+
+ private:
+  uint8_t packets_[N];
+};
+
+#endif
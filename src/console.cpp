@@ -0,0 +1,377 @@
+#include <WiFi.h>
+#include "bench.h"
+#include "capture.h"
+#include "console.h"
+#include "dimmer.h"
+#include "events.h"
+#include "flows.h"
+#include "lights.h"
+#include "network.h"
+#include "proxy.h"
+#include "rules.h"
+#include "scheduler.h"
+#include "usage.h"
+#include "web.h"
+#include "zones.h"
+
+const int CONSOLE_LINE_MAX = 64;
+const int CONSOLE_MAX_CHARS_PER_POLL = 32;  // Bound the work done in a single loop pass
+
+static char line[CONSOLE_LINE_MAX];
+static uint8_t lineLen = 0;
+static bool lineOverflow = false;
+
+static const char* const LOG_LEVEL_NAMES[] = {"error", "info", "debug"};
+
+typedef void (*CommandHandler)(const char* args);
+
+struct Command {
+  const char* name;
+  CommandHandler handler;
+  const char* help;
+};
+
+static void cmdHelp(const char* args);
+static void cmdState(const char* args);
+static void cmdStats(const char* args);
+static void cmdHist(const char* args);
+static void cmdReset(const char* args);
+static void cmdResync(const char* args);
+static void cmdRate(const char* args);
+static void cmdLog(const char* args);
+static void cmdPredict(const char* args);
+static void cmdCache(const char* args);
+static void cmdUsage(const char* args);
+static void cmdWeb(const char* args);
+static void cmdProxy(const char* args);
+static void cmdBench(const char* args);
+static void cmdCapture(const char* args);
+static void cmdRules(const char* args);
+static void cmdEvents(const char* args);
+static void cmdFade(const char* args);
+static void cmdFlows(const char* args);
+
+static const Command COMMANDS[] = {
+  {"help",   cmdHelp,   "List commands"},
+  {"state",  cmdState,  "Show light and WiFi state"},
+  {"stats",  cmdStats,  "Show packet and loop counters"},
+  {"hist",   cmdHist,   "hist [dump] - loop, send and ack timing percentiles / hex for histmerge"},
+  {"reset",  cmdReset,  "Clear counters and histograms"},
+  {"resync", cmdResync, "Resend current state to both lights until they confirm"},
+  {"rate",   cmdRate,   "rate [ms] - show/set brightness send interval"},
+  {"log",    cmdLog,    "log [error|info|debug] - show/set log level"},
+  {"predict", cmdPredict, "predict [on|off] - send where a fast spin is heading"},
+  {"cache",  cmdCache,  "cache [s] - show/set acked-state cache TTL (0 = always send)"},
+  {"usage",  cmdUsage,  "usage [flush] - show usage history ring / write buffer to flash"},
+  {"web",    cmdWeb,    "Show WebSocket clients and push fan-out cost"},
+  {"proxy",  cmdProxy,  "proxy [on|off|ttl s] - WiZ proxy for other clients / getPilot cache TTL"},
+  {"bench",  cmdBench,  "Run the hot-path cycle-count benchmarks"},
+  {"capture", cmdCapture, "capture [on|off|clear|dump|send ip[:port]] - WiZ packet capture as pcap"},
+  {"rules",  cmdRules,  "rules [add hex|save|discard|clear] - load rules from tools/rulec"},
+  {"events", cmdEvents, "Show event bus subscribers, backlog and drops"},
+  {"fade",   cmdFade,   "fade <level> <s> - walk brightness to level over s seconds"},
+  {"flows",  cmdFlows,  "Show running flows and what they wait for"},
+};
+static const int COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+static void cmdHelp(const char* args) {
+  for (int i = 0; i < COMMAND_COUNT; i++) {
+    Serial.printf("  %-7s %s\n", COMMANDS[i].name, COMMANDS[i].help);
+  }
+}
+
+static void cmdState(const char* args) {
+  Serial.printf("  Brightness: %d%%  Next color temp mode: %d\n", brightness, colorTempMode);
+  Serial.printf("  Study Lamp: %s  Uplight: %s\n", studyLampOn ? "ON" : "OFF", uplightOn ? "ON" : "OFF");
+  if (zoneCount > 1) zonesPrintStatus();
+  unsigned long now = millis();
+  for (int i = 0; i < BULB_COUNT; i++) {
+    const Bulb& b = bulbs[i];
+    char ip[16];  // No String: the console does not allocate
+    snprintf(ip, sizeof(ip), "%u.%u.%u.%u", b.ip[0], b.ip[1], b.ip[2], b.ip[3]);
+    Serial.printf("  %-10s %-15s %s  misses: %u  last reply: ",
+      b.name, ip, b.alive ? "alive" : "DEAD ", b.misses);
+    if (b.lastSeen) {
+      Serial.printf("%lus ago\n", (now - b.lastSeen) / 1000);
+    } else {
+      Serial.println("never");
+    }
+  }
+  networkPrintStatus();
+  Serial.printf("  Rate limit: %u ms  Log level: %s\n", brightnessIntervalMs, LOG_LEVEL_NAMES[logLevel]);
+}
+
+static void cmdStats(const char* args) {
+  unsigned long elapsedMs = millis() - stats.sinceMs;
+  Serial.printf("  Loop passes: %u  Max loop: %u us  Asleep: %u%%  Timers run: %u\n", stats.loopPasses,
+    stats.loopHist.maxValue, elapsedMs ? (unsigned)((uint64_t)stats.sleptMs * 100 / elapsedMs) : 0, stats.timersRun);
+  Serial.printf("  Sent: %u  Send errors: %u  Received: %u  Missed replies: %u\n",
+    stats.packetsSent, stats.sendErrors, stats.packetsReceived, stats.acksMissed);
+  Serial.printf("  Suppressed (bulb dead): %u  Probes: %u\n",
+    stats.streamSuppressed, stats.probesSent);
+  Serial.printf("  Redundant skipped: %u (%lu per hour)\n", stats.redundantSkipped,
+    elapsedMs ? (unsigned long)((uint64_t)stats.redundantSkipped * 3600000ULL / elapsedMs) : 0UL);
+  Serial.printf("  Encoder steps: %u  Coalesced: %u  Dropped: %u  Next msg ID: %u\n",
+    stats.encoderSteps, stats.commandsCoalesced, stats.commandsDropped, messageId);
+  Serial.printf("  Batches: %u  Commands per batch: %u.%u\n", stats.batches,
+    stats.batches ? stats.batchedCommands / stats.batches : 0,
+    stats.batches ? stats.batchedCommands * 10 / stats.batches % 10 : 0);
+  Serial.printf("  Log events: %u  Log bytes: %u (%u per event)\n",
+    stats.logEvents, stats.logBytes, stats.logEvents ? stats.logBytes / stats.logEvents : 0);
+  if (stats.httpRequests) {
+    Serial.printf("  HTTP requests: %u  Connects: %u  Latency: %u us avg, %u us max\n",
+      stats.httpRequests, stats.httpConnects,
+      stats.httpLatencyHist.mean(), stats.httpLatencyHist.maxValue);
+  }
+  Serial.printf("  Heap free: %u  Min ever: %u\n", ESP.getFreeHeap(), ESP.getMinFreeHeap());
+}
+
+struct NamedHistogram {
+  const char* name;
+  const LatencyHistogram* hist;
+};
+
+static const NamedHistogram HISTOGRAMS[] = {
+  {"loop",   &stats.loopHist},
+  {"flush",  &stats.flushHist},
+  {"ack",    &stats.ackRttHist},
+  {"http",   &stats.httpLatencyHist},
+  {"rules",  &stats.rulesHist},
+};
+
+// "HIST <name> <hex>" lines for tools/histmerge.cpp
+static void dumpHistogram(const char* name, const LatencyHistogram& h) {
+  static uint8_t buf[HIST_SERIALIZED_MAX];
+  size_t len = h.serialize(buf);
+  Serial.printf("HIST %s ", name);
+  for (size_t i = 0; i < len; i++) Serial.printf("%02x", buf[i]);
+  Serial.println();
+}
+
+static void cmdHist(const char* args) {
+  bool dump = strcmp(args, "dump") == 0;
+  if (*args && !dump) {
+    Serial.println("  Usage: hist [dump]");
+    return;
+  }
+  if (!dump) {
+    Serial.printf("  %-6s %8s %7s %7s %7s %7s %7s %7s  (us)\n",
+      "", "count", "min", "p50", "p90", "p99", "p99.9", "max");
+  }
+  for (size_t i = 0; i < sizeof(HISTOGRAMS) / sizeof(HISTOGRAMS[0]); i++) {
+    const LatencyHistogram& h = *HISTOGRAMS[i].hist;
+    if (dump) {
+      dumpHistogram(HISTOGRAMS[i].name, h);
+    } else if (h.total) {
+      Serial.printf("  %-6s %8u %7u %7u %7u %7u %7u %7u\n", HISTOGRAMS[i].name, h.total,
+        h.minValue, h.percentile(50), h.percentile(90), h.percentile(99), h.percentile(99.9f), h.maxValue);
+    }
+  }
+}
+
+static void cmdReset(const char* args) {
+  memset(&stats, 0, sizeof(stats));
+  stats.sinceMs = millis();
+  Serial.println("  Counters cleared");
+}
+
+static void cmdResync(const char* args) {
+  if (!startResync()) Serial.println("  Resync already running");
+}
+
+static void cmdRate(const char* args) {
+  if (*args) {
+    char* end;
+    long ms = strtol(args, &end, 10);
+    if (end == args || ms < 0 || ms > 5000) {
+      Serial.println("  Usage: rate <0-5000>");
+      return;
+    }
+    brightnessIntervalMs = (uint32_t)ms;
+  }
+  Serial.printf("  Brightness send interval: %u ms\n", brightnessIntervalMs);
+}
+
+static void cmdLog(const char* args) {
+  if (*args) {
+    int level = -1;
+    for (int i = 0; i <= LOG_DEBUG; i++) {
+      if (strcmp(args, LOG_LEVEL_NAMES[i]) == 0) level = i;
+    }
+    if (level < 0) {
+      Serial.println("  Usage: log <error|info|debug>");
+      return;
+    }
+    logLevel = (uint8_t)level;
+  }
+  Serial.printf("  Log level: %s\n", LOG_LEVEL_NAMES[logLevel]);
+}
+
+static void cmdPredict(const char* args) {
+  if (strcmp(args, "on") == 0) {
+    predictEnabled = true;
+  } else if (strcmp(args, "off") == 0) {
+    predictEnabled = false;
+  } else if (*args) {
+    Serial.println("  Usage: predict <on|off>");
+    return;
+  }
+  Serial.printf("  Prediction: %s  Predicted sends: %u  Corrections: %u\n",
+    predictEnabled ? "on" : "off", stats.predictedSends, stats.predictCorrections);
+}
+
+static void cmdCache(const char* args) {
+  if (*args) {
+    char* end;
+    long s = strtol(args, &end, 10);
+    if (end == args || s < 0 || s > 86400) {
+      Serial.println("  Usage: cache <0-86400>");
+      return;
+    }
+    stateCacheTtlMs = (uint32_t)s * 1000;
+  }
+  Serial.printf("  State cache TTL: %u s%s\n", stateCacheTtlMs / 1000,
+    stateCacheTtlMs ? "" : " (redundant commands are sent)");
+}
+
+static void cmdUsage(const char* args) {
+  if (strcmp(args, "flush") == 0) usageFlush();
+  usagePrintStatus();
+}
+
+static void cmdWeb(const char* args) {
+  webPrintStatus();
+}
+
+static void cmdBench(const char* args) {
+  benchRun();
+}
+
+static void cmdProxy(const char* args) {
+  if (strcmp(args, "on") == 0) {
+    proxyBegin();
+  } else if (strcmp(args, "off") == 0) {
+    proxyEnd();
+  } else if (strncmp(args, "ttl ", 4) == 0) {
+    char* end;
+    long s = strtol(args + 4, &end, 10);
+    if (end == args + 4 || s < 0 || s > 86400) {
+      Serial.println("  Usage: proxy ttl <0-86400>");
+      return;
+    }
+    proxyStateTtlMs = (uint32_t)s * 1000;
+  } else if (*args) {
+    Serial.println("  Usage: proxy <on|off|ttl s>");
+    return;
+  }
+  proxyPrintStatus();
+}
+
+static void cmdCapture(const char* args) {
+  if (strcmp(args, "on") == 0) {
+    captureStart();
+  } else if (strcmp(args, "off") == 0) {
+    captureStop();
+  } else if (strcmp(args, "clear") == 0) {
+    captureClear();
+  } else if (strcmp(args, "dump") == 0) {
+    captureDumpSerial();
+  } else if (strncmp(args, "send ", 5) == 0) {
+    if (!captureSendUdp(args + 5)) {
+      Serial.println("  Usage: capture send <ip>[:port]");
+      return;
+    }
+  } else if (*args) {
+    Serial.println("  Usage: capture <on|off|clear|dump|send ip[:port]>");
+    return;
+  }
+  capturePrintStatus();
+}
+
+static void cmdRules(const char* args) {
+  if (strncmp(args, "add ", 4) == 0) {
+    if (!rulesStage(args + 4)) {
+      Serial.println("  Bad hex or program too large (staging discarded)");
+      rulesDiscardStaged();
+    }
+    return;  // Quiet: rulec sends many of these
+  } else if (strcmp(args, "save") == 0) {
+    if (!rulesSave()) Serial.println("  Staged program is invalid or NVS write failed - not saved");
+  } else if (strcmp(args, "discard") == 0) {
+    rulesDiscardStaged();
+  } else if (strcmp(args, "clear") == 0) {
+    rulesClear();
+  } else if (*args) {
+    Serial.println("  Usage: rules <add hex|save|discard|clear>");
+    return;
+  }
+  rulesPrintStatus();
+}
+
+static void cmdEvents(const char* args) {
+  eventsPrintStatus();
+}
+
+static void cmdFade(const char* args) {
+  char* end;
+  long level = strtol(args, &end, 10);
+  char* secondsEnd;
+  long seconds = strtol(end, &secondsEnd, 10);
+  if (end == args || secondsEnd == end || level < MIN_BRIGHTNESS || level > MAX_BRIGHTNESS ||
+      seconds < 0 || seconds > 3600) {
+    Serial.printf("  Usage: fade <%d-%d> <0-3600>\n", MIN_BRIGHTNESS, MAX_BRIGHTNESS);
+    return;
+  }
+  if (!startFade((int)level, (uint32_t)seconds * 1000)) {
+    Serial.println("  Fade already running or no free flow frame");
+    return;
+  }
+  Serial.printf("  Fading to %ld over %ld s (turn the knob to stop)\n", level, seconds);
+}
+
+static void cmdFlows(const char* args) {
+  flowsPrintStatus();
+}
+
+static void dispatchLine() {
+  // Split "name args" in place
+  char* args = line;
+  while (*args && *args != ' ') args++;
+  if (*args) *args++ = '\0';
+  while (*args == ' ') args++;
+
+  for (int i = 0; i < COMMAND_COUNT; i++) {
+    if (strcmp(line, COMMANDS[i].name) == 0) {
+      COMMANDS[i].handler(args);
+      return;
+    }
+  }
+  Serial.print("  Unknown command: ");
+  Serial.println(line);
+}
+
+void consolePoll() {
+  for (int n = 0; n < CONSOLE_MAX_CHARS_PER_POLL && Serial.available(); n++) {
+    char c = (char)Serial.read();
+
+    if (c == '\r' || c == '\n') {
+      if (lineOverflow) {
+        Serial.println("  Line too long");
+      } else if (lineLen > 0) {
+        line[lineLen] = '\0';
+        Serial.print("> ");
+        Serial.println(line);
+        dispatchLine();
+      }
+      lineLen = 0;
+      lineOverflow = false;
+    } else if (lineLen < CONSOLE_LINE_MAX - 1) {
+      line[lineLen++] = c;
+    } else {
+      lineOverflow = true;
+    }
+  }
+  // Serial.onReceive() wakes the loop once per burst; the rest of a long
+  // paste has to be read without waiting for the next one
+  if (Serial.available()) schedulerWake();
+}
@@ -0,0 +1,8 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+// Line-based serial command console. Call consolePoll() once per loop pass;
+// it never blocks and does not allocate. Type "help" for the command list.
+void consolePoll();
+
+#endif
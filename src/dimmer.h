@@ -0,0 +1,113 @@
+#ifndef DIMMER_H
+#define DIMMER_H
+
+#include <Arduino.h>
+#include "histogram.h"
+#include "log.h"
+
+// Shared controller state and helpers (defined in main.cpp)
+
+const int MIN_BRIGHTNESS = 10;
+const int MAX_BRIGHTNESS = 100;
+const int BRIGHTNESS_STEP = 2;  // 2% per detent for smoother control
+
+extern int brightness;      // 10-100 (WiZ range), the first zone's level (zones.h)
+extern bool studyLampOn;
+extern bool uplightOn;
+extern int colorTempMode;   // 0=2200K, 1=2700K, 2=4000K, 3=6500K
+extern int colorTemp;       // Last color temperature applied (K), 0 = never set
+
+// Minimum time between streamed brightness/temp packets per bulb (0 = every detent)
+extern uint32_t brightnessIntervalMs;
+
+// Send where a fast spin is heading rather than where the knob is (brightness_predictor.h)
+extern bool predictEnabled;
+
+// Runtime counters, dumped by the console "stats" and "hist" commands.
+// Timings are histograms in microseconds (histogram.h).
+struct Stats {
+  uint32_t sinceMs;              // millis() when counters were last cleared
+  uint32_t loopPasses;
+  uint32_t sleptMs;              // Time the loop spent asleep between passes (scheduler.cpp)
+  uint32_t timersRun;
+  LatencyHistogram loopHist;     // Loop pass duration, excluding the delay
+  LatencyHistogram flushHist;    // lightsFlush() passes that sent commands
+  LatencyHistogram ackRttHist;   // Command sent to its reply, as seen by the loop
+  LatencyHistogram rulesHist;    // Rule program runs, one per event (rules.cpp)
+  uint32_t packetsSent;
+  uint32_t sendErrors;
+  uint32_t packetsReceived;
+  uint32_t acksMissed;
+  uint32_t streamSuppressed;     // Updates not sent because the bulb is not responding
+  uint32_t redundantSkipped;     // Commands matching the bulb's acknowledged state
+  uint32_t probesSent;
+  uint32_t predictedSends;       // Detents sent as a predicted level
+  uint32_t predictCorrections;   // Real level resent after the knob stopped
+  uint32_t encoderSteps;
+  uint32_t commandsCoalesced;    // Commands merged into one already queued for the bulb
+  uint32_t commandsDropped;      // Stream updates dropped because the light is off
+  uint32_t batches;              // Loop passes that sent commands
+  uint32_t batchedCommands;      // Commands in those passes (at most one per bulb each)
+  uint32_t logEvents;
+  uint32_t logBytes;             // Serial bytes written by logMsg()
+  uint32_t usageRecords;
+  uint32_t usageFlashWrites;
+  uint32_t usageSectorErases;
+  // web.cpp, from the push and AsyncTCP tasks: read and update with __atomic
+  uint32_t webFrames;            // Delta frames pushed to WebSocket clients
+  uint32_t webFanoutUs;          // Time spent in binaryAll() for those frames
+  uint32_t webFanoutClients;     // Sum of clients each frame went to
+  uint32_t webFanoutMaxUs;
+  uint32_t webCommandsDropped;   // Browser commands lost to a full queue
+  uint32_t proxyRequests;        // WiZ requests from other clients (proxy.cpp)
+  uint32_t proxySetPilots;
+  uint32_t proxyGetPilots;
+  uint32_t proxyCacheHits;       // getPilots answered within the TTL
+  uint32_t proxyRefreshes;       // getPilots that went to the bulb
+
+  // WiFi (network.cpp)
+  uint32_t wifiDrops;
+  uint32_t wifiAttempts;         // Connect attempts, including at boot
+  uint32_t wifiRecoverMs;        // Link down to IP back, last time
+  uint32_t wifiRecoverMaxMs;
+  uint32_t httpRequests;         // Requests written to the Hue bridge
+  uint32_t httpResponses;
+  uint32_t httpConnects;         // Connections opened (1 while keep-alive holds)
+  LatencyHistogram httpLatencyHist;  // Request written to response parsed
+};
+extern Stats stats;
+
+// Consistent copy of the controller state for readers outside the loop
+// (web handlers on the AsyncTCP task, telemetry). The loop publishes it
+// through a seqlock (seqlock.h) at the end of every pass that changed
+// something; reading never blocks the loop and never sees a half update.
+struct ControllerSnapshot {
+  uint32_t version;       // Bumped on every change
+  uint32_t changedAtMs;   // millis() of the last change
+  int32_t brightness;
+  int32_t colorTemp;      // 0 = never set
+  uint8_t colorTempMode;  // Mode the next encoder click applies
+  uint8_t powerMask;      // bit 0 study lamp, bit 1 uplight
+  uint8_t aliveMask;      // Bulbs answering, same bits
+  uint8_t reserved;
+};
+
+void publishControllerState();                     // Loop task only
+void readControllerState(ControllerSnapshot* out);  // Any task
+
+void resyncLights();
+
+// Flows on the loop task (flows.h, main.cpp); false if one of the kind is
+// already running or every flow frame is in use
+bool startResync();  // Resync and retry until both bulbs confirm
+bool startFade(int level, uint32_t durationMs);
+
+// Controller actions (main.cpp), used by the buttons and remote inputs
+void applyColorTemp(int mode);  // Send temp for mode and advance colorTempMode
+void followColorTemp(int kelvin);  // Set colorTemp from elsewhere (bulbs, rules) and pick the next preset
+void setBothLights(bool on);
+void setStudyLamp(bool on);
+void setUplight(bool on);
+void setBrightness(int value);
+
+#endif
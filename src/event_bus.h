@@ -0,0 +1,137 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-capacity publish/subscribe for controller events, shared by the
+// firmware (events.cpp) and tools/event_bus_stress.cpp.
+//
+// One publisher, the loop task. Each subscriber has its own single-producer
+// single-consumer ring and drains it from its own task, so a publish is a
+// few stores per subscriber and never waits on anyone. A subscriber that
+// falls behind loses the newest events and its drop count goes up; the
+// publisher and the other subscribers do not notice. A subscriber that
+// needs the current state after a drop reads the controller snapshot
+// (readControllerState() in dimmer.h).
+//
+// Subscribe from the publishing task (setup() or the loop), never from
+// the subscriber's own task.
+
+enum EventType : uint8_t {
+  EVENT_BRIGHTNESS = 0,  // value: level; source: power mask at the time (0 = both off)
+  EVENT_POWER = 1,       // value: on; source: bulb, or EVENT_ALL_BULBS
+  EVENT_COLOR_TEMP = 2,  // value: Kelvin
+  EVENT_BUTTON = 3,      // value: AceButton event; source: RuleButton
+  EVENT_TYPE_COUNT
+};
+
+const uint8_t EVENT_ALL_BULBS = 0xFF;
+const uint32_t EVENT_ALL_TYPES = (1u << EVENT_TYPE_COUNT) - 1;
+
+inline uint32_t eventMask(EventType type) {
+  return 1u << type;
+}
+
+struct BusEvent {
+  uint32_t ms;  // millis() when published
+  uint8_t type;
+  uint8_t source;
+  int16_t value;
+};
+
+// CAPACITY must be a power of two
+template <size_t CAPACITY>
+class EventRing {
+ public:
+  EventRing() : head_(0), tail_(0), dropped_(0) {
+    static_assert(CAPACITY && (CAPACITY & (CAPACITY - 1)) == 0, "EventRing capacity must be a power of two");
+  }
+
+  // Producer side; false (and one more drop) if the ring is full
+  bool push(const BusEvent& e) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= CAPACITY) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    slots_[head & (CAPACITY - 1)] = e;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool pop(BusEvent* e) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) return false;
+    *e = slots_[tail & (CAPACITY - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Either side
+  uint32_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  BusEvent slots_[CAPACITY];
+  std::atomic<uint32_t> head_;
+  std::atomic<uint32_t> tail_;
+  std::atomic<uint32_t> dropped_;
+};
+
+template <int MAX_SUBSCRIBERS, size_t CAPACITY>
+class EventBus {
+ public:
+  typedef void (*WakeFn)(void* ctx);  // Called after each event queued for the subscriber
+
+  EventBus() : count_(0), published_(0) {}
+
+  // Subscriber ID, or -1 if the table is full
+  int subscribe(uint32_t typeMask, WakeFn wake, void* ctx) {
+    if (count_ >= MAX_SUBSCRIBERS) return -1;
+    Subscriber& s = subs_[count_];
+    s.mask = typeMask;
+    s.wake = wake;
+    s.ctx = ctx;
+    return count_++;
+  }
+
+  void publish(EventType type, uint8_t source, int16_t value, uint32_t ms) {
+    BusEvent e;
+    e.ms = ms;
+    e.type = type;
+    e.source = source;
+    e.value = value;
+    published_++;
+    for (int i = 0; i < count_; i++) {
+      Subscriber& s = subs_[i];
+      if (!(s.mask & eventMask(type))) continue;
+      if (s.ring.push(e) && s.wake) s.wake(s.ctx);
+    }
+  }
+
+  // Subscriber side, from the subscriber's task
+  bool poll(int id, BusEvent* e) { return subs_[id].ring.pop(e); }
+
+  uint32_t dropped(int id) const { return subs_[id].ring.dropped(); }
+  uint32_t pending(int id) const { return subs_[id].ring.size(); }
+  uint32_t published() const { return published_; }
+  int subscribers() const { return count_; }
+
+ private:
+  struct Subscriber {
+    uint32_t mask;
+    WakeFn wake;
+    void* ctx;
+    EventRing<CAPACITY> ring;
+  };
+  Subscriber subs_[MAX_SUBSCRIBERS];
+  int count_;
+  uint32_t published_;  // Publisher's task only
+};
+
+#endif
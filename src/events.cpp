@@ -0,0 +1,73 @@
+#include <Arduino.h>
+#include "events.h"
+#include "dimmer.h"
+#include "lights.h"
+
+const uint32_t EVENT_LOG_STACK = 3072;
+const UBaseType_t EVENT_LOG_PRIORITY = 1;  // Same as the loop; it runs while the loop sleeps
+
+ControllerEventBus eventBus;
+
+static const char* subscriberNames[EVENT_SUBSCRIBERS_MAX];
+static int logSubscriber = -1;
+
+static void wakeTask(void* ctx) {
+  xTaskNotifyGive((TaskHandle_t)ctx);
+}
+
+static void logEvent(const BusEvent& e) {
+  switch (e.type) {
+    case EVENT_BRIGHTNESS:
+      logMsg<LOG_BRIGHTNESS>(e.value);
+      if (!e.source) logMsg<LOG_BOTH_OFF>();
+      break;
+    case EVENT_POWER:
+      if (e.source == EVENT_ALL_BULBS) {
+        logMsg<LOG_BOTH_TOGGLE>(e.value);
+      } else if (e.source == BULB_STUDY) {
+        logMsg<LOG_STUDY_TOGGLE>(e.value);
+      } else {
+        logMsg<LOG_UPLIGHT_TOGGLE>(e.value);
+      }
+      break;
+    case EVENT_COLOR_TEMP:
+      logMsg<LOG_COLOR_TEMP>(e.value);
+      break;
+  }
+}
+
+static void logTask(void*) {
+  uint32_t reported = 0;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    BusEvent e;
+    while (eventBus.poll(logSubscriber, &e)) logEvent(e);
+    uint32_t dropped = eventBus.dropped(logSubscriber);
+    if (dropped != reported) {
+      logMsg<LOG_EVENTS_DROPPED>(logSubscriber, dropped - reported);
+      reported = dropped;
+    }
+  }
+}
+
+int eventsSubscribe(const char* name, uint32_t typeMask, TaskHandle_t task) {
+  int id = eventBus.subscribe(typeMask, wakeTask, task);
+  if (id >= 0) subscriberNames[id] = name;
+  return id;
+}
+
+void eventsBegin() {
+  TaskHandle_t task = NULL;
+  // On the loop's core, away from the WiFi and TCP tasks on core 0
+  xTaskCreatePinnedToCore(logTask, "eventlog", EVENT_LOG_STACK, NULL, EVENT_LOG_PRIORITY, &task, ARDUINO_RUNNING_CORE);
+  logSubscriber = eventsSubscribe("log", eventMask(EVENT_BRIGHTNESS) | eventMask(EVENT_POWER) |
+    eventMask(EVENT_COLOR_TEMP), task);
+}
+
+void eventsPrintStatus() {
+  Serial.printf("  Published: %u\n", eventBus.published());
+  for (int i = 0; i < eventBus.subscribers(); i++) {
+    Serial.printf("  %-8s pending %2u/%u  dropped %u\n", subscriberNames[i], eventBus.pending(i),
+      (unsigned)EVENT_RING_CAPACITY, eventBus.dropped(i));
+  }
+}
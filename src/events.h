@@ -0,0 +1,31 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <Arduino.h>
+#include "event_bus.h"
+
+// Controller event bus (events.cpp, see event_bus.h). Input handlers and
+// controller actions publish what happened; consumers that do not have to
+// run before the packet goes out (logging, and later persistence or
+// telemetry) subscribe and run on their own tasks.
+//
+// The built-in "log" subscriber prints the input log lines (brightness,
+// power, color temperature) that the handlers used to print themselves.
+
+const int EVENT_SUBSCRIBERS_MAX = 4;
+const size_t EVENT_RING_CAPACITY = 32;  // Per subscriber
+
+typedef EventBus<EVENT_SUBSCRIBERS_MAX, EVENT_RING_CAPACITY> ControllerEventBus;
+extern ControllerEventBus eventBus;
+
+void eventsBegin();  // Start the built-in subscribers; call before the first publish
+// Subscribe a task; it is woken with a task notification for each event
+int eventsSubscribe(const char* name, uint32_t typeMask, TaskHandle_t task);
+void eventsPrintStatus();
+
+// Loop task only
+inline void publishEvent(EventType type, uint8_t source, int value) {
+  eventBus.publish(type, source, (int16_t)value, millis());
+}
+
+#endif
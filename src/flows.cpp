@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include <string.h>
+#include "flows.h"
+#include "dimmer.h"
+#include "lights.h"
+#include "network.h"
+#include "scheduler.h"
+
+FlowPool flowPool;
+
+static void wakeOnly(void*) {}
+
+// Ends the loop's sleep at a flow's deadline; flowsPoll() does the rest
+struct FlowTimer {
+  WheelTimer timer;
+  FlowTimer() : timer(wakeOnly) {}
+};
+static FlowTimer deadlines[FLOW_SLOTS];
+
+uint32_t flowNow() {
+  return millis();
+}
+
+bool bulbsAcked(uint8_t mask, uint32_t since) {
+  for (int i = 0; i < BULB_COUNT; i++) {
+    if (!(mask & (1 << i))) continue;
+    const Bulb& b = bulbs[i];
+    if (!b.acked.fields || (long)(b.ackedAt - since) < 0) return false;
+  }
+  return true;
+}
+
+void flowsPoll() {
+  uint32_t now = millis();
+  for (int i = 0; i < FLOW_SLOTS; i++) {
+    Flow* f = flowPool.at(i);
+    if (!f) continue;
+
+    bool ready;
+    switch (f->wait_) {
+      case FLOW_WAIT_ACK: ready = bulbsAcked(f->ackMask_, f->since_); break;
+      case FLOW_WAIT_LINK: ready = networkUp(); break;
+      case FLOW_WAIT_NONE: ready = true; break;
+      default: ready = false; break;
+    }
+    if (!ready && f->wait_ != FLOW_WAIT_NONE && (int32_t)(now - f->deadline_) >= 0) {
+      ready = true;
+      f->timedOut_ = f->wait_ != FLOW_WAIT_UNTIL;
+    }
+    if (!ready) {
+      // Replies arrive on sockets that cannot wake the loop
+      if (f->wait_ == FLOW_WAIT_ACK) schedulerStayAwake(LOOP_POLL_MS);
+      continue;
+    }
+
+    f->wait_ = FLOW_WAIT_NONE;
+    f->step();
+    if (f->finished()) {
+      timerStop(&deadlines[i].timer);
+      flowPool.release(i);
+    } else if (f->wait_ == FLOW_WAIT_NONE) {
+      schedulerStayAwake(LOOP_POLL_MS);
+    } else {
+      timers.start(&deadlines[i].timer, now, (int32_t)(f->deadline_ - now) > 0 ? f->deadline_ - now : 0);
+    }
+  }
+}
+
+bool flowRunning(const char* name) {
+  for (int i = 0; i < FLOW_SLOTS; i++) {
+    Flow* f = flowPool.at(i);
+    if (f && strcmp(f->name(), name) == 0) return true;
+  }
+  return false;
+}
+
+void flowsPrintStatus() {
+  static const char* const WAIT_NAMES[] = {"running", "sleeping", "waiting for acks", "waiting for WiFi"};
+  uint32_t now = millis();
+  int running = 0;
+  for (int i = 0; i < FLOW_SLOTS; i++) {
+    Flow* f = flowPool.at(i);
+    if (!f) continue;
+    running++;
+    Serial.printf("  %-8s %s", f->name(), WAIT_NAMES[f->waiting()]);
+    if (f->waiting() != FLOW_WAIT_NONE) Serial.printf(", %ld ms left", (long)(f->deadline() - now));
+    Serial.println();
+  }
+  Serial.printf("  Flows: %d of %d frames in use (%u bytes each)\n", running, FLOW_SLOTS, (unsigned)FLOW_FRAME_BYTES);
+}
@@ -0,0 +1,146 @@
+#ifndef FLOWS_H
+#define FLOWS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+// Sequential async flows on the loop task (flows.cpp): startup, resync with
+// retries, fades, anything that reads as "do this, wait for that, then...".
+//
+// The toolchain is GCC 8 in gnu++11, which has no C++20 coroutines, so a
+// flow is a stackless coroutine in the protothread style. step() is one
+// switch on the line it last suspended at, and anything that has to survive
+// a suspension is a member of the flow, which is its frame. Frames live in
+// a fixed pool, so starting a flow never allocates.
+//
+//   struct Blink : Flow {
+//     uint8_t i;
+//     const char* name() const { return "blink"; }
+//     void step() {
+//       FLOW_BEGIN();
+//       for (i = 0; i < 3; i++) {
+//         setStudyLamp(!studyLampOn);
+//         FLOW_SLEEP(500);
+//       }
+//       FLOW_END();
+//     }
+//   };
+//   flowStart<Blink>();
+//
+// Locals in step() do not survive a FLOW_ wait, a switch statement must not
+// contain one, and there can be only one per source line (the line number
+// is the resume point). Waits that can time out set timedOut().
+
+const size_t FLOW_FRAME_BYTES = 64;
+const int FLOW_SLOTS = 4;
+const uint8_t FLOW_ALL_BULBS = 0xFF;
+
+enum FlowWait : uint8_t {
+  FLOW_WAIT_NONE,   // Run again next pass
+  FLOW_WAIT_UNTIL,  // millis() reaches deadline
+  FLOW_WAIT_ACK,    // Every bulb in ackMask confirmed state at or after since
+  FLOW_WAIT_LINK,   // Network up
+};
+
+class Flow {
+ public:
+  Flow() : line_(0), wait_(FLOW_WAIT_NONE), timedOut_(false), ackMask_(0), deadline_(0), since_(0) {}
+  virtual ~Flow() {}
+  virtual const char* name() const = 0;
+  virtual void step() = 0;
+
+  bool finished() const { return line_ < 0; }
+  FlowWait waiting() const { return wait_; }
+  uint32_t deadline() const { return deadline_; }
+
+ protected:
+  bool timedOut() const { return timedOut_; }
+  void waitUntil(uint32_t at) { wait(FLOW_WAIT_UNTIL, at); }
+  void waitAck(uint8_t bulbMask, uint32_t since, uint32_t deadline) {
+    ackMask_ = bulbMask;
+    since_ = since;
+    wait(FLOW_WAIT_ACK, deadline);
+  }
+  void waitLink(uint32_t deadline) { wait(FLOW_WAIT_LINK, deadline); }
+
+  int line_;  // Resume point, -1 when finished
+
+ private:
+  void wait(FlowWait kind, uint32_t deadline) {
+    wait_ = kind;
+    deadline_ = deadline;
+    timedOut_ = false;
+  }
+
+  FlowWait wait_;
+  bool timedOut_;
+  uint8_t ackMask_;
+  uint32_t deadline_;
+  uint32_t since_;
+
+  friend void flowsPoll();
+};
+
+uint32_t flowNow();  // millis()
+
+#define FLOW_BEGIN() switch (line_) { case 0:
+#define FLOW_SUSPEND_() line_ = __LINE__; return; case __LINE__:
+#define FLOW_YIELD() do { FLOW_SUSPEND_(); } while (0)
+#define FLOW_SLEEP_UNTIL(at) do { waitUntil(at); FLOW_SUSPEND_(); } while (0)
+#define FLOW_SLEEP(ms) FLOW_SLEEP_UNTIL(flowNow() + (ms))
+#define FLOW_AWAIT_ACK(mask, since, timeoutMs) do { waitAck((mask), (since), flowNow() + (timeoutMs)); FLOW_SUSPEND_(); } while (0)
+#define FLOW_AWAIT_LINK(timeoutMs) do { waitLink(flowNow() + (timeoutMs)); FLOW_SUSPEND_(); } while (0)
+#define FLOW_END() } line_ = -1; return
+
+// Fixed frames for flows; F must fit FLOW_FRAME_BYTES
+class FlowPool {
+ public:
+  FlowPool() {
+    for (int i = 0; i < FLOW_SLOTS; i++) flows_[i] = NULL;
+  }
+
+  template <typename F>
+  F* start() {
+    static_assert(sizeof(F) <= FLOW_FRAME_BYTES, "Flow frame does not fit FLOW_FRAME_BYTES");
+    for (int i = 0; i < FLOW_SLOTS; i++) {
+      if (flows_[i]) continue;
+      F* f = new (frames_[i].bytes) F();
+      flows_[i] = f;
+      return f;
+    }
+    return NULL;
+  }
+
+  Flow* at(int i) const { return flows_[i]; }
+
+  void release(int i) {
+    flows_[i]->~Flow();
+    flows_[i] = NULL;
+  }
+
+ private:
+  struct Frame {
+    alignas(8) unsigned char bytes[FLOW_FRAME_BYTES];
+  };
+  Frame frames_[FLOW_SLOTS];
+  Flow* flows_[FLOW_SLOTS];
+};
+
+extern FlowPool flowPool;
+
+// Start a flow at the next pass; NULL if every frame is in use. Set the
+// returned flow's parameters before the pass ends.
+template <typename F>
+F* flowStart() {
+  return flowPool.start<F>();
+}
+
+// True if every bulb in mask has confirmed state (Bulb::acked) at or after since
+bool bulbsAcked(uint8_t mask, uint32_t since);
+
+bool flowRunning(const char* name);
+void flowsPoll();  // Call every loop pass, after the inputs and before lightsFlush()
+void flowsPrintStatus();
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "log_codec.h"  // Varint helpers
+
+// Log-linear latency histogram (HDR style) for microsecond timings, shared
+// by the firmware and tools/histmerge.cpp.
+//
+// Values below HIST_SUB_BUCKETS get a bucket each. Above that, every power
+// of two is split into HIST_SUB_BUCKETS equal sub-buckets, so a bucket is
+// never wider than 1/HIST_SUB_BUCKETS of its value (12.5%) all the way up
+// to 2^32 us. record() is a count-leading-zeros and an increment: no
+// allocation and no loop. Histograms merge by adding counts.
+//
+// The struct is plain data: all zero is an empty histogram, so it can live
+// in Stats and be cleared with memset.
+//
+// Serialized form: HIST_MAGIC (4 bytes, little-endian), then varints:
+// sub-bucket bits, min, max, sum low and high 32 bits, the number of
+// non-empty buckets, then (index delta, count) for each of them.
+
+const int HIST_SUB_BITS = 3;
+const uint32_t HIST_SUB_BUCKETS = 1u << HIST_SUB_BITS;
+const int HIST_BUCKETS = (32 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS;
+const uint32_t HIST_MAGIC = 0x31485A57;  // "WZH1"
+const size_t HIST_SERIALIZED_MAX = 4 + (6 + 2 * HIST_BUCKETS) * LOG_VARINT_MAX;
+
+struct LatencyHistogram {
+  uint32_t counts[HIST_BUCKETS];
+  uint32_t total;
+  uint32_t minValue;  // Only valid when total > 0
+  uint32_t maxValue;
+  uint64_t sum;
+
+  static int bucketOf(uint32_t v) {
+    if (v < HIST_SUB_BUCKETS) return (int)v;
+    int e = 31 - __builtin_clz(v);
+    uint32_t sub = (v >> (e - HIST_SUB_BITS)) - HIST_SUB_BUCKETS;
+    return (e - HIST_SUB_BITS + 1) * (int)HIST_SUB_BUCKETS + (int)sub;
+  }
+
+  static uint32_t bucketLow(int i) {
+    if (i < (int)HIST_SUB_BUCKETS) return (uint32_t)i;
+    int e = i / HIST_SUB_BUCKETS + HIST_SUB_BITS - 1;
+    return (HIST_SUB_BUCKETS + i % HIST_SUB_BUCKETS) << (e - HIST_SUB_BITS);
+  }
+
+  static uint32_t bucketHigh(int i) {  // Inclusive
+    if (i < (int)HIST_SUB_BUCKETS) return (uint32_t)i;
+    int e = i / HIST_SUB_BUCKETS + HIST_SUB_BITS - 1;
+    return bucketLow(i) + ((1u << (e - HIST_SUB_BITS)) - 1);
+  }
+
+  void record(uint32_t v) {
+    counts[bucketOf(v)]++;
+    if (total == 0 || v < minValue) minValue = v;
+    if (v > maxValue) maxValue = v;
+    total++;
+    sum += v;
+  }
+
+  void merge(const LatencyHistogram& o) {
+    if (o.total == 0) return;
+    for (int i = 0; i < HIST_BUCKETS; i++) counts[i] += o.counts[i];
+    if (total == 0 || o.minValue < minValue) minValue = o.minValue;
+    if (o.maxValue > maxValue) maxValue = o.maxValue;
+    total += o.total;
+    sum += o.sum;
+  }
+
+  uint32_t mean() const { return total ? (uint32_t)(sum / total) : 0; }
+
+  // Smallest value at or above which no more than (100 - pct)% of the
+  // samples lie, to bucket precision: the top of the bucket holding it,
+  // clamped to the recorded min and max.
+  uint32_t percentile(float pct) const {
+    if (total == 0) return 0;
+    uint32_t rank = (uint32_t)((double)pct / 100.0 * total + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+    uint32_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+      seen += counts[i];
+      if (seen >= rank) {
+        uint32_t v = bucketHigh(i);
+        if (v > maxValue) v = maxValue;
+        return v < minValue ? minValue : v;
+      }
+    }
+    return maxValue;
+  }
+
+  size_t serialize(uint8_t* out) const {  // out must hold HIST_SERIALIZED_MAX
+    uint32_t magic = HIST_MAGIC;
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(magic >> (8 * i));
+    size_t n = 4;
+    uint32_t used = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) used += counts[i] ? 1 : 0;
+    n += logPutVarint(out + n, HIST_SUB_BITS);
+    n += logPutVarint(out + n, total ? minValue : 0);
+    n += logPutVarint(out + n, maxValue);
+    n += logPutVarint(out + n, (uint32_t)sum);
+    n += logPutVarint(out + n, (uint32_t)(sum >> 32));
+    n += logPutVarint(out + n, used);
+    int last = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+      if (!counts[i]) continue;
+      n += logPutVarint(out + n, (uint32_t)(i - last));
+      n += logPutVarint(out + n, counts[i]);
+      last = i;
+    }
+    return n;
+  }
+
+  // Replaces the contents; false (and empty) if the data is malformed or
+  // was written with another bucket layout
+  bool deserialize(const uint8_t* in, size_t len) {
+    memset(this, 0, sizeof(*this));
+    if (len < 4) return false;
+    uint32_t magic = 0;
+    for (int i = 0; i < 4; i++) magic |= (uint32_t)in[i] << (8 * i);
+    if (magic != HIST_MAGIC) return false;
+
+    size_t n = 4;
+    uint32_t header[6];
+    for (int i = 0; i < 6; i++) {
+      size_t m = logGetVarint(in + n, len - n, &header[i]);
+      if (!m) return false;
+      n += m;
+    }
+    if (header[0] != (uint32_t)HIST_SUB_BITS) return false;
+
+    int index = 0;
+    for (uint32_t k = 0; k < header[5]; k++) {
+      uint32_t delta, count;
+      size_t m = logGetVarint(in + n, len - n, &delta);
+      size_t m2 = m ? logGetVarint(in + n + m, len - n - m, &count) : 0;
+      if (!m2 || delta >= (uint32_t)(HIST_BUCKETS - index)) {
+        memset(this, 0, sizeof(*this));
+        return false;
+      }
+      n += m + m2;
+      index += (int)delta;
+      counts[index] += count;
+      total += count;
+    }
+    minValue = header[1];
+    maxValue = header[2];
+    sum = (uint64_t)header[4] << 32 | header[3];
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "hue_backend.h"
+#include "dimmer.h"
+
+bool HueLink::open() {
+  if (!connect(bridge, HUE_PORT, HUE_CONNECT_TIMEOUT_MS)) return false;
+  setNoDelay(true);
+  return true;
+}
+
+void HueLink::onConnect() {
+  stats.httpConnects++;
+}
+
+void HueLink::onRequests(int count) {
+  stats.httpRequests += count;
+}
+
+void HueLink::onResponse(uint32_t latencyUs) {
+  stats.httpResponses++;
+  stats.httpLatencyHist.record(latencyUs);
+}
+
+void HueBackend::begin() {
+  bool found = false;
+  for (int i = 0; i < BULB_COUNT; i++) {
+    if (bulbs[i].backend != BACKEND_HUE) continue;
+    setChannel(i, bulbs[i].channel);
+    if (found) continue;
+    found = true;
+    link.bridge = bulbs[i].ip;
+    char host[16];
+    snprintf(host, sizeof(host), "%u.%u.%u.%u", bulbs[i].ip[0], bulbs[i].ip[1], bulbs[i].ip[2], bulbs[i].ip[3]);
+    configure(host, hueUsername);
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef HUE_BACKEND_H
+#define HUE_BACKEND_H
+
+#include <WiFiClient.h>
+#include "hue_http.h"
+#include "lights.h"
+
+// Hue bridge backend. Every BACKEND_HUE bulb is a light on the same
+// bridge: Bulb::ip is the bridge, Bulb::channel the light number and
+// hueUsername the bridge API key. Liveness tracks the bridge, which answers
+// for its lights even when one is unplugged.
+//
+// The keep-alive connection, pipelining and requeue on reconnect are
+// HueHttp (hue_http.h); this file gives it a WiFiClient with TCP_NODELAY,
+// the Arduino clock and the Stats counters.
+
+const uint16_t HUE_PORT = 80;
+const int32_t HUE_CONNECT_TIMEOUT_MS = 250;
+
+extern const char* hueUsername;  // Defined in main.cpp from secrets.h
+
+class HueLink : public WiFiClient {
+ public:
+  IPAddress bridge;
+
+  bool open();
+  uint32_t nowMs() { return millis(); }
+  uint32_t nowUs() { return micros(); }
+  void onConnect();
+  void onRequests(int count);
+  void onResponse(uint32_t latencyUs);
+};
+
+class HueBackend : public HueHttp<HueLink, BULB_COUNT> {
+ public:
+  void begin();
+};
+
+#endif
@@ -0,0 +1,353 @@
+#ifndef HUE_HTTP_H
+#define HUE_HTTP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "backend.h"
+
+// Hue bridge HTTP transport behind HueBackend (hue_backend.h). Every bulb is
+// a light on the same bridge, addressed by its light number.
+//
+// One keep-alive connection carries every request. Up to HUE_PIPELINE_DEPTH
+// requests are written back to back without waiting for answers (HTTP/1.1
+// pipelining) and are answered in order. While the pipeline is full,
+// commands wait in a per-light CommandQueue, so a fast knob spin collapses
+// into one PUT per light per freed slot. If the bridge drops the connection,
+// unanswered requests are put back ahead of anything newer and resent after
+// reconnecting.
+//
+// The connection and the clock come from Link, which provides:
+//
+//   bool open();                              // Connect to the bridge
+//   bool connected();                         // Open, or unread data left
+//   size_t write(const uint8_t* data, size_t len);
+//   int available();
+//   int read();                               // One byte
+//   int read(uint8_t* data, size_t len);
+//   void stop();
+//   uint32_t nowMs();
+//   uint32_t nowUs();
+//   void onConnect();                         // Counters for the stats
+//   void onRequests(int count);
+//   void onResponse(uint32_t latencyUs);
+//
+// Header-only and Arduino-free so tools/huebridge.cpp can drive it against
+// its stand-in bridge.
+
+const int HUE_PIPELINE_DEPTH = 4;
+const unsigned long HUE_RECONNECT_MS = 2000;
+
+template <typename Link, int N>
+class HueHttp : public LightBackend<HueHttp<Link, N> > {
+ public:
+  Link link;
+
+  HueHttp()
+    : connectAttempted_(false), lastConnectAttempt_(0), pipelineCount_(0), txLen_(0),
+      rxLen_(0), inBody_(false), status_(0), bodyRemaining_(0) {
+    host_[0] = '\0';
+    username_ = "";
+    for (int i = 0; i < N; i++) {
+      channel_[i] = 0;
+      pendingId_[i] = 0;
+      probePending_[i] = false;
+      probeId_[i] = 0;
+    }
+  }
+
+  // host goes in the Host header; username is the bridge API key and is
+  // not copied
+  void configure(const char* host, const char* username) {
+    snprintf(host_, sizeof(host_), "%s", host);
+    username_ = username;
+  }
+
+  void setChannel(int bulb, uint8_t channel) { channel_[bulb] = channel; }
+
+  void begin() {}
+
+  bool send(int bulb, uint32_t id, const PilotCommand& cmd) {
+    if (pending_.push(bulb, cmd, priorityOf(cmd)) != CommandQueue<N>::PUSH_DROPPED) {
+      pendingId_[bulb] = id;
+    }
+    return true;  // Written by endBatch() once the pipeline has room
+  }
+
+  bool probe(int bulb, uint32_t id) {
+    probePending_[bulb] = true;
+    probeId_[bulb] = id;
+    endBatch();
+    return true;
+  }
+
+  // Fill the free pipeline slots from pending commands, then probes, and
+  // write them with a single write
+  void endBatch() {
+    bool waiting = pending_.depth() > 0;
+    for (int i = 0; i < N && !waiting; i++) waiting = probePending_[i];
+    if (!waiting) return;
+
+    if (!link.connected()) {
+      if (pipelineCount_ > 0) requeueUnanswered();
+      if (!connect()) return;
+    }
+
+    txLen_ = 0;
+    int first = pipelineCount_;
+    int bulb;
+    PilotCommand cmd;
+    while (pipelineCount_ < HUE_PIPELINE_DEPTH && pending_.pop(0, 0, &bulb, &cmd)) {
+      Request& r = pipeline_[pipelineCount_++];
+      r.bulb = bulb;
+      r.id = pendingId_[bulb];
+      r.probe = false;
+      r.cmd = cmd;
+      writeRequest(r);
+    }
+    for (int i = 0; i < N && pipelineCount_ < HUE_PIPELINE_DEPTH; i++) {
+      if (!probePending_[i]) continue;
+      probePending_[i] = false;
+      Request& r = pipeline_[pipelineCount_++];
+      r.bulb = i;
+      r.id = probeId_[i];
+      r.probe = true;
+      r.cmd = PilotCommand();
+      writeRequest(r);
+    }
+    if (txLen_ == 0) return;
+
+    uint32_t now = link.nowUs();
+    for (int i = first; i < pipelineCount_; i++) pipeline_[i].sentUs = now;
+    link.onRequests(pipelineCount_ - first);
+    if (link.write((const uint8_t*)tx_, txLen_) != txLen_) {
+      requeueUnanswered();  // Resent after the next connect
+    }
+  }
+
+  bool poll(BackendReply* reply) {
+    if (pipelineCount_ > 0 && !link.connected()) {
+      requeueUnanswered();
+    }
+
+    bool success;
+    if (pipelineCount_ == 0 || !readResponse(&success)) {
+      endBatch();  // Retry the connection if commands are waiting on it
+      return false;
+    }
+
+    Request r = pipeline_[0];
+    pipelineCount_--;
+    memmove(&pipeline_[0], &pipeline_[1], sizeof(Request) * pipelineCount_);
+
+    link.onResponse(link.nowUs() - r.sentUs);
+
+    reply->bulb = r.bulb;
+    reply->hasId = true;
+    reply->id = r.id;
+    reply->success = success;
+    reply->state = PilotCommand();
+    if (r.probe && success) parseState(rx_, &reply->state);
+
+    endBatch();  // A slot is free: send what was waiting for it
+    return true;
+  }
+
+  int inFlight() const { return pipelineCount_; }
+
+ private:
+  struct Request {
+    int bulb;
+    uint32_t id;
+    bool probe;
+    PilotCommand cmd;
+    uint32_t sentUs;
+  };
+
+  static CommandPriority priorityOf(const PilotCommand& cmd) {
+    return (cmd.fields & PILOT_STATE) ? PRIORITY_CONTROL : PRIORITY_STREAM;
+  }
+
+  // Hue brightness is 1-254; color temperature is in mireds, 153-500
+  static int hueBrightness(int dimming) {
+    int bri = (dimming * 254 + 50) / 100;
+    return bri < 1 ? 1 : bri;
+  }
+
+  static int hueMireds(int kelvin) {
+    int ct = kelvin ? 1000000 / kelvin : 370;
+    return ct < 153 ? 153 : ct > 500 ? 500 : ct;
+  }
+
+  // Probe response: {"state":{"on":true,"bri":127,...,"ct":370,...},...}
+  static void parseState(const char* body, PilotCommand* state) {
+    const char* on = strstr(body, "\"on\":");
+    if (!on) return;
+    state->fields = PILOT_STATE;
+    state->on = strncmp(on + 5, "true", 4) == 0;
+    const char* bri = strstr(body, "\"bri\":");
+    if (bri) {
+      int dimming = atoi(bri + 6) * 100 / 254;
+      state->fields |= PILOT_DIMMING;
+      state->dimming = (uint8_t)(dimming < 1 ? 1 : dimming);
+    }
+    const char* ct = strstr(body, "\"ct\":");
+    if (ct && atoi(ct + 5) > 0) {
+      state->fields |= PILOT_TEMP;
+      state->temp = (uint16_t)(1000000 / atoi(ct + 5));
+    }
+  }
+
+  static const char* findHeader(const char* headers, const char* name) {
+    size_t len = strlen(name);
+    for (const char* p = strstr(headers, "\r\n"); p; p = strstr(p + 2, "\r\n")) {
+      if (strncasecmp(p + 2, name, len) == 0 && p[2 + len] == ':') return p + 3 + len;
+    }
+    return NULL;
+  }
+
+  bool connect() {
+    uint32_t now = link.nowMs();
+    if (connectAttempted_ && now - lastConnectAttempt_ < HUE_RECONNECT_MS) return false;
+    connectAttempted_ = true;
+    lastConnectAttempt_ = now;
+
+    rxLen_ = 0;
+    inBody_ = false;
+    if (!link.open()) return false;
+    link.onConnect();
+    return true;
+  }
+
+  // Connection lost: everything written but unanswered goes back in front
+  // of commands that were still waiting, so merging keeps the newest values
+  void requeueUnanswered() {
+    CommandQueue<N> newer = pending_;
+    uint32_t newerId[N];
+    memcpy(newerId, pendingId_, sizeof(newerId));
+    pending_ = CommandQueue<N>();
+
+    for (int i = 0; i < pipelineCount_; i++) {
+      const Request& r = pipeline_[i];
+      if (r.probe) {
+        probePending_[r.bulb] = true;
+        probeId_[r.bulb] = r.id;
+      } else if (pending_.push(r.bulb, r.cmd, priorityOf(r.cmd)) != CommandQueue<N>::PUSH_DROPPED) {
+        pendingId_[r.bulb] = r.id;
+      }
+    }
+    pipelineCount_ = 0;
+
+    int bulb;
+    PilotCommand cmd;
+    while (newer.pop(0, 0, &bulb, &cmd)) {
+      if (pending_.push(bulb, cmd, priorityOf(cmd)) != CommandQueue<N>::PUSH_DROPPED) {
+        pendingId_[bulb] = newerId[bulb];
+      }
+    }
+    link.stop();
+  }
+
+  void writeRequest(const Request& r) {
+    char* out = tx_ + txLen_;
+    size_t room = sizeof(tx_) - txLen_;
+
+    int n;
+    if (r.probe) {
+      n = snprintf(out, room, "GET /api/%s/lights/%u HTTP/1.1\r\nHost: %s\r\n\r\n",
+        username_, channel_[r.bulb], host_);
+    } else {
+      // Like WiZ, dimming or temp alone switches the light on
+      const PilotCommand& cmd = r.cmd;
+      bool on = (cmd.fields & PILOT_STATE) ? cmd.on : true;
+      char body[48];
+      int m = snprintf(body, sizeof(body), "{\"on\":%s", on ? "true" : "false");
+      if (on && (cmd.fields & PILOT_DIMMING)) {
+        m += snprintf(body + m, sizeof(body) - m, ",\"bri\":%d", hueBrightness(cmd.dimming));
+      }
+      if (on && (cmd.fields & PILOT_TEMP)) {
+        m += snprintf(body + m, sizeof(body) - m, ",\"ct\":%d", hueMireds(cmd.temp));
+      }
+      snprintf(body + m, sizeof(body) - m, "}");
+      n = snprintf(out, room,
+        "PUT /api/%s/lights/%u/state HTTP/1.1\r\nHost: %s\r\n"
+        "Content-Type: application/json\r\nContent-Length: %u\r\n\r\n%s",
+        username_, channel_[r.bulb], host_, (unsigned)strlen(body), body);
+    }
+    if (n > 0 && (size_t)n < room) txLen_ += n;
+  }
+
+  // Consume one response; false until a complete one has arrived
+  bool readResponse(bool* success) {
+    if (!inBody_) {
+      while (link.available() && rxLen_ < sizeof(rx_) - 1) {
+        rx_[rxLen_++] = (char)link.read();
+        if (rxLen_ >= 4 && memcmp(rx_ + rxLen_ - 4, "\r\n\r\n", 4) == 0) break;
+      }
+      rx_[rxLen_] = '\0';
+      if (rxLen_ < 4 || memcmp(rx_ + rxLen_ - 4, "\r\n\r\n", 4) != 0) {
+        if (rxLen_ == sizeof(rx_) - 1) link.stop();  // Oversized headers: cannot resync
+        return false;
+      }
+
+      status_ = strncmp(rx_, "HTTP/1.", 7) == 0 ? atoi(rx_ + 9) : 0;
+      const char* length = findHeader(rx_, "Content-Length");
+      if (!length) {
+        link.stop();  // No way to find where the next response starts
+        return false;
+      }
+      bodyRemaining_ = atol(length);
+      inBody_ = true;
+      rxLen_ = 0;
+    }
+
+    // Only the start of the body matters: errors come back as [{"error":...}]
+    while (bodyRemaining_ > 0 && link.available()) {
+      uint8_t chunk[64];
+      size_t want = bodyRemaining_ < (long)sizeof(chunk) ? (size_t)bodyRemaining_ : sizeof(chunk);
+      int n = link.read(chunk, want);
+      if (n <= 0) break;
+      if (rxLen_ < sizeof(rx_) - 1) {
+        size_t keep = sizeof(rx_) - 1 - rxLen_ < (size_t)n ? sizeof(rx_) - 1 - rxLen_ : (size_t)n;
+        memcpy(rx_ + rxLen_, chunk, keep);
+        rxLen_ += keep;
+      }
+      bodyRemaining_ -= n;
+    }
+    if (bodyRemaining_ > 0) return false;
+
+    rx_[rxLen_] = '\0';
+    *success = status_ == 200 && !strstr(rx_, "\"error\"");
+    inBody_ = false;
+    rxLen_ = 0;
+    return true;
+  }
+
+  char host_[16];
+  const char* username_;
+  uint8_t channel_[N];
+  bool connectAttempted_;
+  uint32_t lastConnectAttempt_;
+
+  CommandQueue<N> pending_;  // Not yet written, merged per light
+  uint32_t pendingId_[N];    // ID of the newest command merged into each slot
+  bool probePending_[N];
+  uint32_t probeId_[N];
+
+  Request pipeline_[HUE_PIPELINE_DEPTH];  // Written, oldest first
+  int pipelineCount_;
+
+  char tx_[HUE_PIPELINE_DEPTH * 256];
+  size_t txLen_;
+
+  // Response parser: headers are buffered, bodies are skipped after the
+  // first sizeof(rx_) bytes
+  char rx_[256];
+  size_t rxLen_;
+  bool inBody_;
+  int status_;
+  long bodyRemaining_;
+};
+
+#endif
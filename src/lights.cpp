@@ -0,0 +1,413 @@
+#include "lights.h"
+#include "dimmer.h"
+#include "command_queue.h"
+#include "wiz_backend.h"
+#include "hue_backend.h"
+#include "loopback_backend.h"
+#include "scheduler.h"
+
+static CommandQueue<BULB_COUNT> queue;
+static WizBackend wiz;
+static HueBackend hue;
+static LoopbackBackend<BULB_COUNT> loopback;
+
+uint32_t messageId = 1;
+uint32_t stateCacheTtlMs = DEFAULT_STATE_CACHE_TTL_MS;
+static bool linkUp = true;
+
+// Queue a command; the packet goes out from lightsFlush()
+static void queueCommand(int bulb, const PilotCommand& cmd, CommandPriority priority) {
+  switch (queue.push(bulb, cmd, priority)) {
+    case CommandQueue<BULB_COUNT>::PUSH_MERGED: stats.commandsCoalesced++; break;
+    case CommandQueue<BULB_COUNT>::PUSH_DROPPED: stats.commandsDropped++; break;
+    default: break;
+  }
+}
+
+void sendLightCommand(int bulb, bool state, int brightness) {
+  Bulb& b = bulbs[bulb];
+  b.desiredOn = state;
+  if (state) b.desiredDimming = brightness;
+
+  PilotCommand cmd = {};
+  cmd.fields = PILOT_STATE;
+  cmd.on = state;
+  if (state) {
+    cmd.fields |= PILOT_DIMMING;
+    cmd.dimming = (uint8_t)brightness;
+    if (b.desiredTemp) {
+      // A queued temp change may have been replaced by an intervening "off"
+      cmd.fields |= PILOT_TEMP;
+      cmd.temp = (uint16_t)b.desiredTemp;
+    }
+  }
+  queueCommand(bulb, cmd, PRIORITY_CONTROL);
+}
+
+void streamLightBrightness(int bulb, int brightness) {
+  Bulb& b = bulbs[bulb];
+  b.desiredDimming = brightness;
+  if (!b.alive) {
+    stats.streamSuppressed++;
+    return;
+  }
+
+  PilotCommand cmd = {};
+  cmd.fields = PILOT_DIMMING;
+  cmd.dimming = (uint8_t)brightness;
+  queueCommand(bulb, cmd, PRIORITY_STREAM);
+}
+
+void sendLightColorTemp(int bulb, int brightness, int colorTemp) {
+  Bulb& b = bulbs[bulb];
+  b.desiredDimming = brightness;
+  b.desiredTemp = colorTemp;
+  if (!b.alive) {
+    stats.streamSuppressed++;
+    return;
+  }
+
+  PilotCommand cmd = {};
+  cmd.fields = PILOT_DIMMING | PILOT_TEMP;
+  cmd.dimming = (uint8_t)brightness;
+  cmd.temp = (uint16_t)colorTemp;
+  queueCommand(bulb, cmd, PRIORITY_STREAM);
+}
+
+void sendLightPilot(int bulb, const PilotCommand& pilot) {
+  Bulb& b = bulbs[bulb];
+  PilotCommand cmd = pilot;
+  if (!(cmd.fields & PILOT_STATE) && !b.desiredOn) {
+    // Switches the bulb on; make it explicit so the queue does not drop it as a stray stream update
+    cmd.fields |= PILOT_STATE;
+    cmd.on = true;
+  }
+  if (cmd.fields & PILOT_STATE) b.desiredOn = cmd.on;
+  if (cmd.fields & PILOT_DIMMING) b.desiredDimming = cmd.dimming;
+  if (cmd.fields & PILOT_TEMP) b.desiredTemp = cmd.temp;
+
+  if (cmd.fields & PILOT_STATE) {
+    queueCommand(bulb, cmd, PRIORITY_CONTROL);
+    return;
+  }
+  if (!b.alive) {
+    stats.streamSuppressed++;
+    return;
+  }
+  queueCommand(bulb, cmd, PRIORITY_STREAM);
+}
+
+// Bulb answered after being marked dead: push everything it missed in one packet
+static void restoreBulb(int bulb) {
+  Bulb& b = bulbs[bulb];
+  PilotCommand cmd = {};
+  cmd.fields = PILOT_STATE;
+  cmd.on = b.desiredOn;
+  if (b.desiredOn) {
+    cmd.fields |= PILOT_DIMMING;
+    cmd.dimming = (uint8_t)b.desiredDimming;
+    if (b.desiredTemp) {
+      cmd.fields |= PILOT_TEMP;
+      cmd.temp = (uint16_t)b.desiredTemp;
+    }
+  }
+  queueCommand(bulb, cmd, PRIORITY_CONTROL);
+}
+
+// True if the bulb already confirmed every field of cmd and nothing it sent since is unanswered
+static bool isRedundant(const Bulb& b, const PilotCommand& cmd, unsigned long now) {
+  if (stateCacheTtlMs == 0 || b.inFlightCount > 0 || now - b.ackedAt >= stateCacheTtlMs) return false;
+  if ((b.acked.fields & cmd.fields) != cmd.fields) return false;
+
+  if (cmd.fields & PILOT_STATE) {
+    if (cmd.on != b.acked.on) return false;
+  } else if (!(b.acked.fields & PILOT_STATE) || !b.acked.on) {
+    return false;  // Dimming/temp alone would switch the bulb on
+  }
+  if ((cmd.fields & PILOT_DIMMING) && cmd.dimming != b.acked.dimming) return false;
+  if ((cmd.fields & PILOT_TEMP) && cmd.temp != b.acked.temp) return false;
+  return true;
+}
+
+static void applyAck(Bulb& b, const PilotCommand& cmd, unsigned long now) {
+  b.acked.fields |= cmd.fields | PILOT_STATE;
+  b.acked.on = (cmd.fields & PILOT_STATE) ? cmd.on : true;
+  if (cmd.fields & PILOT_DIMMING) b.acked.dimming = cmd.dimming;
+  if (cmd.fields & PILOT_TEMP) b.acked.temp = cmd.temp;
+  b.ackedAt = now;
+}
+
+static void trackInFlight(Bulb& b, uint32_t id, const PilotCommand& cmd, unsigned long now) {
+  if (b.inFlightCount == IN_FLIGHT_MAX) {
+    memmove(&b.inFlight[0], &b.inFlight[1], sizeof(InFlight) * (IN_FLIGHT_MAX - 1));
+    b.inFlightCount--;
+  }
+  InFlight& f = b.inFlight[b.inFlightCount++];
+  f.id = id;
+  f.cmd = cmd;
+  f.sentAt = now;
+  f.sentUs = micros();
+}
+
+static void removeInFlight(Bulb& b, int index) {
+  memmove(&b.inFlight[index], &b.inFlight[index + 1], sizeof(InFlight) * (b.inFlightCount - index - 1));
+  b.inFlightCount--;
+}
+
+// Liveness counts from the oldest unanswered send
+static void startReplyTimer(Bulb& b, unsigned long now) {
+  if (!b.awaitingReply) {
+    b.awaitingReply = true;
+    b.sentAt = now;
+  }
+}
+
+// Bookkeeping for one entry of a sent batch
+static void noteSent(const BatchEntry& e, unsigned long now) {
+  Bulb& b = bulbs[e.bulb];
+  if (!e.sent) {
+    stats.sendErrors++;
+    logMsg<LOG_SEND_FAILED>(b.ip);
+    return;
+  }
+  stats.packetsSent++;
+  startReplyTimer(b, now);
+
+  const PilotCommand& cmd = e.cmd;
+  trackInFlight(b, e.id, cmd, now);
+  if (cmd.fields == PILOT_DIMMING) {
+    logMsg<LOG_SENT_DIMMING>(b.ip, e.id, cmd.dimming);
+  } else if (cmd.fields == (PILOT_DIMMING | PILOT_TEMP)) {
+    logMsg<LOG_SENT_TEMP>(b.ip, e.id, cmd.dimming, cmd.temp);
+  } else if (cmd.fields & PILOT_TEMP) {
+    logMsg<LOG_SENT_PILOT>(b.ip, e.id, cmd.on, cmd.dimming, cmd.temp);
+  } else {
+    logMsg<LOG_SENT_POWER>(b.ip, e.id, cmd.on, cmd.on ? cmd.dimming : 0);
+  }
+}
+
+template <typename Backend>
+static void sendBatch(Backend& backend, BatchEntry* entries, int count, unsigned long now) {
+  if (count == 0) return;
+  backend.sendBatch(entries, count);
+  for (int i = 0; i < count; i++) {
+    noteSent(entries[i], now);
+  }
+}
+
+static bool probeBulb(int bulb, uint32_t id) {
+  switch (bulbs[bulb].backend) {
+    case BACKEND_HUE: return hue.probe(bulb, id);
+    case BACKEND_LOOPBACK: return loopback.probe(bulb, id);
+    default: return wiz.probe(bulb, id);
+  }
+}
+
+static void sendProbe(int bulb, unsigned long now) {
+  Bulb& b = bulbs[bulb];
+  b.lastProbe = now;
+  uint32_t id = messageId++;
+  if (probeBulb(bulb, id)) {
+    stats.packetsSent++;
+    stats.probesSent++;
+    startReplyTimer(b, now);
+    logMsg<LOG_SENT_PROBE>(b.ip, id);
+  } else {
+    stats.sendErrors++;
+    logMsg<LOG_SEND_FAILED>(b.ip);
+  }
+}
+
+void lightsRefresh(int bulb) {
+  bulbs[bulb].refreshRequested = true;
+}
+
+void lightsFlush() {
+  if (!linkUp) return;  // Hold everything until the network is back
+  uint32_t start = micros();
+
+  // A bulb has one queue slot, so a pass sends at most one command per bulb
+  BatchEntry batches[BACKEND_KIND_COUNT][BULB_COUNT];
+  int counts[BACKEND_KIND_COUNT] = {};
+  int batched = 0;
+  PassPackets<BULB_COUNT> pass;
+
+  int bulb;
+  PilotCommand cmd;
+  unsigned long now = millis();
+  while (queue.pop(now, brightnessIntervalMs, &bulb, &cmd)) {
+    if (isRedundant(bulbs[bulb], cmd, now)) {
+      stats.redundantSkipped++;
+      continue;
+    }
+    BackendKind kind = bulbs[bulb].backend;
+    BatchEntry& e = batches[kind][counts[kind]++];
+    e.bulb = bulb;
+    e.id = messageId++;
+    e.cmd = cmd;
+    e.sent = false;
+    pass.command(bulb);
+    batched++;
+  }
+
+  sendBatch(wiz, batches[BACKEND_WIZ], counts[BACKEND_WIZ], now);
+  sendBatch(hue, batches[BACKEND_HUE], counts[BACKEND_HUE], now);
+  sendBatch(loopback, batches[BACKEND_LOOPBACK], counts[BACKEND_LOOPBACK], now);
+  if (batched) {
+    stats.batches++;
+    stats.batchedCommands += batched;
+    stats.flushHist.record(micros() - start);
+  }
+
+  // Probes go last, once every command of the pass is known. Refresh: a
+  // command's ack refreshes the cache too, otherwise probe.
+  for (int i = 0; i < BULB_COUNT; i++) {
+    if (!bulbs[i].refreshRequested) continue;
+    bulbs[i].refreshRequested = false;
+    if (pass.probe(i)) sendProbe(i, now);
+  }
+
+  // Dead bulbs: a packet already going to the bulb doubles as the probe
+  for (int i = 0; i < BULB_COUNT; i++) {
+    Bulb& b = bulbs[i];
+    if (b.alive || now - b.lastProbe < PROBE_INTERVAL_MS) continue;
+    if (pass.probe(i)) {
+      sendProbe(i, now);
+    } else {
+      b.lastProbe = now;
+    }
+  }
+
+  // Replies, ack timeouts and held-back stream updates are found by polling.
+  // Dead-bulb probes are not: the idle loop still runs often enough for them.
+  bool busy = queue.depth() > 0;
+  for (int i = 0; i < BULB_COUNT && !busy; i++) {
+    busy = bulbs[i].awaitingReply || bulbs[i].inFlightCount;
+  }
+  if (busy) schedulerStayAwake(LOOP_POLL_MS);
+}
+
+void lightsSetLinkUp(bool up) {
+  if (up == linkUp) return;
+  linkUp = up;
+  if (!up) return;
+  for (int i = 0; i < BULB_COUNT; i++) {
+    Bulb& b = bulbs[i];
+    b.awaitingReply = false;  // Replies sent while we were off the network are gone
+    if (b.inFlightCount) {
+      b.inFlightCount = 0;
+      restoreBulb(i);
+    }
+  }
+}
+
+void lightsInvalidateCache() {
+  for (int i = 0; i < BULB_COUNT; i++) {
+    bulbs[i].acked.fields = 0;
+  }
+}
+
+// Reply to a setPilot we sent: confirm the matching command. Replies without
+// an ID are matched to the oldest outstanding command.
+static void matchReply(Bulb& b, const BackendReply& reply, unsigned long now) {
+  if (b.inFlightCount == 0) return;
+
+  int match = 0;
+  if (reply.hasId) {
+    match = -1;
+    for (int i = 0; i < b.inFlightCount; i++) {
+      if (b.inFlight[i].id == reply.id) match = i;
+    }
+    if (match < 0) return;  // Probe or a reply to a command we already gave up on
+  }
+
+  stats.ackRttHist.record(micros() - b.inFlight[match].sentUs);
+  if (reply.success) {
+    applyAck(b, b.inFlight[match].cmd, now);
+  }
+  removeInFlight(b, match);
+}
+
+// Any reply from a bulb proves it is alive
+static void handleReply(const BackendReply& reply, unsigned long now) {
+  stats.packetsReceived++;
+  Bulb& b = bulbs[reply.bulb];
+  if (reply.state.fields && b.inFlightCount == 0) {
+    b.acked = reply.state;  // Probe reply: what the bulb is actually doing
+    b.ackedAt = now;
+  }
+  matchReply(b, reply, now);
+  b.lastSeen = now;
+  b.awaitingReply = false;
+  b.misses = 0;
+  if (!b.alive) {
+    b.alive = true;
+    logMsg<LOG_BULB_ALIVE>(b.ip);
+    restoreBulb(reply.bulb);
+  }
+}
+
+template <typename Backend>
+static void drainReplies(Backend& backend, unsigned long now) {
+  BackendReply reply;
+  while (backend.poll(&reply)) {
+    handleReply(reply, now);
+  }
+}
+
+void lightsBegin() {
+  for (int i = 0; i < BULB_COUNT; i++) {
+    bulbs[i].alive = true;
+    bulbs[i].desiredDimming = brightness;
+  }
+  wiz.begin();
+  hue.begin();
+  loopback.begin();
+}
+
+unsigned long lightsDiscoverStart() {
+  // The probes go out with this pass's lightsFlush(), like any refresh
+  for (int i = 0; i < BULB_COUNT; i++) lightsRefresh(i);
+  return millis();
+}
+
+int lightsDiscoverFinish(unsigned long since) {
+  int reported = 0;
+  for (int i = 0; i < BULB_COUNT; i++) {
+    Bulb& b = bulbs[i];
+    if ((long)(b.ackedAt - since) < 0 || !(b.acked.fields & PILOT_STATE)) continue;
+    reported++;
+    b.desiredOn = b.acked.on;
+    if (b.acked.fields & PILOT_DIMMING) b.desiredDimming = b.acked.dimming;
+    if (b.acked.fields & PILOT_TEMP) b.desiredTemp = b.acked.temp;
+  }
+  logMsg<LOG_DISCOVERY>(reported, BULB_COUNT, millis() - since);
+  return reported;
+}
+
+void lightsPoll() {
+  unsigned long now = millis();
+  drainReplies(wiz, now);
+  drainReplies(hue, now);
+  drainReplies(loopback, now);
+  if (!linkUp) return;
+
+  for (int i = 0; i < BULB_COUNT; i++) {
+    Bulb& b = bulbs[i];
+
+    while (b.inFlightCount > 0 && now - b.inFlight[0].sentAt >= ACK_TIMEOUT_MS) {
+      removeInFlight(b, 0);
+    }
+
+    if (b.awaitingReply && now - b.sentAt >= ACK_TIMEOUT_MS) {
+      b.awaitingReply = false;
+      stats.acksMissed++;
+      if (b.alive && ++b.misses >= DEAD_AFTER_MISSES) {
+        b.alive = false;
+        b.lastProbe = now;
+        b.acked.fields = 0;  // It may come back in any state (e.g. power-cycled at the wall)
+        logMsg<LOG_BULB_DEAD>(b.ip, b.misses);
+      }
+    }
+  }
+}
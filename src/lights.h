@@ -0,0 +1,107 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <Arduino.h>
+#include "command_queue.h"
+#include "backend.h"
+
+// Bulb table, command queue, state cache and per-bulb liveness (lights.cpp).
+// The wire protocol of each bulb is its backend (see backend.h).
+
+// Liveness: a send with no reply within ACK_TIMEOUT_MS is a miss. After
+// DEAD_AFTER_MISSES misses in a row streaming updates stop and the bulb is
+// probed (getPilot on WiZ) every PROBE_INTERVAL_MS until it answers.
+const unsigned long ACK_TIMEOUT_MS = 1000;
+const uint8_t DEAD_AFTER_MISSES = 3;
+const unsigned long PROBE_INTERVAL_MS = 5000;
+
+// Commands identical to the last state a bulb acknowledged are not sent.
+// The cache is trusted for stateCacheTtlMs after the ack (0 = never skip),
+// so a change made from the WiZ app is overwritten at the next refresh.
+const unsigned long DEFAULT_STATE_CACHE_TTL_MS = 300000;
+const int IN_FLIGHT_MAX = 4;
+
+struct InFlight {
+  uint32_t id;
+  PilotCommand cmd;
+  unsigned long sentAt;
+  uint32_t sentUs;  // micros(), for the ack round-trip histogram
+};
+
+enum BulbIndex {
+  BULB_STUDY = 0,
+  BULB_UPLIGHT = 1,
+  BULB_COUNT
+};
+
+struct Bulb {
+  const char* name;
+  IPAddress ip;
+  BackendKind backend;       // Defaults to BACKEND_WIZ
+  uint8_t channel;           // Light number behind a bridge (Hue)
+
+  // Desired state, recorded even while the bulb is not responding
+  bool desiredOn;
+  int desiredDimming;
+  int desiredTemp;           // 0 = never set
+
+  // Liveness
+  bool alive;
+  uint8_t misses;
+  bool awaitingReply;
+  unsigned long sentAt;      // Oldest unanswered send
+  unsigned long lastSeen;
+  unsigned long lastProbe;
+  bool refreshRequested;     // Probe at the next flush unless a command goes out
+
+  // Last state confirmed by the bulb (fields = known PilotField bits)
+  PilotCommand acked;
+  unsigned long ackedAt;
+  InFlight inFlight[IN_FLIGHT_MAX];  // Sent setPilots awaiting a reply, oldest first
+  uint8_t inFlightCount;
+};
+
+extern Bulb bulbs[BULB_COUNT];  // Defined in main.cpp from secrets.h
+extern uint32_t messageId;      // Message counter for WiZ protocol
+extern uint32_t stateCacheTtlMs;
+
+void lightsBegin();
+void lightsPoll();   // Drain replies and run liveness timers; call at the start of a loop pass
+void lightsFlush();  // Send queued commands that are due, one batch per backend; call at the end of a loop pass
+void lightsInvalidateCache();  // Next command to every bulb is sent even if redundant
+
+// Network link state (network.cpp). While down, lightsFlush() keeps commands
+// queued (they keep merging) and lightsPoll() pauses the liveness timers, so
+// the outage is not blamed on the bulbs. When it comes back, bulbs with
+// sends that were never answered get their desired state again.
+void lightsSetLinkUp(bool up);
+
+// Boot-time state discovery, run by the startup flow in main.cpp: probe
+// every bulb at once, wait (FLOW_AWAIT_ACK) until all have answered or
+// DISCOVERY_TIMEOUT_MS passes, then finish. Reported state lands in
+// Bulb::acked and the desired* fields; finish returns how many reported.
+const unsigned long DISCOVERY_TIMEOUT_MS = 500;
+unsigned long lightsDiscoverStart();  // Probes at this pass's flush; returns the start time
+int lightsDiscoverFinish(unsigned long since);
+
+// Ask a bulb for its current state (getPilot on WiZ) at the next
+// lightsFlush(). If a command goes to the bulb in that pass its ack updates
+// Bulb::acked instead, keeping to one packet per bulb per pass. Either way
+// Bulb::ackedAt moves forward when the answer arrives.
+void lightsRefresh(int bulb);
+
+// Commands are queued (see command_queue.h) and sent by lightsFlush().
+// On/off is control priority and goes out even to a dead bulb (it doubles as
+// a probe). Streaming updates are rate limited by brightnessIntervalMs and
+// are recorded but not sent while the bulb is dead.
+void sendLightCommand(int bulb, bool state, int brightness);
+void streamLightBrightness(int bulb, int brightness);
+void sendLightColorTemp(int bulb, int brightness, int colorTemp);
+
+// Arbitrary setPilot fields from another client (proxy.cpp), merged into the
+// desired state. With a "state" field it is control priority, otherwise a
+// streaming update. Dimming or temp alone switches an off bulb on, as on
+// WiZ.
+void sendLightPilot(int bulb, const PilotCommand& cmd);
+
+#endif
@@ -0,0 +1,27 @@
+#include <Arduino.h>
+#include "log.h"
+#include "dimmer.h"
+
+uint8_t logLevel = LOG_DEBUG;
+
+void logWrite(LogMsgId id, const uint32_t* args, uint8_t argc) {
+#ifdef LOG_DEFERRED
+  uint8_t frame[2 + LOG_MAX_ARGS * LOG_VARINT_MAX];
+  size_t n = 0;
+  frame[n++] = LOG_FRAME_SYNC;
+  frame[n++] = id;
+  for (uint8_t i = 0; i < argc; i++) {
+    n += logPutVarint(frame + n, args[i]);
+  }
+  Serial.write(frame, n);
+#else
+  // One write per line, so lines from the event log task and the loop never interleave
+  char text[162];
+  size_t n = logFormat(text, sizeof(text) - 2, LOG_MSG_FORMATS[id], args, argc);
+  text[n++] = '\r';
+  text[n++] = '\n';
+  Serial.write((const uint8_t*)text, n);
+#endif
+  __atomic_fetch_add(&stats.logEvents, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&stats.logBytes, n, __ATOMIC_RELAXED);
+}
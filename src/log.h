@@ -0,0 +1,52 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include "log_codec.h"
+#include "log_messages.h"
+
+// Structured logging: each event is a message ID from log_messages.h plus
+// integer arguments. Default builds print the formatted text; builds with
+// -D LOG_DEFERRED emit compact binary frames for tools/logdecode.cpp.
+//
+//   logMsg<LOG_BRIGHTNESS>(brightness);
+
+enum LogLevel : uint8_t {
+  LOG_ERROR = 0,
+  LOG_INFO = 1,
+  LOG_DEBUG = 2,
+};
+extern uint8_t logLevel;
+
+enum LogMsgId : uint8_t {
+#define X(id, level, fmt) id,
+  LOG_MESSAGES(X)
+#undef X
+  LOG_MSG_COUNT
+};
+
+constexpr uint8_t LOG_MSG_LEVELS[] = {
+#define X(id, level, fmt) level,
+  LOG_MESSAGES(X)
+#undef X
+};
+
+// Only referenced in constant expressions unless formatting on the device
+constexpr const char* LOG_MSG_FORMATS[] = {
+#define X(id, level, fmt) fmt,
+  LOG_MESSAGES(X)
+#undef X
+};
+
+void logWrite(LogMsgId id, const uint32_t* args, uint8_t argc);
+
+template <LogMsgId Id, typename... Args>
+inline void logMsg(Args... args) {
+  static_assert(sizeof...(Args) == logArgCount(LOG_MSG_FORMATS[Id]), "log argument count does not match format");
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+  if (LOG_MSG_LEVELS[Id] > logLevel) return;
+  const uint32_t argv[] = {0, (uint32_t)args...};
+  logWrite(Id, argv + 1, sizeof...(Args));
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Wire format and text rendering shared by the firmware and tools/logdecode.cpp.
+//
+// A deferred log frame is LOG_FRAME_SYNC, the message ID, then one LEB128
+// varint per argument. The argument count comes from the format string, so
+// frames carry no length. 0xFF never appears in ASCII/UTF-8 text, which lets
+// frames interleave with plain Serial output.
+
+const uint8_t LOG_FRAME_SYNC = 0xFF;
+const int LOG_MAX_ARGS = 6;
+const int LOG_VARINT_MAX = 5;
+
+inline size_t logPutVarint(uint8_t* out, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+// Returns bytes consumed, or 0 if the buffer ends mid-varint / it is malformed
+inline size_t logGetVarint(const uint8_t* in, size_t len, uint32_t* v) {
+  uint32_t result = 0;
+  for (size_t i = 0; i < len && i < (size_t)LOG_VARINT_MAX; i++) {
+    result |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+    if (!(in[i] & 0x80)) {
+      *v = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+constexpr int logArgCount(const char* s) {
+  return *s == '\0' ? 0
+       : (s[0] == '%' && s[1] == '%') ? logArgCount(s + 2)
+       : (s[0] == '%') ? 1 + logArgCount(s + 1)
+       : logArgCount(s + 1);
+}
+
+// Render a message into out (always NUL-terminated). Returns the text length.
+inline size_t logFormat(char* out, size_t size, const char* fmt, const uint32_t* args, int argc) {
+  size_t n = 0;
+  int arg = 0;
+  for (const char* p = fmt; *p && n + 1 < size; p++) {
+    if (*p != '%') {
+      out[n++] = *p;
+      continue;
+    }
+    char spec = *++p;
+    if (spec == '\0') break;
+    if (spec == '%') {
+      out[n++] = '%';
+      continue;
+    }
+    uint32_t v = arg < argc ? args[arg] : 0;
+    arg++;
+    int w;
+    switch (spec) {
+      case 'd': w = snprintf(out + n, size - n, "%ld", (long)(int32_t)v); break;
+      case 'u': w = snprintf(out + n, size - n, "%lu", (unsigned long)v); break;
+      case 'x': w = snprintf(out + n, size - n, "%lx", (unsigned long)v); break;
+      case 'b': w = snprintf(out + n, size - n, "%s", v ? "ON" : "OFF"); break;
+      case 'I':  // IPAddress stores the first octet in the low byte
+        w = snprintf(out + n, size - n, "%u.%u.%u.%u",
+          (unsigned)(v & 0xFF), (unsigned)((v >> 8) & 0xFF),
+          (unsigned)((v >> 16) & 0xFF), (unsigned)(v >> 24));
+        break;
+      default: w = snprintf(out + n, size - n, "%%%c", spec); break;
+    }
+    if (w < 0) break;
+    n += (size_t)w;
+    if (n >= size) n = size - 1;
+  }
+  out[n] = '\0';
+  return n;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+// Log message table: X(id, level, format)
+//
+// The firmware only uses the IDs and levels; with LOG_DEFERRED the format
+// strings never reach flash and tools/logdecode.cpp renders them on the host.
+// Append new messages at the end so IDs in old captures keep decoding.
+//
+// Format specifiers: %d signed, %u unsigned, %x hex, %I IPv4 address, %b ON/OFF
+#define LOG_MESSAGES(X) \
+  X(LOG_SEND_FAILED,    LOG_ERROR, "   ERROR: UDP send failed to %I") \
+  X(LOG_SENT_POWER,     LOG_DEBUG, "Sent to %I [ID:%u]: setPilot state=%b dimming=%d") \
+  X(LOG_SENT_TEMP,      LOG_DEBUG, "Sent to %I [ID:%u]: setPilot dimming=%d temp=%u") \
+  X(LOG_BRIGHTNESS,     LOG_INFO,  "Brightness: %d") \
+  X(LOG_BOTH_OFF,       LOG_INFO,  "  (Both lights OFF - brightness will apply when turned ON)") \
+  X(LOG_COLOR_TEMP,     LOG_INFO,  "Color temp: %uK") \
+  X(LOG_BOTH_TOGGLE,    LOG_INFO,  "Encoder button double-click: Turn both lights %b") \
+  X(LOG_STUDY_TOGGLE,   LOG_INFO,  "Study Lamp: %b") \
+  X(LOG_UPLIGHT_TOGGLE, LOG_INFO,  "Uplight: %b") \
+  X(LOG_RESYNC,         LOG_INFO,  "Resync: sending current state to both lights") \
+  X(LOG_WIFI_LOST,      LOG_ERROR, "[WIFI] Disconnected - auto-reconnect active") \
+  X(LOG_WIFI_BACK,      LOG_INFO,  "[WIFI] Reconnected! IP: %I") \
+  X(LOG_HEAP,           LOG_INFO,  "[HEAP] Free: %u  Min ever: %u  Largest block: %u") \
+  X(LOG_BULB_DEAD,      LOG_ERROR, "[BULB] %I missed %u replies - pausing updates, probing") \
+  X(LOG_BULB_ALIVE,     LOG_INFO,  "[BULB] %I responding again - restoring state") \
+  X(LOG_SENT_PROBE,     LOG_DEBUG, "Probe to %I [ID:%u]: getPilot") \
+  X(LOG_SENT_PILOT,     LOG_DEBUG, "Sent to %I [ID:%u]: setPilot state=%b dimming=%d temp=%u") \
+  X(LOG_SENT_DIMMING,   LOG_DEBUG, "Sent to %I [ID:%u]: setPilot dimming=%d") \
+  X(LOG_USAGE_READY,    LOG_INFO,  "[USAGE] %u sectors, writing seq %u at offset %u") \
+  X(LOG_USAGE_NO_PARTITION, LOG_ERROR, "[USAGE] No \"usage\" partition - history disabled") \
+  X(LOG_USAGE_WRITE_FAILED, LOG_ERROR, "[USAGE] Flash write failed: %x") \
+  X(LOG_DISCOVERY,      LOG_INFO,  "[BULB] %u of %u bulbs reported state in %u ms") \
+  X(LOG_WIFI_DOWN,      LOG_ERROR, "[WIFI] Disconnected (reason %u) - reconnecting") \
+  X(LOG_WIFI_UP,        LOG_INFO,  "[WIFI] Up after %u ms, %u attempts. IP: %I") \
+  X(LOG_RULES_LOADED,   LOG_INFO,  "[RULES] %d rules loaded (%u bytes)") \
+  X(LOG_RULES_INVALID,  LOG_ERROR, "[RULES] Stored program (%u bytes) is invalid - rules disabled") \
+  X(LOG_RULES_FAULT,    LOG_ERROR, "[RULES] Stack fault in a rule for event %u (argument %u) - rule stopped") \
+  X(LOG_EVENTS_DROPPED, LOG_ERROR, "[EVENTS] Subscriber %u fell behind - %u events dropped")
+
+#endif
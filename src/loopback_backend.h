@@ -0,0 +1,87 @@
+#ifndef LOOPBACK_BACKEND_H
+#define LOOPBACK_BACKEND_H
+
+#include <stddef.h>
+#include "backend.h"
+
+// In-memory backend: each command is applied to a model light and
+// acknowledged on the next poll, with WiZ semantics (dimming or temp alone
+// switches the light on). Lets the dimmer run queuing, caching and liveness
+// with nothing on the network. dropEvery = N loses every Nth packet;
+// tools/loopback_trace.cpp drives it with and without loss.
+template <int N>
+class LoopbackBackend : public LightBackend<LoopbackBackend<N> > {
+ public:
+  static const int REPLY_QUEUE_LEN = 16;
+
+  struct Light {
+    bool on;
+    uint8_t dimming;
+    uint16_t temp;
+    uint32_t commands;  // setPilots applied
+  };
+
+  Light lights[N];
+  uint32_t dropEvery;
+
+  LoopbackBackend() : lights(), dropEvery(0), packets_(0), head_(0), count_(0) {}
+
+  void begin() {}
+
+  bool send(int bulb, uint32_t id, const PilotCommand& cmd) {
+    if (lost()) return true;  // Sent, but never arrives
+    Light& l = lights[bulb];
+    l.on = (cmd.fields & PILOT_STATE) ? cmd.on : true;
+    if (cmd.fields & PILOT_DIMMING) l.dimming = cmd.dimming;
+    if (cmd.fields & PILOT_TEMP) l.temp = cmd.temp;
+    l.commands++;
+    reply(bulb, id, true);
+    return true;
+  }
+
+  bool probe(int bulb, uint32_t id) {
+    if (lost()) return true;
+    BackendReply* r = reply(bulb, id, true);
+    const Light& l = lights[bulb];
+    if (!r || !l.commands) return true;  // Nothing to report until the light has been set
+    PilotCommand& state = r->state;
+    state.fields = PILOT_STATE | PILOT_DIMMING | (l.temp ? PILOT_TEMP : 0);
+    state.on = l.on;
+    state.dimming = l.dimming;
+    state.temp = l.temp;
+    return true;
+  }
+
+  bool poll(BackendReply* out) {
+    if (count_ == 0) return false;
+    *out = replies_[head_];
+    head_ = (head_ + 1) % REPLY_QUEUE_LEN;
+    count_--;
+    return true;
+  }
+
+ private:
+  bool lost() {
+    packets_++;
+    return dropEvery && packets_ % dropEvery == 0;
+  }
+
+  BackendReply* reply(int bulb, uint32_t id, bool success) {
+    if (count_ == REPLY_QUEUE_LEN) return NULL;  // Overflow looks like a lost reply
+    BackendReply& r = replies_[(head_ + count_) % REPLY_QUEUE_LEN];
+    r.bulb = bulb;
+    r.hasId = true;
+    r.id = id;
+    r.success = success;
+    r.state = PilotCommand();
+    count_++;
+    return &r;
+  }
+
+  uint32_t packets_;
+  BackendReply replies_[REPLY_QUEUE_LEN];
+  int head_;
+  int count_;
+};
+
+#endif
@@ -1,15 +1,27 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <WiFiUdp.h>
-#include <ESP32Encoder.h>
 #include <AceButton.h>
 #include <esp_task_wdt.h>
 
 using namespace ace_button;
 
 #include "secrets.h"  // WiFi credentials and light IPs (copy secrets.h.example to secrets.h)
-
-const int WIZ_PORT = 38899;
+#include "dimmer.h"
+#include "lights.h"
+#include "network.h"
+#include "brightness_predictor.h"
+#include "seqlock.h"
+#include "events.h"
+#include "scheduler.h"
+#include "flows.h"
+#include "zones.h"
+#include "usage.h"
+#include "proxy.h"
+#include "rules.h"
+#include "web.h"
+#include "console.h"
+#include "bench.h"
+#include "capture.h"
 
 // Pin definitions
 #define ENCODER_CLK 25
@@ -19,8 +31,6 @@ const int WIZ_PORT = 38899;
 #define BUTTON_UPLIGHT 32    // Button 1 → Uplight
 
 // Objects
-ESP32Encoder encoder;
-WiFiUDP udp;
 AceButton buttonStudy;
 AceButton buttonUplight;
 AceButton buttonEncoder;
@@ -32,24 +42,143 @@ ButtonConfig encoderButtonConfig;
 
 // State variables
 int brightness = 50;  // 10-100 (WiZ range)
-const int MIN_BRIGHTNESS = 10;
-const int MAX_BRIGHTNESS = 100;
-const int BRIGHTNESS_STEP = 2;  // 2% per detent for smoother control
 
 bool studyLampOn = false;
 bool uplightOn = false;
+const int COLOR_TEMPS[] = {2200, 2700, 4000, 6500};
 int colorTempMode = 0;  // 0=2200K, 1=2700K, 2=4000K, 3=6500K
-
-static uint32_t messageId = 1;  // Message counter for WiZ protocol
+int colorTemp = 0;      // Last color temperature applied (K), 0 = never set
+
+Bulb bulbs[BULB_COUNT] = {
+  {"Study Lamp", STUDY_LAMP},
+  {"Uplight", UPLIGHT},
+};
+
+// One row per knob (up to ZONE_MAX). For a knob per light, replace the row
+// with {"Study", 1 << BULB_STUDY, 25, 26} and {"Uplight", 1 << BULB_UPLIGHT, <clk>, <dt>}.
+Zone zones[] = {
+  {"All", (1 << BULB_STUDY) | (1 << BULB_UPLIGHT), ENCODER_CLK, ENCODER_DT},
+};
+const int zoneCount = sizeof(zones) / sizeof(zones[0]);
+static_assert(sizeof(zones) / sizeof(zones[0]) <= ZONE_MAX, "More knobs than ZONE_MAX");
+
+#ifndef HUE_USERNAME
+#define HUE_USERNAME ""  // Only needed for BACKEND_HUE bulbs
+#endif
+const char* hueUsername = HUE_USERNAME;
+
+uint32_t brightnessIntervalMs = 0;  // 0 = send on every detent (console "rate" to change)
+bool predictEnabled = false;        // Console "predict" to change
+const float PREDICT_LATENCY_MS = 20;  // Typical send-to-bulb time, added to the prediction horizon
+// One per zone, so a spin on one knob never bends the guess for another
+static BrightnessPredictor predictors[ZONE_MAX] = {
+  BrightnessPredictor(MIN_BRIGHTNESS, MAX_BRIGHTNESS, BRIGHTNESS_STEP),
+  BrightnessPredictor(MIN_BRIGHTNESS, MAX_BRIGHTNESS, BRIGHTNESS_STEP),
+  BrightnessPredictor(MIN_BRIGHTNESS, MAX_BRIGHTNESS, BRIGHTNESS_STEP),
+  BrightnessPredictor(MIN_BRIGHTNESS, MAX_BRIGHTNESS, BRIGHTNESS_STEP),
+};
+Stats stats;
+
+static Seqlock<ControllerSnapshot> stateSnapshot;
+static ControllerSnapshot publishedState;
+
+const uint32_t HEAP_REPORT_MS = 60000;
+static void reportHeap(void*);
+static WheelTimer heapTimer(reportHeap);
+
+const unsigned long WIFI_STARTUP_TIMEOUT_MS = 20000;
+const uint8_t RESYNC_ATTEMPTS = 3;
 
 
 // Function prototypes
-void sendWizCommand(IPAddress ip, bool state, int brightness);
-void sendWizColorTemp(IPAddress ip, int brightness, int colorTemp);
+static uint8_t powerMask();
+void sendZoneBrightness(int zone, int level);
+void seedFromBulbs();
+bool ruleConsumes(uint8_t eventType, RuleButton button);
 void handleEncoderButton(AceButton*, uint8_t, uint8_t);
 void handleStudyButton(AceButton*, uint8_t, uint8_t);
 void handleUplightButton(AceButton*, uint8_t, uint8_t);
 
+// Rest of the startup, run while the loop already serves the knob, buttons
+// and console: wait for WiFi, take on the bulbs' state, then open the usage
+// history and raise the rules' boot event.
+struct StartupFlow : Flow {
+  unsigned long probedAt;
+  uint32_t eventsBefore;
+
+  const char* name() const { return "startup"; }
+  void step() {
+    FLOW_BEGIN();
+    FLOW_AWAIT_LINK(WIFI_STARTUP_TIMEOUT_MS);
+    if (timedOut()) {
+      Serial.println("WiFi connection FAILED - still retrying in the background");
+      Serial.println("Check your SSID and password!");
+    } else {
+      Serial.print("WiFi connected! IP address: ");
+      Serial.println(WiFi.localIP());
+
+      // Start from what the bulbs are actually doing, so the first click is right
+      eventsBefore = eventBus.published();
+      probedAt = lightsDiscoverStart();
+      FLOW_AWAIT_ACK(FLOW_ALL_BULBS, probedAt, DISCOVERY_TIMEOUT_MS);
+      lightsDiscoverFinish(probedAt);
+      if (eventBus.published() == eventsBefore) seedFromBulbs();  // Unless the controls were used meanwhile
+    }
+    usageBegin();
+    rulesEvent(RULE_EVENT_BOOT, 0);
+    FLOW_END();
+  }
+};
+
+// Resend the current state until both bulbs confirm it
+struct ResyncFlow : Flow {
+  uint8_t attempt;
+  unsigned long sentAt;
+
+  const char* name() const { return "resync"; }
+  void step() {
+    FLOW_BEGIN();
+    for (attempt = 1;; attempt++) {
+      sentAt = millis();
+      resyncLights();
+      FLOW_AWAIT_ACK(FLOW_ALL_BULBS, sentAt, ACK_TIMEOUT_MS);
+      if (!timedOut() || attempt == RESYNC_ATTEMPTS) break;
+    }
+    int confirmed = 0;
+    for (int i = 0; i < BULB_COUNT; i++) {
+      if (bulbsAcked(1 << i, sentAt)) confirmed++;
+    }
+    Serial.printf("  Resync: confirmed by %d of %d bulbs (attempt %u)\n", confirmed, BULB_COUNT, attempt);
+    FLOW_END();
+  }
+};
+
+// Walk the brightness to target over durationMs, a detent at a time, as if
+// the knob were being turned slowly. Turning the knob takes over.
+struct FadeFlow : Flow {
+  int target;
+  uint32_t durationMs;
+  int level;  // Last level set; brightness differs once the knob has moved
+  unsigned long start;
+  uint16_t steps;
+  uint16_t done;
+
+  const char* name() const { return "fade"; }
+  void step() {
+    FLOW_BEGIN();
+    level = brightness;
+    steps = (uint16_t)(abs(target - level) / BRIGHTNESS_STEP);
+    start = millis();
+    for (done = 1; done <= steps; done++) {
+      FLOW_SLEEP_UNTIL(start + durationMs * done / steps);
+      if (brightness != level) break;
+      level += target > level ? BRIGHTNESS_STEP : -BRIGHTNESS_STEP;
+      setBrightness(level);
+    }
+    FLOW_END();
+  }
+};
+
 void setup() {
   Serial.begin(115200);
   delay(2000);
@@ -57,12 +186,13 @@ void setup() {
   Serial.println("ESP32 WiZ Dimmer Starting...");
   Serial.println("=================================");
 
-  // Setup encoder
-  Serial.println("1. Setting up encoder...");
-  ESP32Encoder::useInternalWeakPullResistors = UP;
-  encoder.attachHalfQuad(ENCODER_DT, ENCODER_CLK);
-  encoder.setCount(brightness / BRIGHTNESS_STEP);
-  Serial.println("   Encoder OK");
+  schedulerBegin();
+  eventsBegin();
+
+  // Setup encoders
+  Serial.println("1. Setting up encoders...");
+  zonesBegin();
+  Serial.printf("   %d encoder(s) OK\n", zoneCount);
 
   // Setup buttons
   Serial.println("2. Setting up buttons...");
@@ -76,6 +206,10 @@ void setup() {
   buttonUplight.init(BUTTON_UPLIGHT, LOW);
   Serial.println("   Buttons initialized");
 
+  // Edges wake the loop (zonesBegin() covers the encoders)
+  const uint8_t inputPins[] = {ENCODER_SW, BUTTON_STUDY, BUTTON_UPLIGHT};
+  for (uint8_t pin : inputPins) attachInterrupt(digitalPinToInterrupt(pin), schedulerInputEdge, CHANGE);
+
   // Debug: Show initial button states
   Serial.print("   Button states - Encoder: ");
   Serial.print(digitalRead(ENCODER_SW));
@@ -93,17 +227,23 @@ void setup() {
   encoderButtonConfig.setFeature(ButtonConfig::kFeatureDoubleClick);
   encoderButtonConfig.setFeature(ButtonConfig::kFeatureSuppressAfterDoubleClick);
   encoderButtonConfig.setFeature(ButtonConfig::kFeatureSuppressClickBeforeDoubleClick);
+  encoderButtonConfig.setFeature(ButtonConfig::kFeatureLongPress);  // For rules only
+  encoderButtonConfig.setFeature(ButtonConfig::kFeatureSuppressAfterLongPress);
   encoderButtonConfig.setClickDelay(250);  // Time window for detecting double click
   buttonEncoder.setButtonConfig(&encoderButtonConfig);
 
   // Configure study button with its own config
   studyButtonConfig.setEventHandler(handleStudyButton);
   studyButtonConfig.setFeature(ButtonConfig::kFeatureClick);
+  studyButtonConfig.setFeature(ButtonConfig::kFeatureLongPress);
+  studyButtonConfig.setFeature(ButtonConfig::kFeatureSuppressAfterLongPress);
   buttonStudy.setButtonConfig(&studyButtonConfig);
 
   // Configure uplight button with its own config
   uplightButtonConfig.setEventHandler(handleUplightButton);
   uplightButtonConfig.setFeature(ButtonConfig::kFeatureClick);
+  uplightButtonConfig.setFeature(ButtonConfig::kFeatureLongPress);
+  uplightButtonConfig.setFeature(ButtonConfig::kFeatureSuppressAfterLongPress);
   buttonUplight.setButtonConfig(&uplightButtonConfig);
 
   Serial.println("   Button handlers OK");
@@ -112,28 +252,19 @@ void setup() {
   Serial.println("4. Connecting to WiFi...");
   Serial.print("   SSID: ");
   Serial.println(ssid);
-  WiFi.begin(ssid, password);
-  WiFi.setAutoReconnect(true);
-
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 40) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
-  }
+  networkBegin(ssid, password);
 
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\nWiFi connected!");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
-  } else {
-    Serial.println("\nWiFi connection FAILED!");
-    Serial.print("WiFi status: ");
-    Serial.println(WiFi.status());
-    Serial.println("Check your SSID and password!");
-  }
+  lightsBegin();
+  lightsSetLinkUp(networkUp());
 
-  udp.begin(38900);
+#ifndef QEMU_TARGET
+  // Wall clock for the usage history (UTC; syncs in the background)
+  configTime(0, 0, "pool.ntp.org");
+#endif
+  rulesBegin();
+#ifndef QEMU_TARGET
+  webBegin();  // Needs the TCP/IP stack, which QEMU builds never start
+#endif
 
   // Hardware watchdog: reboot if loop stalls for >10 seconds
   esp_task_wdt_init(10, true);
@@ -141,75 +272,57 @@ void setup() {
 
   Serial.println("Ready! Turn the encoder to adjust brightness.");
   Serial.println("Press buttons to toggle lights on/off.");
-}
+  Serial.println("Type \"help\" for console commands.");
 
-void loop() {
-  // WiFi status logging (auto-reconnect handles recovery)
-  static unsigned long lastWifiCheck = 0;
-  static bool wasConnected = true;
-  if (millis() - lastWifiCheck > 30000) {
-    lastWifiCheck = millis();
-    bool connected = (WiFi.status() == WL_CONNECTED);
-    if (!connected && wasConnected) {
-      Serial.println("[WIFI] Disconnected — auto-reconnect active");
-    } else if (connected && !wasConnected) {
-      Serial.print("[WIFI] Reconnected! IP: ");
-      Serial.println(WiFi.localIP());
-    }
-    wasConnected = connected;
-  }
-
-  // Heap monitoring (every 60 seconds)
-  static unsigned long lastHeapReport = 0;
-  if (millis() - lastHeapReport > 60000) {
-    lastHeapReport = millis();
-    Serial.print("[HEAP] Free: ");
-    Serial.print(ESP.getFreeHeap());
-    Serial.print("  Min ever: ");
-    Serial.print(ESP.getMinFreeHeap());
-    Serial.print("  Largest block: ");
-    Serial.println(ESP.getMaxAllocHeap());
-  }
+  publishControllerState();
+  timerStart(&heapTimer, HEAP_REPORT_MS, HEAP_REPORT_MS);
+  flowStart<StartupFlow>();
 
-  // Drain UDP receive buffer (WiZ bulbs send responses we don't need)
-  while (udp.parsePacket()) {
-    udp.flush();
-  }
-
-  // Check encoder rotation
-  static int lastEncoderCount = brightness / BRIGHTNESS_STEP;
-  int currentCount = encoder.getCount();
-
-  // Clamp encoder count to valid range unconditionally (prevents dead zones at limits)
-  const int minCount = MIN_BRIGHTNESS / BRIGHTNESS_STEP;
-  const int maxCount = MAX_BRIGHTNESS / BRIGHTNESS_STEP;
-  if (currentCount < minCount) {
-    encoder.setCount(minCount);
-    currentCount = minCount;
-  } else if (currentCount > maxCount) {
-    encoder.setCount(maxCount);
-    currentCount = maxCount;
-  }
+#ifdef BENCH_AT_BOOT
+  benchRun();
+#endif
+}
 
-  if (currentCount != lastEncoderCount) {
-    lastEncoderCount = currentCount;
-    brightness = currentCount * BRIGHTNESS_STEP;
-    Serial.print("Brightness: ");
-    Serial.println(brightness);
-
-    // Only send to lights that are ON
-    bool anySent = false;
-    if (studyLampOn) {
-      sendWizCommand(STUDY_LAMP, true, brightness);
-      anySent = true;
-    }
-    if (uplightOn) {
-      sendWizCommand(UPLIGHT, true, brightness);
-      anySent = true;
+void loop() {
+  uint32_t passStart = micros();
+
+  // Periodic and one-shot work that has come due
+  schedulerRun();
+
+  // WiFi events and reconnects; sending resumes in the pass that sees the IP
+  networkPoll();
+
+  // Bulb replies and liveness timers
+  lightsPoll();
+
+  // Read every knob, then act on the zones that moved
+  uint8_t moved = zonesScan(zones, zoneCount);
+  brightness = zones[0].brightness;
+  for (int z = 0; z < zoneCount; z++) {
+    uint8_t lit = zoneBulbs(z) & powerMask();
+    BrightnessPredictor& predictor = predictors[z];
+
+    if (moved & (1 << z)) {
+      stats.encoderSteps++;
+      int level = zones[z].brightness;
+      publishEvent(EVENT_BRIGHTNESS, lit, level);
+
+      if (lit) {
+        // Queued; the send interval folds fast detents together
+        if (predictEnabled) {
+          predictor.horizonMs = brightnessIntervalMs / 2.0f + PREDICT_LATENCY_MS;
+          level = predictor.update(millis(), level);
+          if (level != zones[z].brightness) stats.predictedSends++;
+        }
+        sendZoneBrightness(z, level);
+      }
     }
 
-    if (!anySent) {
-      Serial.println("  (Both lights OFF - brightness will apply when turned ON)");
+    // Knob stopped short of (or past) the predicted level: send the real one
+    int settled;
+    if (predictEnabled && predictor.correction(millis(), &settled) && lit) {
+      stats.predictCorrections++;
+      sendZoneBrightness(z, settled);
     }
   }
 
@@ -218,119 +331,208 @@ void loop() {
   buttonStudy.check();
   buttonUplight.check();
 
+  consolePoll();
+  usagePoll();
+  rulesPoll();
+  flowsPoll();
+#ifndef QEMU_TARGET
+  webPoll();
+#endif
+  proxyPoll();
+  capturePoll();
+
+  // Send everything the inputs queued this pass: one packet per bulb, control commands first
+  lightsFlush();
+  publishControllerState();
+
+  stats.loopHist.record(micros() - passStart);
+  stats.loopPasses++;
+
   esp_task_wdt_reset();
-  delay(10);
+  schedulerSleep();
+}
+
+static void reportHeap(void*) {
+  logMsg<LOG_HEAP>(ESP.getFreeHeap(), ESP.getMinFreeHeap(), ESP.getMaxAllocHeap());
 }
 
-void sendWizCommand(IPAddress ip, bool state, int brightness) {
-  char json[128];
-
-  if (state) {
-    snprintf(json, sizeof(json),
-      "{\"id\":%u,\"method\":\"setPilot\",\"params\":{\"state\":true,\"dimming\":%d}}",
-      messageId, brightness);
-  } else {
-    snprintf(json, sizeof(json),
-      "{\"id\":%u,\"method\":\"setPilot\",\"params\":{\"state\":false}}",
-      messageId);
+void publishControllerState() {
+  ControllerSnapshot s = {};
+  s.brightness = brightness;
+  s.colorTemp = colorTemp;
+  s.colorTempMode = (uint8_t)colorTempMode;
+  s.powerMask = powerMask();
+  for (int i = 0; i < BULB_COUNT; i++) {
+    if (bulbs[i].alive) s.aliveMask |= 1 << i;
   }
+  if (publishedState.version && s.brightness == publishedState.brightness &&
+      s.colorTemp == publishedState.colorTemp && s.colorTempMode == publishedState.colorTempMode &&
+      s.powerMask == publishedState.powerMask && s.aliveMask == publishedState.aliveMask) {
+    return;
+  }
+  s.version = publishedState.version + 1;
+  s.changedAtMs = millis();
+  stateSnapshot.write(s);
+  publishedState = s;
+  webStateChanged();  // Pushes the delta from its own task
+}
 
-  udp.beginPacket(ip, WIZ_PORT);
-  udp.write((const uint8_t*)json, strlen(json));
-  int result = udp.endPacket();
+void readControllerState(ControllerSnapshot* out) {
+  stateSnapshot.read(out);
+}
 
-  if (result == 0) {
-    Serial.print("   ERROR: UDP send failed to ");
-    Serial.println(ip);
-    return;
+static uint8_t powerMask() {
+  return (studyLampOn ? 1 << BULB_STUDY : 0) | (uplightOn ? 1 << BULB_UPLIGHT : 0);
+}
+
+void sendZoneBrightness(int zone, int level) {
+  // Only send to lights that are ON
+  uint8_t lit = zoneBulbs(zone) & powerMask();
+  for (int i = 0; i < BULB_COUNT; i++) {
+    if (lit & (1 << i)) streamLightBrightness(i, level);
+  }
+}
+
+// Take on/off, brightness and color temperature from the boot-time
+// getPilot replies. Each zone's brightness comes from one of its lights,
+// one that is on if there is one; temp from any light, again preferring
+// one that is on.
+void seedFromBulbs() {
+  const Bulb& study = bulbs[BULB_STUDY];
+  const Bulb& uplight = bulbs[BULB_UPLIGHT];
+  if (study.acked.fields & PILOT_STATE) studyLampOn = study.acked.on;
+  if (uplight.acked.fields & PILOT_STATE) uplightOn = uplight.acked.on;
+
+  const PilotCommand* source = NULL;
+  for (int z = 0; z < zoneCount; z++) {
+    const PilotCommand* zoneSource = NULL;
+    for (int i = 0; i < BULB_COUNT; i++) {
+      const PilotCommand& acked = bulbs[i].acked;
+      if (!(zoneBulbs(z) & (1 << i)) || !(acked.fields & PILOT_DIMMING)) continue;
+      if (!zoneSource || (acked.on && !zoneSource->on)) zoneSource = &acked;
+    }
+    if (!zoneSource) continue;
+    zoneSeed(z, zoneSource->dimming);  // Not a turn of the knob
+    if (!source || (zoneSource->on && !source->on)) source = zoneSource;
   }
+  if (!source) return;
 
-  Serial.print("Sent to ");
-  Serial.print(ip);
-  Serial.print(" [ID:");
-  Serial.print(messageId);
-  Serial.print("]: ");
-  Serial.println(json);
+  if (source->fields & PILOT_TEMP) followColorTemp(source->temp);
+}
 
-  messageId++;
+void followColorTemp(int kelvin) {
+  // Next click moves on from the preset nearest this temperature
+  colorTemp = kelvin;
+  int nearest = 0;
+  for (int i = 1; i < 4; i++) {
+    if (abs(COLOR_TEMPS[i] - colorTemp) < abs(COLOR_TEMPS[nearest] - colorTemp)) nearest = i;
+  }
+  colorTempMode = (nearest + 1) % 4;
 }
 
-void sendWizColorTemp(IPAddress ip, int brightness, int colorTemp) {
-  char json[128];
+bool startResync() {
+  return !flowRunning("resync") && flowStart<ResyncFlow>();
+}
 
-  snprintf(json, sizeof(json),
-    "{\"id\":%u,\"method\":\"setPilot\",\"params\":{\"dimming\":%d,\"temp\":%d}}",
-    messageId, brightness, colorTemp);
+bool startFade(int level, uint32_t durationMs) {
+  if (flowRunning("fade")) return false;
+  FadeFlow* fade = flowStart<FadeFlow>();
+  if (!fade) return false;
+  fade->target = constrain(level, MIN_BRIGHTNESS, MAX_BRIGHTNESS) / BRIGHTNESS_STEP * BRIGHTNESS_STEP;
+  fade->durationMs = durationMs;
+  return true;
+}
+
+void resyncLights() {
+  logMsg<LOG_RESYNC>();
+  lightsInvalidateCache();
+  sendLightCommand(BULB_STUDY, studyLampOn, bulbLevel(BULB_STUDY));
+  sendLightCommand(BULB_UPLIGHT, uplightOn, bulbLevel(BULB_UPLIGHT));
+}
 
-  udp.beginPacket(ip, WIZ_PORT);
-  udp.write((const uint8_t*)json, strlen(json));
-  int result = udp.endPacket();
+// Controller actions, shared by the buttons and the web UI
 
-  if (result == 0) {
-    Serial.print("   ERROR: UDP send failed to ");
-    Serial.println(ip);
-    return;
+void applyColorTemp(int mode) {
+  // Only send to lights that are ON
+  colorTempMode = mode;
+  publishEvent(EVENT_COLOR_TEMP, 0, COLOR_TEMPS[colorTempMode]);
+  colorTemp = COLOR_TEMPS[colorTempMode];
+
+  if (studyLampOn) {
+    sendLightColorTemp(BULB_STUDY, bulbLevel(BULB_STUDY), COLOR_TEMPS[colorTempMode]);
+  }
+  if (uplightOn) {
+    sendLightColorTemp(BULB_UPLIGHT, bulbLevel(BULB_UPLIGHT), COLOR_TEMPS[colorTempMode]);
   }
 
-  Serial.print("Sent to ");
-  Serial.print(ip);
-  Serial.print(" [ID:");
-  Serial.print(messageId);
-  Serial.print("]: ");
-  Serial.println(json);
+  colorTempMode = (colorTempMode + 1) % 4;
+}
 
-  messageId++;
+void setBothLights(bool on) {
+  studyLampOn = on;
+  uplightOn = on;
+  publishEvent(EVENT_POWER, EVENT_ALL_BULBS, on);
+  sendLightCommand(BULB_STUDY, studyLampOn, bulbLevel(BULB_STUDY));
+  sendLightCommand(BULB_UPLIGHT, uplightOn, bulbLevel(BULB_UPLIGHT));
 }
 
-void handleEncoderButton(AceButton* button, uint8_t eventType, uint8_t buttonState) {
+void setStudyLamp(bool on) {
+  studyLampOn = on;
+  publishEvent(EVENT_POWER, BULB_STUDY, studyLampOn);
+  sendLightCommand(BULB_STUDY, studyLampOn, bulbLevel(BULB_STUDY));
+}
+
+void setUplight(bool on) {
+  uplightOn = on;
+  publishEvent(EVENT_POWER, BULB_UPLIGHT, uplightOn);
+  sendLightCommand(BULB_UPLIGHT, uplightOn, bulbLevel(BULB_UPLIGHT));
+}
+
+void setBrightness(int value) {
+  // Move the first zone's knob; loop() picks it up like a turn
+  zoneMoveKnob(0, value);
+}
+
+// Button events go to the rules first; a rule can replace the built-in action
+bool ruleConsumes(uint8_t eventType, RuleButton button) {
   switch (eventType) {
-    case AceButton::kEventClicked: {
-      // Cycle through color temperatures — only send to lights that are ON
-      int temps[] = {2200, 2700, 4000, 6500};
-      const char* names[] = {"2200K (candlelight)", "2700K (warm white)", "4000K (neutral)", "6500K (daylight)"};
-      Serial.print("Color temp: ");
-      Serial.println(names[colorTempMode]);
-
-      if (studyLampOn) {
-        sendWizColorTemp(STUDY_LAMP, brightness, temps[colorTempMode]);
-      }
-      if (uplightOn) {
-        sendWizColorTemp(UPLIGHT, brightness, temps[colorTempMode]);
-      }
+    case AceButton::kEventClicked: return rulesEvent(RULE_EVENT_CLICK, button);
+    case AceButton::kEventDoubleClicked: return rulesEvent(RULE_EVENT_DOUBLE_CLICK, button);
+    case AceButton::kEventLongPressed: return rulesEvent(RULE_EVENT_LONG_PRESS, button);
+    default: return false;
+  }
+}
 
-      colorTempMode = (colorTempMode + 1) % 4;
+void handleEncoderButton(AceButton* button, uint8_t eventType, uint8_t buttonState) {
+  publishEvent(EVENT_BUTTON, RULE_BUTTON_ENCODER, eventType);
+  if (ruleConsumes(eventType, RULE_BUTTON_ENCODER)) return;
+  switch (eventType) {
+    case AceButton::kEventClicked:
+      // Cycle through color temperatures
+      applyColorTemp(colorTempMode);
       break;
-    }
 
     case AceButton::kEventDoubleClicked:
       // Toggle both lights on/off together
-      bool anyOn = studyLampOn || uplightOn;
-      studyLampOn = !anyOn;
-      uplightOn = !anyOn;
-      Serial.print("Encoder button double-click: Turn both lights ");
-      Serial.println(!anyOn ? "ON" : "OFF");
-      sendWizCommand(STUDY_LAMP, studyLampOn, brightness);
-      sendWizCommand(UPLIGHT, uplightOn, brightness);
+      setBothLights(!(studyLampOn || uplightOn));
       break;
   }
 }
 
 void handleStudyButton(AceButton* button, uint8_t eventType, uint8_t buttonState) {
+  publishEvent(EVENT_BUTTON, RULE_BUTTON_STUDY, eventType);
+  if (ruleConsumes(eventType, RULE_BUTTON_STUDY)) return;
   if (eventType == AceButton::kEventClicked) {
     // Toggle on single click
-    studyLampOn = !studyLampOn;
-    Serial.print("Study Lamp: ");
-    Serial.println(studyLampOn ? "ON" : "OFF");
-    sendWizCommand(STUDY_LAMP, studyLampOn, brightness);
+    setStudyLamp(!studyLampOn);
   }
 }
 
 void handleUplightButton(AceButton* button, uint8_t eventType, uint8_t buttonState) {
+  publishEvent(EVENT_BUTTON, RULE_BUTTON_UPLIGHT, eventType);
+  if (ruleConsumes(eventType, RULE_BUTTON_UPLIGHT)) return;
   if (eventType == AceButton::kEventClicked) {
     // Toggle on single click
-    uplightOn = !uplightOn;
-    Serial.print("Uplight: ");
-    Serial.println(uplightOn ? "ON" : "OFF");
-    sendWizCommand(UPLIGHT, uplightOn, brightness);
+    setUplight(!uplightOn);
   }
 }
@@ -0,0 +1,140 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "network.h"
+#include "wifi_link.h"
+#include "dimmer.h"
+#include "lights.h"
+#include "scheduler.h"
+
+const int NETWORK_EVENT_QUEUE_LEN = 8;
+
+enum NetworkEventKind : uint8_t {
+  NET_EVENT_ASSOCIATED,
+  NET_EVENT_GOT_IP,
+  NET_EVENT_DISCONNECTED,
+};
+
+struct NetworkEvent {
+  NetworkEventKind kind;
+  uint8_t reason;    // Disconnected
+  uint8_t channel;   // Associated
+  uint8_t bssid[6];  // Associated
+};
+
+static WifiLink wifiLink;
+static QueueHandle_t events = NULL;
+static const char* networkSsid;
+static const char* networkPassword;
+
+// WiFi event task: never touch the state machine here, only enqueue
+static void onWifiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+  NetworkEvent e = {};
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+      e.kind = NET_EVENT_ASSOCIATED;
+      e.channel = info.wifi_sta_connected.channel;
+      memcpy(e.bssid, info.wifi_sta_connected.bssid, sizeof(e.bssid));
+      break;
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      e.kind = NET_EVENT_GOT_IP;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      e.kind = NET_EVENT_DISCONNECTED;
+      e.reason = info.wifi_sta_disconnected.reason;
+      break;
+    default:
+      return;
+  }
+  xQueueSend(events, &e, 0);
+  schedulerWake();
+}
+
+void networkBegin(const char* ssid, const char* password) {
+  events = xQueueCreate(NETWORK_EVENT_QUEUE_LEN, sizeof(NetworkEvent));
+#ifdef QEMU_TARGET
+  // No radio: WiZ traffic goes over the UART tunnel, which is always up
+  static const uint8_t noBssid[6] = {};
+  wifiLink.associated(0, noBssid);
+  wifiLink.gotIp();
+  return;
+#endif
+  networkSsid = ssid;
+  networkPassword = password;
+  WiFi.onEvent(onWifiEvent);
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);  // Reconnects are driven by WifiLink
+  wifiLink.begin(millis());
+  networkPoll();
+}
+
+void networkPoll() {
+  unsigned long now = millis();
+  bool wasUp = wifiLink.up();
+
+  NetworkEvent e;
+  while (xQueueReceive(events, &e, 0) == pdTRUE) {
+    switch (e.kind) {
+      case NET_EVENT_ASSOCIATED:
+        wifiLink.associated(e.channel, e.bssid);
+        break;
+      case NET_EVENT_GOT_IP:
+        wifiLink.gotIp();
+        break;
+      case NET_EVENT_DISCONNECTED:
+        // WiFi.begin() with a new channel/BSSID first leaves the old config
+        if (e.reason == WIFI_REASON_ASSOC_LEAVE && !wifiLink.up()) break;
+        if (wifiLink.up()) {
+          stats.wifiDrops++;
+          logMsg<LOG_WIFI_DOWN>(e.reason);
+        }
+        wifiLink.disconnected(now, e.reason);
+        break;
+    }
+  }
+
+  switch (wifiLink.poll(now)) {
+    case WIFI_ACTION_CONNECT_CACHED:
+      stats.wifiAttempts++;
+      WiFi.begin(networkSsid, networkPassword, wifiLink.cachedChannel(), wifiLink.cachedBssid());
+      break;
+    case WIFI_ACTION_CONNECT_SCAN:
+      stats.wifiAttempts++;
+      WiFi.begin(networkSsid, networkPassword);
+      break;
+    default:
+      break;
+  }
+
+  if (wifiLink.up() != wasUp) {
+    if (wifiLink.up()) {
+      uint32_t ms = now - wifiLink.downSince();
+      stats.wifiRecoverMs = ms;
+      if (ms > stats.wifiRecoverMaxMs) stats.wifiRecoverMaxMs = ms;
+      logMsg<LOG_WIFI_UP>(ms, wifiLink.attempts(), WiFi.localIP());
+    }
+    lightsSetLinkUp(wifiLink.up());
+  }
+  // Reconnect attempts are timed by WifiLink; keep polling until it is up
+  if (!wifiLink.up()) schedulerStayAwake(LOOP_POLL_MS);
+}
+
+bool networkUp() {
+  return wifiLink.up();
+}
+
+void networkPrintStatus() {
+  static const char* const STATE_NAMES[] = {"down", "connecting", "waiting for DHCP", "up"};
+  Serial.printf("  WiFi: %s", STATE_NAMES[wifiLink.state()]);
+  if (wifiLink.up()) {
+    IPAddress ip = WiFi.localIP();
+    Serial.printf("  IP: %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  }
+  if (wifiLink.hasCache()) {
+    const uint8_t* b = wifiLink.cachedBssid();
+    Serial.printf("  AP: %02x:%02x:%02x:%02x:%02x:%02x ch %u",
+      b[0], b[1], b[2], b[3], b[4], b[5], wifiLink.cachedChannel());
+  }
+  Serial.println();
+  Serial.printf("  Drops: %u  Attempts: %u  Last recovery: %u ms  Worst: %u ms  Last reason: %u\n",
+    stats.wifiDrops, stats.wifiAttempts, stats.wifiRecoverMs, stats.wifiRecoverMaxMs, wifiLink.lastReason());
+}
@@ -0,0 +1,15 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+// WiFi connection management (network.cpp). Driver events are queued from
+// the WiFi task and applied by networkPoll() to the WifiLink state machine
+// (wifi_link.h), which decides when and how to reconnect. While the link is
+// down lightsFlush() holds commands in the queue rather than failing to
+// send them; they go out in the first pass after the IP is back.
+
+void networkBegin(const char* ssid, const char* password);
+void networkPoll();  // Call at the start of every loop pass
+bool networkUp();
+void networkPrintStatus();
+
+#endif
@@ -0,0 +1,168 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "proxy.h"
+#include "dimmer.h"
+#include "events.h"
+#include "lights.h"
+#include "scheduler.h"
+#include "wiz_json.h"
+
+// getPilot waiting for a refresh of the bulb's confirmed state
+struct Waiter {
+  IPAddress ip;
+  uint16_t port;
+  WizRequest req;
+  unsigned long since;
+};
+
+uint32_t proxyStateTtlMs = PROXY_DEFAULT_STATE_TTL_MS;
+
+static WiFiUDP sockets[BULB_COUNT];
+static bool running = false;
+static Waiter waiters[BULB_COUNT][PROXY_WAITERS_MAX];
+static uint8_t waiterCount[BULB_COUNT];
+
+void proxyBegin() {
+#ifdef QEMU_TARGET
+  Serial.println("  No network stack under QEMU");
+  return;
+#endif
+  if (running) return;
+  for (int i = 0; i < BULB_COUNT; i++) {
+    sockets[i].begin(WIZ_PROXY_PORT + i);
+    waiterCount[i] = 0;
+  }
+  running = true;
+}
+
+void proxyEnd() {
+  if (!running) return;
+  for (int i = 0; i < BULB_COUNT; i++) {
+    sockets[i].stop();
+  }
+  running = false;
+}
+
+bool proxyRunning() {
+  return running;
+}
+
+static void sendReply(int bulb, IPAddress ip, uint16_t port, const char* reply) {
+  WiFiUDP& udp = sockets[bulb];
+  udp.beginPacket(ip, port);
+  udp.write((const uint8_t*)reply, strlen(reply));
+  udp.endPacket();
+}
+
+// Confirmed state with its age, however old
+static void answerGetPilot(int bulb, IPAddress ip, uint16_t port, const WizRequest& req, unsigned long now) {
+  const Bulb& b = bulbs[bulb];
+  char reply[192];
+  if (b.acked.fields) {
+    char age[24];
+    snprintf(age, sizeof(age), ",\"ageMs\":%lu", now - b.ackedAt);
+    wizFormatGetReply(reply, sizeof(reply), req, b.acked, age);
+  } else {
+    wizFormatError(reply, sizeof(reply), req, WIZ_ERROR_NO_STATE, "No confirmed state");
+  }
+  sendReply(bulb, ip, port, reply);
+}
+
+static void handleGetPilot(int bulb, IPAddress ip, uint16_t port, const WizRequest& req, unsigned long now) {
+  stats.proxyGetPilots++;
+  const Bulb& b = bulbs[bulb];
+  bool fresh = b.acked.fields && now - b.ackedAt < proxyStateTtlMs;
+  if (fresh || !b.alive || waiterCount[bulb] == PROXY_WAITERS_MAX) {
+    // A dead bulb is already being probed; a full waiter list means one is on its way
+    if (fresh) stats.proxyCacheHits++;
+    answerGetPilot(bulb, ip, port, req, now);
+    return;
+  }
+
+  // Stale: one refresh serves every client that asks while it is outstanding
+  if (waiterCount[bulb] == 0) {
+    lightsRefresh(bulb);
+    stats.proxyRefreshes++;
+  }
+  Waiter& w = waiters[bulb][waiterCount[bulb]++];
+  w.ip = ip;
+  w.port = port;
+  w.req = req;
+  w.since = now;
+}
+
+// Answer waiters once the state has been confirmed since they asked, or on timeout
+static void answerWaiters(int bulb, unsigned long now) {
+  if (waiterCount[bulb] == 0) return;
+  const Bulb& b = bulbs[bulb];
+  const Waiter& first = waiters[bulb][0];
+  bool refreshed = b.acked.fields && (long)(b.ackedAt - first.since) >= 0;
+  if (!refreshed && b.alive && now - first.since < ACK_TIMEOUT_MS) return;
+  for (int i = 0; i < waiterCount[bulb]; i++) {
+    const Waiter& w = waiters[bulb][i];
+    answerGetPilot(bulb, w.ip, w.port, w.req, now);
+  }
+  waiterCount[bulb] = 0;
+}
+
+static void handleRequest(int bulb, WiFiUDP& udp, const char* json, unsigned long now) {
+  WizRequest req;
+  wizParseRequest(json, &req);
+  stats.proxyRequests++;
+
+  char reply[192];
+  switch (req.method) {
+    case WIZ_SET_PILOT:
+      stats.proxySetPilots++;
+      if (req.pilot.fields) {
+        sendLightPilot(bulb, req.pilot);
+        // Keep the buttons in step: the next click toggles from the new state.
+        // The pilot has gone out as sent, so this publishes what
+        // setStudyLamp()/setUplight() would without sending again.
+        bool* on = bulb == BULB_STUDY ? &studyLampOn : bulb == BULB_UPLIGHT ? &uplightOn : NULL;
+        if (on && *on != bulbs[bulb].desiredOn) {
+          *on = bulbs[bulb].desiredOn;
+          publishEvent(EVENT_POWER, bulb, *on);
+        }
+      }
+      wizFormatSetReply(reply, sizeof(reply), req);
+      break;
+    case WIZ_GET_PILOT:
+      handleGetPilot(bulb, udp.remoteIP(), udp.remotePort(), req, now);
+      return;
+    default:
+      wizFormatError(reply, sizeof(reply), req, WIZ_ERROR_METHOD_NOT_FOUND, "Method not found");
+      break;
+  }
+  sendReply(bulb, udp.remoteIP(), udp.remotePort(), reply);
+}
+
+void proxyPoll() {
+  if (!running) return;
+  schedulerStayAwake(LOOP_POLL_MS);  // Requests arrive on sockets that cannot wake the loop
+  char json[256];
+  unsigned long now = millis();
+  for (int i = 0; i < BULB_COUNT; i++) {
+    answerWaiters(i, now);
+    WiFiUDP& udp = sockets[i];
+    for (int n = 0; n < PROXY_MAX_PACKETS_PER_POLL && udp.parsePacket(); n++) {
+      int len = udp.read(json, sizeof(json) - 1);
+      json[len > 0 ? len : 0] = '\0';
+      handleRequest(i, udp, json, now);
+      udp.flush();
+    }
+  }
+}
+
+void proxyPrintStatus() {
+  Serial.printf("  Proxy: %s  Requests: %u  setPilots: %u  Packets to bulbs: %u\n",
+    running ? "on" : "off", stats.proxyRequests, stats.proxySetPilots, stats.packetsSent);
+  Serial.printf("  getPilots: %u  From cache: %u  Refreshes: %u  State TTL: %u s\n",
+    stats.proxyGetPilots, stats.proxyCacheHits, stats.proxyRefreshes, proxyStateTtlMs / 1000);
+  if (!running) return;
+  IPAddress ip = WiFi.localIP();
+  for (int i = 0; i < BULB_COUNT; i++) {
+    Serial.printf("  %-10s %u.%u.%u.%u:%d\n", bulbs[i].name, ip[0], ip[1], ip[2], ip[3], WIZ_PROXY_PORT + i);
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef PROXY_H
+#define PROXY_H
+
+// WiZ protocol proxy (proxy.cpp): lets other WiZ clients (the phone app,
+// home automation) drive the bulbs through the dimmer instead of hitting
+// them directly. Point a client at the dimmer's IP on port
+// WIZ_PROXY_PORT + bulb index in place of the bulb's IP on 38899.
+//
+// setPilot requests are merged into the bulb's desired state and queued
+// like the dimmer's own commands, so requests from every source coalesce
+// and share the stream rate limit (see command_queue.h). The client gets
+// {"success":true} as soon as the command is queued. Other methods get a
+// JSON-RPC "Method not found" error.
+//
+// getPilot is answered from the state the bulb last confirmed (Bulb::acked)
+// with its age in ms as an extra "ageMs" result field. Only when that is
+// older than proxyStateTtlMs is the bulb asked (lightsRefresh()); clients
+// asking meanwhile wait for the same answer, up to ACK_TIMEOUT_MS, then get
+// the old state. The dimmer's own acks keep the cache fresh while it is in
+// use. A bulb that never confirmed anything gets error -32000.
+//
+// Off by default; console "proxy on" opens the ports, "proxy ttl <s>" sets
+// the TTL.
+
+const int WIZ_PROXY_PORT = 38910;
+const int PROXY_MAX_PACKETS_PER_POLL = 8;  // Bound the work done in a single loop pass
+const int PROXY_WAITERS_MAX = 4;           // getPilots per bulb waiting for a refresh
+const unsigned long PROXY_DEFAULT_STATE_TTL_MS = 10000;
+
+extern uint32_t proxyStateTtlMs;  // 0 = ask the bulb every time
+
+void proxyBegin();
+void proxyEnd();
+bool proxyRunning();
+void proxyPoll();  // Call every loop pass, before lightsFlush()
+void proxyPrintStatus();
+
+#endif
@@ -0,0 +1,225 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <sys/time.h>
+#include <time.h>
+#include "rules.h"
+#include "dimmer.h"
+#include "events.h"
+#include "lights.h"
+#include "scheduler.h"
+#include "zones.h"
+
+const char* const RULES_NVS_NAMESPACE = "rules";
+const char* const RULES_NVS_KEY = "program";
+const unsigned long RULES_TICK_MS = 60000;
+const uint32_t RULES_MIN_UNIX_TIME = 1600000000;  // Anything earlier means NTP has not synced
+
+static uint8_t program[RULES_MAX_BYTES];
+static size_t programLen = 0;
+static int ruleCount = 0;
+
+static uint8_t staged[RULES_MAX_BYTES];
+static size_t stagedLen = 0;
+
+static uint32_t lastTickKey = 0;
+static void tick(void*);
+static WheelTimer tickTimer(tick);
+static unsigned long onSince[BULB_COUNT];
+static bool wasOn[BULB_COUNT];
+static uint32_t faults = 0;
+static uint32_t consumed = 0;
+
+// Controller state and actions as the interpreter sees them
+struct ControllerEnv {
+  bool clockValid;
+  struct tm local;
+
+  ControllerEnv() {
+    time_t t = time(NULL);
+    clockValid = t >= (time_t)RULES_MIN_UNIX_TIME;
+    t += (time_t)rulesTzMinutes(program) * 60;
+    gmtime_r(&t, &local);
+  }
+
+  int32_t var(RuleVar v, uint8_t bulb) {
+    switch (v) {
+      case RULE_VAR_HOUR: return clockValid ? local.tm_hour : -1;
+      case RULE_VAR_MINUTE: return clockValid ? local.tm_min : -1;
+      case RULE_VAR_TIME: return clockValid ? local.tm_hour * 60 + local.tm_min : -1;
+      case RULE_VAR_WEEKDAY: return clockValid ? local.tm_wday : -1;
+      case RULE_VAR_CLOCK: return clockValid;
+      case RULE_VAR_BRIGHTNESS: return brightness;
+      case RULE_VAR_TEMP: return colorTemp;
+      case RULE_VAR_ON:
+        if (bulb == RULE_ALL_BULBS) return studyLampOn || uplightOn;
+        return bulb < BULB_COUNT && bulbs[bulb].desiredOn;
+      case RULE_VAR_ON_MINUTES:
+        if (bulb >= BULB_COUNT || !bulbs[bulb].desiredOn) return 0;
+        return (int32_t)((millis() - onSince[bulb]) / 60000);
+      default: return 0;
+    }
+  }
+
+  void action(RuleOp op, uint8_t bulb, int32_t value) {
+    switch (op) {
+      case RULE_OP_POWER:
+        setPower(bulb, value != 0);
+        break;
+      case RULE_OP_TOGGLE:
+        if (bulb == RULE_ALL_BULBS) {
+          setBothLights(!(studyLampOn || uplightOn));
+        } else {
+          setPower(bulb, bulb == BULB_STUDY ? !studyLampOn : !uplightOn);
+        }
+        break;
+      case RULE_OP_BRIGHTNESS:
+        // Like a turn of the knob, but also used by a power-on later in this rule
+        brightness = constrain((int)value, MIN_BRIGHTNESS, MAX_BRIGHTNESS) / BRIGHTNESS_STEP * BRIGHTNESS_STEP;
+        setBrightness(brightness);
+        break;
+      case RULE_OP_TEMP:
+        // rulec rejects others, but the bytecode pushes any int16
+        followColorTemp(constrain((int)value, RULE_TEMP_MIN, RULE_TEMP_MAX));
+        publishEvent(EVENT_COLOR_TEMP, 0, colorTemp);
+        if (studyLampOn) sendLightColorTemp(BULB_STUDY, bulbLevel(BULB_STUDY), colorTemp);
+        if (uplightOn) sendLightColorTemp(BULB_UPLIGHT, bulbLevel(BULB_UPLIGHT), colorTemp);
+        break;
+      default:
+        break;
+    }
+  }
+
+  void setPower(uint8_t bulb, bool on) {
+    if (bulb == RULE_ALL_BULBS) {
+      setBothLights(on);
+    } else if (bulb == BULB_STUDY && on != studyLampOn) {
+      setStudyLamp(on);
+    } else if (bulb == BULB_UPLIGHT && on != uplightOn) {
+      setUplight(on);
+    }
+  }
+};
+
+static uint8_t run(RuleEvent event, uint8_t arg) {
+  if (ruleCount <= 0) return 0;
+  uint32_t start = micros();
+  ControllerEnv env;
+  uint8_t result = rulesRun(program, programLen, event, arg, env);
+  stats.rulesHist.record(micros() - start);
+  if (result & RULE_RESULT_FAULT) {
+    faults++;
+    logMsg<LOG_RULES_FAULT>(event, arg);
+  }
+  if (result & RULE_RESULT_CONSUMED) consumed++;
+  return result;
+}
+
+static void load(const uint8_t* p, size_t len) {
+  int count = rulesValidate(p, len);
+  if (count < 0) {
+    programLen = 0;
+    ruleCount = 0;
+    return;
+  }
+  memcpy(program, p, len);
+  programLen = len;
+  ruleCount = count;
+}
+
+// At the minute once the clock is set, otherwise every minute from boot
+static void tick(void*) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  bool clockValid = tv.tv_sec >= (time_t)RULES_MIN_UNIX_TIME;
+  uint32_t key = clockValid ? (uint32_t)(tv.tv_sec / 60) : millis() / RULES_TICK_MS;
+  if (key != lastTickKey) {
+    lastTickKey = key;
+    run(RULE_EVENT_TICK, 0);
+  }
+  // A timer that fires a little early finds the old minute and comes back for the new one
+  uint32_t delay = clockValid ? 60000 - (uint32_t)(tv.tv_sec % 60) * 1000 - (uint32_t)(tv.tv_usec / 1000)
+    : RULES_TICK_MS - millis() % RULES_TICK_MS;
+  timerStart(&tickTimer, delay);
+}
+
+void rulesBegin() {
+  Preferences prefs;
+  if (prefs.begin(RULES_NVS_NAMESPACE, true)) {
+    size_t len = prefs.getBytesLength(RULES_NVS_KEY);
+    if (len > 0 && len <= RULES_MAX_BYTES) {
+      len = prefs.getBytes(RULES_NVS_KEY, staged, len);
+      load(staged, len);
+      if (!ruleCount) logMsg<LOG_RULES_INVALID>((uint32_t)len);
+    }
+    prefs.end();
+  }
+  logMsg<LOG_RULES_LOADED>(ruleCount, (uint32_t)programLen);
+
+  lastTickKey = millis() / RULES_TICK_MS;  // The first tick is the next minute, not now
+  timerStart(&tickTimer, RULES_TICK_MS - millis() % RULES_TICK_MS);
+}
+
+void rulesPoll() {
+  unsigned long now = millis();
+  for (int i = 0; i < BULB_COUNT; i++) {
+    if (bulbs[i].desiredOn && !wasOn[i]) onSince[i] = now;
+    wasOn[i] = bulbs[i].desiredOn;
+  }
+}
+
+bool rulesEvent(RuleEvent event, uint8_t arg) {
+  return (run(event, arg) & RULE_RESULT_CONSUMED) != 0;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool rulesStage(const char* hex) {
+  size_t len = strlen(hex);
+  if (len == 0 || len % 2 || stagedLen + len / 2 > RULES_MAX_BYTES) return false;
+  for (size_t i = 0; i < len; i++) {
+    if (hexValue(hex[i]) < 0) return false;
+  }
+  for (size_t i = 0; i < len; i += 2) {
+    staged[stagedLen++] = (uint8_t)(hexValue(hex[i]) << 4 | hexValue(hex[i + 1]));
+  }
+  return true;
+}
+
+void rulesDiscardStaged() {
+  stagedLen = 0;
+}
+
+bool rulesSave() {
+  if (rulesValidate(staged, stagedLen) < 0) return false;
+  Preferences prefs;
+  if (!prefs.begin(RULES_NVS_NAMESPACE, false)) return false;
+  bool ok = prefs.putBytes(RULES_NVS_KEY, staged, stagedLen) == stagedLen;
+  prefs.end();
+  if (ok) {
+    load(staged, stagedLen);
+    stagedLen = 0;
+  }
+  return ok;
+}
+
+void rulesClear() {
+  Preferences prefs;
+  if (prefs.begin(RULES_NVS_NAMESPACE, false)) {
+    prefs.remove(RULES_NVS_KEY);
+    prefs.end();
+  }
+  programLen = 0;
+  ruleCount = 0;
+}
+
+void rulesPrintStatus() {
+  Serial.printf("  Rules: %d (%u bytes, UTC%+d min)  Staged: %u bytes\n", ruleCount,
+    (unsigned)programLen, ruleCount ? rulesTzMinutes(program) : 0, (unsigned)stagedLen);
+  Serial.printf("  Runs: %u  Consumed: %u  Faults: %u  Run time: %u us avg, %u us max\n",
+    stats.rulesHist.total, consumed, faults, stats.rulesHist.mean(), stats.rulesHist.maxValue);
+}
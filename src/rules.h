@@ -0,0 +1,31 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rules_vm.h"
+
+// User rules (rules.cpp): "when <event> if <condition> do <actions>",
+// compiled on the host by tools/rulec.cpp and stored in NVS, so behavior
+// changes need no reflash. See rules_vm.h for the bytecode.
+//
+// The buttons pass their clicks, double clicks (encoder only) and long
+// presses through rulesEvent() first; a rule that runs "consume" replaces
+// the built-in action. A timer raises a tick event once a minute, and
+// the startup flow in main.cpp raises a boot event once the bulbs' state
+// is known (or WiFi has not come up in time).
+//
+// Programs arrive over the console in hex chunks ("rules add <hex>") and
+// are validated before "rules save" writes them to NVS.
+
+void rulesBegin();  // Load from NVS; call at the end of setup()
+void rulesPoll();   // Call every loop pass
+bool rulesEvent(RuleEvent event, uint8_t arg);  // True if a rule consumed it
+
+bool rulesStage(const char* hex);  // Append to the staging buffer; false if malformed or full
+void rulesDiscardStaged();
+bool rulesSave();   // Validate the staged program, store it and run it from now on
+void rulesClear();  // Remove the stored program
+void rulesPrintStatus();
+
+#endif
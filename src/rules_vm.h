@@ -0,0 +1,193 @@
+#ifndef RULES_VM_H
+#define RULES_VM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bytecode format and interpreter for user rules, shared by the firmware
+// (rules.cpp) and the compiler (tools/rulec.cpp).
+//
+// A program is RULES_MAGIC (4 bytes, little-endian), the local time offset
+// from UTC in minutes (int16, little-endian), the rule count, then for each
+// rule: event, argument (button, or RULE_ANY), code length, code.
+//
+// Code runs on a small stack of int32. Jumps only go forward, so a rule
+// runs at most once through its code: no loops, no allocation, and the
+// cost is bounded by its length. Programs are checked once with
+// rulesValidate() before they are run.
+
+const uint32_t RULES_MAGIC = 0x31525A57;  // "WZR1"
+const size_t RULES_HEADER_LEN = 7;
+const size_t RULES_MAX_BYTES = 1024;
+const int RULES_STACK_MAX = 8;
+const uint8_t RULE_ANY = 0xFF;      // Any button
+const uint8_t RULE_ALL_BULBS = 0xFF;
+const int RULE_TEMP_MIN = 2200;     // Kelvin: the warmest and coolest presets
+const int RULE_TEMP_MAX = 6500;
+
+enum RuleEvent : uint8_t {
+  RULE_EVENT_BOOT = 1,
+  RULE_EVENT_TICK = 2,          // Once a minute, at the minute once the clock is set
+  RULE_EVENT_CLICK = 3,         // Argument: RuleButton
+  RULE_EVENT_DOUBLE_CLICK = 4,
+  RULE_EVENT_LONG_PRESS = 5,
+};
+
+enum RuleButton : uint8_t {
+  RULE_BUTTON_STUDY = 0,
+  RULE_BUTTON_UPLIGHT = 1,
+  RULE_BUTTON_ENCODER = 2,
+};
+
+enum RuleVar : uint8_t {
+  RULE_VAR_HOUR = 0,        // Local time; -1 until NTP has synced
+  RULE_VAR_MINUTE = 1,
+  RULE_VAR_TIME = 2,        // Minutes since local midnight
+  RULE_VAR_WEEKDAY = 3,     // 0 = Sunday
+  RULE_VAR_CLOCK = 4,       // 1 once the clock is set
+  RULE_VAR_BRIGHTNESS = 5,
+  RULE_VAR_TEMP = 6,        // Last color temperature applied (K), 0 = never set
+  RULE_VAR_ON = 7,          // Operand bulb: 1 if on (RULE_ALL_BULBS: any)
+  RULE_VAR_ON_MINUTES = 8,  // Operand bulb: minutes since it was turned on, 0 if off
+  RULE_VAR_COUNT
+};
+
+enum RuleOp : uint8_t {
+  RULE_OP_END = 0,
+  RULE_OP_PUSH = 1,           // int16 (little-endian)
+  RULE_OP_VAR = 2,            // RuleVar, bulb
+  RULE_OP_EQ = 3,             // Pop b, pop a, push a op b
+  RULE_OP_NE = 4,
+  RULE_OP_LT = 5,
+  RULE_OP_LE = 6,
+  RULE_OP_GT = 7,
+  RULE_OP_GE = 8,
+  RULE_OP_AND = 9,
+  RULE_OP_OR = 10,
+  RULE_OP_NOT = 11,
+  RULE_OP_JUMP_IF_FALSE = 12, // Offset from the next op; pops the condition
+  RULE_OP_POWER = 13,         // Bulb; pops on/off
+  RULE_OP_TOGGLE = 14,        // Bulb
+  RULE_OP_BRIGHTNESS = 15,    // Pops level
+  RULE_OP_TEMP = 16,          // Pops Kelvin
+  RULE_OP_CONSUME = 17,       // Skip the built-in action for this event
+  RULE_OP_COUNT
+};
+
+// Operand bytes after each opcode
+inline int ruleOperandBytes(uint8_t op) {
+  switch (op) {
+    case RULE_OP_PUSH:
+    case RULE_OP_VAR:
+      return 2;
+    case RULE_OP_JUMP_IF_FALSE:
+    case RULE_OP_POWER:
+    case RULE_OP_TOGGLE:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+// Rule count, or -1 if the program is malformed
+inline int rulesValidate(const uint8_t* p, size_t len) {
+  if (len < RULES_HEADER_LEN || len > RULES_MAX_BYTES) return -1;
+  uint32_t magic = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+  if (magic != RULES_MAGIC) return -1;
+
+  int count = p[6];
+  size_t at = RULES_HEADER_LEN;
+  for (int r = 0; r < count; r++) {
+    if (at + 3 > len) return -1;
+    uint8_t event = p[at];
+    size_t codeLen = p[at + 2];
+    const uint8_t* code = p + at + 3;
+    if (event < RULE_EVENT_BOOT || event > RULE_EVENT_LONG_PRESS || at + 3 + codeLen > len) return -1;
+    for (size_t pc = 0; pc < codeLen;) {
+      uint8_t op = code[pc];
+      if (op >= RULE_OP_COUNT) return -1;
+      size_t next = pc + 1 + ruleOperandBytes(op);
+      if (next > codeLen) return -1;
+      if (op == RULE_OP_VAR && code[pc + 1] >= RULE_VAR_COUNT) return -1;
+      if (op == RULE_OP_JUMP_IF_FALSE && next + code[pc + 1] > codeLen) return -1;
+      pc = next;
+    }
+    at += 3 + codeLen;
+  }
+  return at == len ? count : -1;
+}
+
+inline int16_t rulesTzMinutes(const uint8_t* p) {
+  return (int16_t)(p[4] | p[5] << 8);
+}
+
+enum RuleResult : uint8_t {
+  RULE_RESULT_CONSUMED = 1,  // A rule ran CONSUME
+  RULE_RESULT_FAULT = 2,     // A rule overflowed or underflowed the stack and was stopped
+};
+
+// Runs every rule for the event against a validated program. Env provides
+//   int32_t var(RuleVar v, uint8_t bulb)
+//   void action(RuleOp op, uint8_t bulb, int32_t value)
+// Returns RuleResult bits.
+template <typename Env>
+uint8_t rulesRun(const uint8_t* p, size_t len, uint8_t event, uint8_t arg, Env& env) {
+  uint8_t result = 0;
+  int count = p[6];
+  size_t at = RULES_HEADER_LEN;
+  for (int r = 0; r < count && at < len; r++) {
+    uint8_t ruleEvent = p[at];
+    uint8_t ruleArg = p[at + 1];
+    size_t codeLen = p[at + 2];
+    const uint8_t* code = p + at + 3;
+    at += 3 + codeLen;
+    if (ruleEvent != event || (ruleArg != RULE_ANY && ruleArg != arg)) continue;
+
+    int32_t stack[RULES_STACK_MAX];
+    int sp = 0;
+    for (size_t pc = 0; pc < codeLen;) {
+      uint8_t op = code[pc];
+      const uint8_t* operand = code + pc + 1;
+      pc += 1 + ruleOperandBytes(op);
+
+      // Stack effect first, so a fault never touches the controller
+      int pops = op >= RULE_OP_EQ && op <= RULE_OP_OR ? 2
+        : op == RULE_OP_NOT || op == RULE_OP_JUMP_IF_FALSE || op == RULE_OP_POWER ||
+          op == RULE_OP_BRIGHTNESS || op == RULE_OP_TEMP ? 1 : 0;
+      int pushes = op == RULE_OP_PUSH || op == RULE_OP_VAR || (op >= RULE_OP_EQ && op <= RULE_OP_NOT) ? 1 : 0;
+      if (sp < pops || sp - pops + pushes > RULES_STACK_MAX) {
+        result |= RULE_RESULT_FAULT;
+        break;
+      }
+
+      int32_t b = pops >= 1 ? stack[sp - 1] : 0;
+      int32_t a = pops == 2 ? stack[sp - 2] : 0;
+      sp -= pops;
+      int32_t v = 0;
+      switch (op) {
+        case RULE_OP_END: pc = codeLen; break;
+        case RULE_OP_PUSH: v = (int16_t)(operand[0] | operand[1] << 8); break;
+        case RULE_OP_VAR: v = env.var((RuleVar)operand[0], operand[1]); break;
+        case RULE_OP_EQ: v = a == b; break;
+        case RULE_OP_NE: v = a != b; break;
+        case RULE_OP_LT: v = a < b; break;
+        case RULE_OP_LE: v = a <= b; break;
+        case RULE_OP_GT: v = a > b; break;
+        case RULE_OP_GE: v = a >= b; break;
+        case RULE_OP_AND: v = a && b; break;
+        case RULE_OP_OR: v = a || b; break;
+        case RULE_OP_NOT: v = !b; break;
+        case RULE_OP_JUMP_IF_FALSE: if (!b) pc += operand[0]; break;
+        case RULE_OP_POWER: env.action(RULE_OP_POWER, operand[0], b); break;
+        case RULE_OP_TOGGLE: env.action(RULE_OP_TOGGLE, operand[0], 0); break;
+        case RULE_OP_BRIGHTNESS: env.action(RULE_OP_BRIGHTNESS, RULE_ALL_BULBS, b); break;
+        case RULE_OP_TEMP: env.action(RULE_OP_TEMP, RULE_ALL_BULBS, b); break;
+        case RULE_OP_CONSUME: result |= RULE_RESULT_CONSUMED; break;
+      }
+      if (pushes) stack[sp++] = v;
+    }
+  }
+  return result;
+}
+
+#endif
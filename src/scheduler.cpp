@@ -0,0 +1,57 @@
+#include <Arduino.h>
+#include "scheduler.h"
+#include "dimmer.h"
+
+TimerWheel timers;
+
+static TaskHandle_t loopTask = NULL;
+static volatile bool inputEdge = false;
+static uint32_t awakeUntil = 0;
+
+void schedulerBegin() {
+  loopTask = xTaskGetCurrentTaskHandle();
+  awakeUntil = millis() + INPUT_ACTIVE_MS;
+  Serial.onReceive([]() { schedulerWake(); });
+}
+
+void schedulerRun() {
+  if (inputEdge) {
+    inputEdge = false;
+    schedulerStayAwake(INPUT_ACTIVE_MS);
+  }
+  stats.timersRun += timers.advance(millis());
+}
+
+void schedulerStayAwake(uint32_t ms) {
+  uint32_t until = millis() + ms;
+  if ((int32_t)(until - awakeUntil) > 0) awakeUntil = until;
+}
+
+void schedulerSleep() {
+  uint32_t now = millis();
+  uint32_t sleepMs = LOOP_IDLE_MAX_MS;
+  if ((int32_t)(awakeUntil - now) > 0) sleepMs = LOOP_POLL_MS;
+
+  uint32_t next;
+  if (timers.nextExpiry(&next)) {
+    int32_t untilNext = (int32_t)(next - now);
+    if (untilNext < 0) untilNext = 0;
+    if ((uint32_t)untilNext < sleepMs) sleepMs = untilNext;
+  }
+
+  // A wake-up that arrived during the pass is still pending and returns at once
+  uint32_t start = millis();
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleepMs));
+  stats.sleptMs += millis() - start;
+}
+
+void schedulerWake() {
+  if (loopTask) xTaskNotifyGive(loopTask);
+}
+
+void IRAM_ATTR schedulerInputEdge() {
+  inputEdge = true;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(loopTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
@@ -0,0 +1,41 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "timer_wheel.h"
+
+// Loop scheduling (scheduler.cpp): one timer wheel (timer_wheel.h) for all
+// periodic and one-shot work, and the loop's sleep between passes.
+//
+// At the end of a pass the loop sleeps until the next timer is due or
+// something wakes it: button and encoder edges (GPIO interrupts), WiFi
+// events, web commands and console input. Sockets, button debounce and
+// console input left over after a pass's budget cannot wake it, so while a
+// module has something in motion (replies outstanding, a click being
+// timed) it calls schedulerStayAwake() and the loop polls every
+// LOOP_POLL_MS, as it always used to; consolePoll() wakes the loop itself
+// when input is left over. Even when idle it runs at least every
+// LOOP_IDLE_MAX_MS, well inside the watchdog timeout.
+
+const uint32_t LOOP_POLL_MS = 10;
+const uint32_t LOOP_IDLE_MAX_MS = 1000;
+const uint32_t INPUT_ACTIVE_MS = 1500;  // Polling after an input edge: debounce, double click, long press
+
+extern TimerWheel timers;  // Loop task only
+
+void schedulerBegin();  // From the loop task in setup(), before any wake source is attached
+void schedulerRun();    // Run due timers; call at the start of each pass
+void schedulerStayAwake(uint32_t ms);  // Poll every LOOP_POLL_MS for at least ms
+void schedulerSleep();  // Call at the end of each pass
+void schedulerWake();   // Any task
+void schedulerInputEdge();  // GPIO interrupt handler for the encoder and buttons
+
+inline void timerStart(WheelTimer* t, uint32_t delayMs, uint32_t periodMs = 0) {
+  timers.start(t, millis(), delayMs, periodMs);
+}
+
+inline void timerStop(WheelTimer* t) {
+  timers.stop(t);
+}
+
+#endif
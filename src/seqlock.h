@@ -0,0 +1,73 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Single-writer snapshot publication for readers on other tasks or cores,
+// shared by the firmware and tools/seqlock_stress.cpp.
+//
+// Two slots, each with a sequence number that is odd while the slot is
+// being written. write() fills the slot readers are not pointed at, then
+// flips the index, so it never waits and a reader only has to retry if the
+// writer finishes two whole writes during its copy. Payload words are
+// copied as relaxed atomics and ordered by the fences around them, so a
+// torn copy is detected by the sequence check rather than being undefined.
+//
+// T must be trivially copyable with a size that is a multiple of 4.
+
+template <typename T>
+class Seqlock {
+ public:
+  static const size_t WORDS = sizeof(T) / 4;
+
+  Seqlock() : index_(0) {
+    static_assert(sizeof(T) % 4 == 0, "Seqlock payload must be a multiple of 4 bytes");
+    for (int s = 0; s < 2; s++) {
+      seq_[s].store(0, std::memory_order_relaxed);
+      for (size_t i = 0; i < WORDS; i++) slots_[s][i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Writer side: one task only
+  void write(const T& value) {
+    uint32_t words[WORDS];
+    memcpy(words, &value, sizeof(T));
+    unsigned next = index_.load(std::memory_order_relaxed) ^ 1;
+    uint32_t seq = seq_[next].load(std::memory_order_relaxed);
+    seq_[next].store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) slots_[next][i].store(words[i], std::memory_order_relaxed);
+    seq_[next].store(seq + 2, std::memory_order_release);
+    index_.store(next, std::memory_order_release);
+  }
+
+  // One attempt; false if the slot changed during the copy
+  bool tryRead(T* out) const {
+    unsigned s = index_.load(std::memory_order_acquire);
+    uint32_t before = seq_[s].load(std::memory_order_acquire);
+    if (before & 1) return false;
+    uint32_t words[WORDS];
+    for (size_t i = 0; i < WORDS; i++) words[i] = slots_[s][i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_[s].load(std::memory_order_relaxed) != before) return false;
+    memcpy(out, words, sizeof(T));
+    return true;
+  }
+
+  // Returns the number of retries (almost always 0)
+  uint32_t read(T* out) const {
+    uint32_t retries = 0;
+    while (!tryRead(out)) retries++;
+    return retries;
+  }
+
+ private:
+  std::atomic<uint32_t> slots_[2][WORDS];
+  std::atomic<uint32_t> seq_[2];
+  std::atomic<unsigned> index_;
+};
+
+#endif
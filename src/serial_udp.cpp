@@ -0,0 +1,94 @@
+#include "serial_udp.h"
+
+const uint8_t SLIP_END = 0xC0;
+const uint8_t SLIP_ESC = 0xDB;
+const uint8_t SLIP_ESC_END = 0xDC;
+const uint8_t SLIP_ESC_ESC = 0xDD;
+const size_t HEADER_LEN = 6;
+
+SerialUdp::SerialUdp()
+  : txLen_(0), rxLen_(0), rxEscape_(false), rxOverflow_(false),
+    packetLen_(0), packetPos_(0), remotePort_(0) {}
+
+uint8_t SerialUdp::begin(uint16_t localPort) {
+  Serial2.begin(SERIAL_UDP_BAUD);
+  return 1;
+}
+
+int SerialUdp::beginPacket(IPAddress ip, uint16_t port) {
+  for (int i = 0; i < 4; i++) tx_[i] = ip[i];
+  tx_[4] = (uint8_t)(port >> 8);
+  tx_[5] = (uint8_t)port;
+  txLen_ = HEADER_LEN;
+  return 1;
+}
+
+size_t SerialUdp::write(const uint8_t* data, size_t len) {
+  if (len > sizeof(tx_) - txLen_) len = sizeof(tx_) - txLen_;
+  memcpy(tx_ + txLen_, data, len);
+  txLen_ += len;
+  return len;
+}
+
+void SerialUdp::writeEscaped(uint8_t c) {
+  if (c == SLIP_END) {
+    Serial2.write(SLIP_ESC);
+    Serial2.write(SLIP_ESC_END);
+  } else if (c == SLIP_ESC) {
+    Serial2.write(SLIP_ESC);
+    Serial2.write(SLIP_ESC_ESC);
+  } else {
+    Serial2.write(c);
+  }
+}
+
+int SerialUdp::endPacket() {
+  Serial2.write(SLIP_END);  // Flushes any line noise on the host side
+  for (size_t i = 0; i < txLen_; i++) writeEscaped(tx_[i]);
+  Serial2.write(SLIP_END);
+  txLen_ = 0;
+  return 1;
+}
+
+int SerialUdp::parsePacket() {
+  while (Serial2.available()) {
+    uint8_t c = (uint8_t)Serial2.read();
+    if (c == SLIP_END) {
+      bool complete = !rxOverflow_ && rxLen_ > HEADER_LEN;
+      size_t len = rxLen_;
+      rxLen_ = 0;
+      rxEscape_ = false;
+      rxOverflow_ = false;
+      if (!complete) continue;  // Empty frame or one that did not fit
+
+      remoteIp_ = IPAddress(rx_[0], rx_[1], rx_[2], rx_[3]);
+      remotePort_ = (uint16_t)((rx_[4] << 8) | rx_[5]);
+      packetLen_ = len - HEADER_LEN;
+      packetPos_ = 0;
+      memcpy(packet_, rx_ + HEADER_LEN, packetLen_);
+      return (int)packetLen_;
+    }
+    if (c == SLIP_ESC) {
+      rxEscape_ = true;
+      continue;
+    }
+    if (rxEscape_) {
+      c = c == SLIP_ESC_END ? SLIP_END : c == SLIP_ESC_ESC ? SLIP_ESC : c;
+      rxEscape_ = false;
+    }
+    if (rxLen_ == sizeof(rx_)) {
+      rxOverflow_ = true;
+    } else {
+      rx_[rxLen_++] = c;
+    }
+  }
+  return 0;
+}
+
+int SerialUdp::read(char* buf, size_t len) {
+  size_t n = packetLen_ - packetPos_;
+  if (n > len) n = len;
+  memcpy(buf, packet_ + packetPos_, n);
+  packetPos_ += n;
+  return (int)n;
+}
@@ -0,0 +1,47 @@
+#ifndef SERIAL_UDP_H
+#define SERIAL_UDP_H
+
+#include <Arduino.h>
+
+// Datagrams over a UART, for running the firmware where there is no WiFi
+// (QEMU_TARGET builds, see tools/qemu_run.sh). Implements the part of the
+// WiFiUDP interface that WizBackend uses. Each datagram is one SLIP frame
+// (RFC 1055) on UART2 holding [IPv4 address][port, big-endian][payload].
+// Going out the address is the destination; coming in it is the source.
+// tools/qemu_bridge.cpp turns the frames into real UDP on the host.
+
+const unsigned long SERIAL_UDP_BAUD = 921600;
+const int SERIAL_UDP_MAX = 512;  // Largest datagram, header included
+
+class SerialUdp {
+ public:
+  SerialUdp();
+
+  uint8_t begin(uint16_t localPort);
+  int beginPacket(IPAddress ip, uint16_t port);
+  size_t write(const uint8_t* data, size_t len);
+  int endPacket();
+
+  int parsePacket();  // Length of the next complete datagram, 0 if none yet
+  int read(char* buf, size_t len);
+  IPAddress remoteIP() const { return remoteIp_; }
+  uint16_t remotePort() const { return remotePort_; }
+  void flush() { packetLen_ = packetPos_ = 0; }
+
+ private:
+  void writeEscaped(uint8_t c);
+
+  uint8_t tx_[SERIAL_UDP_MAX];
+  size_t txLen_;
+  uint8_t rx_[SERIAL_UDP_MAX];
+  size_t rxLen_;
+  bool rxEscape_;
+  bool rxOverflow_;
+  uint8_t packet_[SERIAL_UDP_MAX];
+  size_t packetLen_;
+  size_t packetPos_;
+  IPAddress remoteIp_;
+  uint16_t remotePort_;
+};
+
+#endif
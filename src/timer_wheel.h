@@ -0,0 +1,205 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hierarchical timer wheel with millisecond ticks, shared by the firmware
+// (scheduler.cpp) and tools/timer_bench.cpp.
+//
+// Four levels of 64 slots span 64 ms, 4 s, 4.4 min and 4.7 h. A timer is
+// filed in the lowest level whose span holds its delay, and moves down
+// when the level below wraps (cascading). Starting, restarting and stopping
+// a timer are O(1) list operations. advance() jumps over empty stretches of
+// the bottom level, so a sleep of a minute costs about a thousand bitmap
+// checks rather than one step per millisecond. Longer delays wait in the
+// top level and are re-filed as they come into range.
+//
+// Timers are caller-owned nodes, usually static; the wheel never allocates.
+// Callbacks run from advance() and may start or stop any timer, their own
+// included. Times are millis() values and wrap like millis() does.
+
+typedef void (*TimerCallback)(void* ctx);
+
+struct WheelTimer {
+  WheelTimer* next;
+  WheelTimer** pprev;  // NULL while stopped
+  uint32_t expires;
+  uint32_t period;     // 0 = one-shot
+  uint16_t where;      // Level * slots + slot
+  TimerCallback fn;
+  void* ctx;
+
+  explicit WheelTimer(TimerCallback f, void* c = NULL)
+    : next(NULL), pprev(NULL), expires(0), period(0), where(0), fn(f), ctx(c) {}
+  bool active() const { return pprev != NULL; }
+};
+
+class TimerWheel {
+ public:
+  static const int LEVELS = 4;
+  static const int SLOT_BITS = 6;
+  static const uint32_t SLOTS = 1u << SLOT_BITS;
+  static const uint32_t SLOT_MASK = SLOTS - 1;
+
+  explicit TimerWheel(uint32_t now = 0) : now_(now), count_(0) {
+    for (int l = 0; l < LEVELS; l++) {
+      bits_[l] = 0;
+      for (uint32_t s = 0; s < SLOTS; s++) heads_[l][s] = NULL;
+    }
+  }
+
+  // (Re)start t to expire delayMs after now, then every periodMs if set
+  void start(WheelTimer* t, uint32_t now, uint32_t delayMs, uint32_t periodMs = 0) {
+    if (t->active()) unlink(t);
+    t->expires = now + delayMs;
+    t->period = periodMs;
+    file(t);
+  }
+
+  void stop(WheelTimer* t) {
+    if (t->active()) unlink(t);
+  }
+
+  // Runs every timer due at or before now; returns how many ran
+  uint32_t advance(uint32_t now) {
+    uint32_t ran = 0;
+    while ((int32_t)(now - now_) >= 0) {
+      uint32_t index = now_ & SLOT_MASK;
+      if (index == 0) cascade();
+
+      uint64_t due = bits_[0] >> index;
+      if (!due) {
+        uint32_t wrap = (now_ | SLOT_MASK) + 1;
+        if ((int32_t)(wrap - now) > 0) {
+          now_ = now + 1;
+          break;
+        }
+        now_ = wrap;
+        continue;
+      }
+      uint32_t slot = index + (uint32_t)__builtin_ctzll(due);
+      uint32_t tick = now_ + (slot - index);
+      if ((int32_t)(tick - now) > 0) {
+        now_ = now + 1;
+        break;
+      }
+      now_ = tick + 1;  // Anything the callbacks start from here on is filed after this tick
+      ran += expire(slot, tick);
+    }
+    return ran;
+  }
+
+  // Earliest expiry among running timers (possibly already past); false if none
+  bool nextExpiry(uint32_t* at) const {
+    if (!count_) return false;
+    bool found = false;
+    uint32_t best = 0;
+    for (int l = 0; l < LEVELS; l++) {
+      if (!bits_[l]) continue;
+      // Next slot this level processes: bottom level at now_, higher levels
+      // at their next cascade (now_ itself if it is a boundary not yet run)
+      uint32_t shift = SLOT_BITS * l;
+      uint32_t startSlot = (now_ >> shift) & SLOT_MASK;
+      if (l > 0 && (now_ & ((1u << shift) - 1))) startSlot = (startSlot + 1) & SLOT_MASK;
+      uint64_t rotated = startSlot ? (bits_[l] >> startSlot) | (bits_[l] << (SLOTS - startSlot)) : bits_[l];
+      uint32_t slot = (startSlot + (uint32_t)__builtin_ctzll(rotated)) & SLOT_MASK;
+      // That slot holds the level's earliest timer, except at the top level,
+      // where delays beyond its span are parked out of order
+      uint64_t scan = l == LEVELS - 1 ? bits_[l] : 1ull << slot;
+      for (; scan; scan &= scan - 1) {
+        uint32_t s = (uint32_t)__builtin_ctzll(scan);
+        for (const WheelTimer* t = heads_[l][s]; t; t = t->next) {
+          if (!found || (int32_t)(t->expires - best) < 0) best = t->expires;
+          found = true;
+        }
+      }
+    }
+    *at = best;
+    return found;
+  }
+
+  uint32_t pending() const { return count_; }
+
+ private:
+  static const uint16_t WHERE_EXPIRING = 0xFFFF;
+
+  void file(WheelTimer* t) {
+    uint32_t expires = t->expires;
+    if ((int32_t)(expires - now_) < 0) expires = now_;  // Overdue: next tick
+    uint32_t delta = expires - now_;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (1u << (SLOT_BITS * (level + 1)))) level++;
+    if (delta >= (1u << (SLOT_BITS * LEVELS))) expires = now_ + (1u << (SLOT_BITS * LEVELS)) - 1;
+    uint32_t slot = (expires >> (SLOT_BITS * level)) & SLOT_MASK;
+
+    WheelTimer** head = &heads_[level][slot];
+    t->next = *head;
+    if (t->next) t->next->pprev = &t->next;
+    t->pprev = head;
+    *head = t;
+    t->where = (uint16_t)(level * SLOTS + slot);
+    bits_[level] |= 1ull << slot;
+    count_++;
+  }
+
+  void unlink(WheelTimer* t) {
+    *t->pprev = t->next;
+    if (t->next) t->next->pprev = t->pprev;
+    if (t->where != WHERE_EXPIRING) {
+      uint32_t level = t->where / SLOTS;
+      uint32_t slot = t->where % SLOTS;
+      if (!heads_[level][slot]) bits_[level] &= ~(1ull << slot);
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+    count_--;
+  }
+
+  // Move the higher-level slots that now fall within range down a level
+  void cascade() {
+    for (int l = 1; l < LEVELS; l++) {
+      uint32_t index = (now_ >> (SLOT_BITS * l)) & SLOT_MASK;
+      WheelTimer* list = heads_[l][index];
+      heads_[l][index] = NULL;
+      bits_[l] &= ~(1ull << index);
+      while (list) {
+        WheelTimer* t = list;
+        list = t->next;
+        count_--;
+        file(t);
+      }
+      if (index) break;
+    }
+  }
+
+  uint32_t expire(uint32_t slot, uint32_t tick) {
+    // Take the slot as a work list so callbacks can stop timers still on it
+    WheelTimer* work = heads_[0][slot];
+    heads_[0][slot] = NULL;
+    bits_[0] &= ~(1ull << slot);
+    if (work) work->pprev = &work;
+    for (WheelTimer* t = work; t; t = t->next) t->where = WHERE_EXPIRING;
+
+    uint32_t ran = 0;
+    while (work) {
+      WheelTimer* t = work;
+      unlink(t);
+      if (t->period) {
+        t->expires += t->period;
+        if ((int32_t)(t->expires - tick) <= 0) t->expires = tick + t->period;  // Fell behind: skip the missed runs
+        file(t);
+      }
+      ran++;
+      t->fn(t->ctx);
+    }
+    return ran;
+  }
+
+  WheelTimer* heads_[LEVELS][SLOTS];
+  uint64_t bits_[LEVELS];
+  uint32_t now_;    // Next tick to process
+  uint32_t count_;  // Running timers
+};
+
+#endif
@@ -0,0 +1,243 @@
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <time.h>
+#include "usage.h"
+#include "usage_codec.h"
+#include "dimmer.h"
+#include "scheduler.h"
+
+// Records are buffered in RAM and written in one go, so a typical evening of
+// use costs one or two flash writes. Each sector is erased once per trip
+// around the ring.
+const unsigned long USAGE_FLUSH_INTERVAL_MS = 15UL * 60 * 1000;
+const size_t USAGE_FLUSH_AT_BYTES = 192;
+const unsigned long USAGE_SETTLE_MS = 2000;  // Brightness must rest this long to be recorded
+const uint32_t USAGE_MIN_UNIX_TIME = 1600000000;  // Anything earlier means NTP has not synced
+
+static const esp_partition_t* partition = NULL;
+static uint32_t sectorCount = 0;
+static uint32_t sector = 0;       // Sector being written
+static uint32_t sectorSeq = 0;
+static uint32_t writeOffset = 0;  // Flash bytes used in the current sector
+
+static uint8_t pending[256];
+static size_t pendingLen = 0;
+
+static void flushPending(void*);
+static WheelTimer flushTimer(flushPending);  // USAGE_FLUSH_INTERVAL_MS after the oldest buffered record
+
+static unsigned long clockMs = 0;  // millis() the previous record's dt counts from
+
+static uint8_t loggedMask = 0;
+static int loggedDimming = 0;
+static int loggedTemp = 0;
+static bool timeLogged = false;
+
+static int lastBrightness = -1;
+static void recordSettledBrightness(void*);
+static WheelTimer settleTimer(recordSettledBrightness);  // Restarted by every detent
+
+static uint32_t unixTimeNow() {
+  time_t t = time(NULL);
+  return t >= (time_t)USAGE_MIN_UNIX_TIME ? (uint32_t)t : 0;
+}
+
+static uint8_t powerMask() {
+  return (studyLampOn ? 1 : 0) | (uplightOn ? 2 : 0);
+}
+
+static uint32_t takeDt() {
+  uint32_t dt = (millis() - clockMs) / 1000;
+  clockMs += dt * 1000;  // Keep the remainder so dt does not drift
+  return dt;
+}
+
+void usageFlush() {
+  if (!partition || pendingLen == 0) return;
+  timerStop(&flushTimer);
+  esp_err_t err = esp_partition_write(partition, sector * USAGE_SECTOR_SIZE + writeOffset, pending, pendingLen);
+  if (err != ESP_OK) {
+    logMsg<LOG_USAGE_WRITE_FAILED>(err);
+  }
+  writeOffset += pendingLen;
+  pendingLen = 0;
+  stats.usageFlashWrites++;
+}
+
+static void buildSnapshot(uint8_t* rec, size_t* len) {
+  size_t n = usagePutHead(rec, 0, USAGE_SNAPSHOT);
+  rec[n++] = powerMask();
+  n += logPutVarint(rec + n, (uint32_t)brightness);
+  n += logPutVarint(rec + n, (uint32_t)colorTemp / 100);
+  *len = n;
+  loggedMask = powerMask();
+  loggedDimming = brightness;
+  loggedTemp = colorTemp;
+}
+
+static void queueBytes(const uint8_t* rec, size_t len) {
+  if (pendingLen == 0) timerStart(&flushTimer, USAGE_FLUSH_INTERVAL_MS);
+  memcpy(pending + pendingLen, rec, len);
+  pendingLen += len;
+}
+
+static void openNextSector() {
+  sector = (sector + 1) % sectorCount;
+  esp_partition_erase_range(partition, sector * USAGE_SECTOR_SIZE, USAGE_SECTOR_SIZE);
+  stats.usageSectorErases++;
+
+  UsageSectorHeader header = {USAGE_MAGIC, ++sectorSeq, unixTimeNow()};
+  esp_partition_write(partition, sector * USAGE_SECTOR_SIZE, &header, sizeof(header));
+  writeOffset = sizeof(header);
+  clockMs = millis();
+
+  // Each sector carries its own delta base
+  uint8_t rec[USAGE_RECORD_MAX];
+  size_t len;
+  buildSnapshot(rec, &len);
+  queueBytes(rec, len);
+}
+
+static void appendRecord(const uint8_t* rec, size_t len) {
+  if (pendingLen + len > sizeof(pending)) usageFlush();
+  if (writeOffset + pendingLen + len + USAGE_RECORD_MAX > USAGE_SECTOR_SIZE) {
+    usageFlush();
+    openNextSector();
+    // The new sector's snapshot already holds the current state; only
+    // clock records still need writing
+    UsageKind kind = (UsageKind)(rec[0] & 7);
+    if (kind != USAGE_BOOT && kind != USAGE_TIME) return;
+  }
+  queueBytes(rec, len);
+  stats.usageRecords++;
+}
+
+static void appendValue(UsageKind kind, uint32_t value) {
+  uint8_t rec[USAGE_RECORD_MAX];
+  size_t n = usagePutHead(rec, takeDt(), kind);
+  if (kind == USAGE_POWER) {
+    rec[n++] = (uint8_t)value;
+  } else {
+    n += logPutVarint(rec + n, value);
+  }
+  appendRecord(rec, n);
+}
+
+// Find the newest sector and the end of its records
+static void findWritePosition() {
+  const void* mapped;
+  spi_flash_mmap_handle_t handle;
+  if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapped, &handle) != ESP_OK) {
+    sector = sectorCount - 1;  // Start over at sector 0
+    openNextSector();
+    return;
+  }
+
+  const uint8_t* base = (const uint8_t*)mapped;
+  bool found = false;
+  for (uint32_t i = 0; i < sectorCount; i++) {
+    const UsageSectorHeader* header = (const UsageSectorHeader*)(base + i * USAGE_SECTOR_SIZE);
+    if (header->magic == USAGE_MAGIC && (!found || (int32_t)(header->seq - sectorSeq) > 0)) {
+      found = true;
+      sector = i;
+      sectorSeq = header->seq;
+    }
+  }
+
+  if (found) {
+    const uint8_t* p = base + sector * USAGE_SECTOR_SIZE;
+    size_t offset = sizeof(UsageSectorHeader);
+    size_t len;
+    while ((len = usageRecordLength(p + offset, USAGE_SECTOR_SIZE - offset)) > 0) {
+      offset += len;
+    }
+    writeOffset = offset;
+    // A torn write leaves non-0xFF garbage behind the last record; do not append after it
+    if (offset < USAGE_SECTOR_SIZE && p[offset] != 0xFF) writeOffset = USAGE_SECTOR_SIZE;
+  }
+  spi_flash_munmap(handle);
+
+  clockMs = millis();
+  if (!found || writeOffset + 2 * USAGE_RECORD_MAX > USAGE_SECTOR_SIZE) {
+    if (!found) sector = sectorCount - 1;
+    openNextSector();
+  }
+}
+
+void usageBegin() {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "usage");
+  if (!partition) {
+    logMsg<LOG_USAGE_NO_PARTITION>();
+    return;
+  }
+  sectorCount = partition->size / USAGE_SECTOR_SIZE;
+  findWritePosition();
+
+  uint8_t rec[USAGE_RECORD_MAX];
+  size_t n = usagePutHead(rec, 0, USAGE_BOOT);
+  n += logPutVarint(rec + n, unixTimeNow());
+  timeLogged = unixTimeNow() != 0;
+  appendRecord(rec, n);
+
+  size_t len;
+  buildSnapshot(rec, &len);
+  appendRecord(rec, len);
+
+  lastBrightness = brightness;
+  logMsg<LOG_USAGE_READY>(sectorCount, sectorSeq, writeOffset);
+}
+
+static void flushPending(void*) {
+  usageFlush();
+}
+
+static void recordSettledBrightness(void*) {
+  // A change made later in the pass that started this one has not been seen yet
+  if (brightness != lastBrightness || brightness == loggedDimming) return;
+  uint32_t delta = usageZigzag(brightness - loggedDimming);
+  loggedDimming = brightness;
+  appendValue(USAGE_DIMMING, delta);
+}
+
+void usagePoll() {
+  if (!partition) return;
+
+  uint8_t mask = powerMask();
+  if (mask != loggedMask) {
+    loggedMask = mask;
+    appendValue(USAGE_POWER, mask);
+  }
+
+  // Record where the knob comes to rest, not every detent on the way
+  if (brightness != lastBrightness) {
+    lastBrightness = brightness;
+    timerStart(&settleTimer, USAGE_SETTLE_MS);
+  }
+
+  if (colorTemp != loggedTemp) {
+    loggedTemp = colorTemp;
+    appendValue(USAGE_TEMP, (uint32_t)colorTemp / 100);
+  }
+
+  if (!timeLogged) {
+    uint32_t t = unixTimeNow();
+    if (t) {
+      timeLogged = true;
+      appendValue(USAGE_TIME, t);
+    }
+  }
+
+  if (pendingLen >= USAGE_FLUSH_AT_BYTES) usageFlush();
+}
+
+void usagePrintStatus() {
+  if (!partition) {
+    Serial.println("  No \"usage\" partition");
+    return;
+  }
+  Serial.printf("  Partition: %u sectors at 0x%x  Current: #%u (seq %u), %u bytes used\n",
+    sectorCount, partition->address, sector, sectorSeq, writeOffset);
+  Serial.printf("  Buffered: %u bytes  Records: %u  Flash writes: %u  Sector erases: %u\n",
+    (unsigned)pendingLen, stats.usageRecords, stats.usageFlashWrites, stats.usageSectorErases);
+  Serial.printf("  Ring wraps: %u (each sector erased once per wrap)\n", sectorSeq / sectorCount);
+}
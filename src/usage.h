@@ -0,0 +1,12 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+// Usage history: power, brightness and color temperature changes recorded
+// to the "usage" flash partition (see usage_codec.h for the format and
+// tools/usage_report.cpp for analysis).
+void usageBegin();
+void usagePoll();  // Call every loop pass; writes to flash at most every 15 min
+void usageFlush();
+void usagePrintStatus();
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef USAGE_CODEC_H
+#define USAGE_CODEC_H
+
+#include <stdint.h>
+#include "log_codec.h"  // Varint helpers
+
+// On-flash format of the usage ring, shared by usage.cpp and tools/usage_report.cpp.
+//
+// The "usage" partition is a ring of 4 KB sectors. Each sector starts with a
+// UsageSectorHeader and a USAGE_SNAPSHOT record, so it decodes on its own,
+// followed by records up to the first 0xFF (erased) byte. The sector with
+// the highest seq is the one being written.
+//
+// A record is varint((dtSeconds << 3) | kind) followed by its payload; dt is
+// the time since the previous record in the same sector. Kind 7 is never
+// used, so 0xFF can never start a record.
+
+const uint32_t USAGE_MAGIC = 0x31555A57;  // "WZU1"
+const uint32_t USAGE_SECTOR_SIZE = 4096;
+const int USAGE_MAX_BULBS = 8;
+
+struct UsageSectorHeader {
+  uint32_t magic;
+  uint32_t seq;       // Sectors written since the ring was created
+  uint32_t unixTime;  // Wall clock at sector start, 0 if not yet known
+};
+
+enum UsageKind : uint8_t {
+  USAGE_BOOT = 1,      // varint unix time (0 = unknown); the clock restarts here
+  USAGE_TIME = 2,      // varint unix time, written once NTP syncs
+  USAGE_POWER = 3,     // u8 mask of bulbs that are on
+  USAGE_DIMMING = 4,   // zigzag varint change in brightness
+  USAGE_TEMP = 5,      // varint color temperature / 100
+  USAGE_SNAPSHOT = 6,  // u8 power mask, varint brightness, varint temp / 100
+};
+
+const int USAGE_RECORD_MAX = 2 * LOG_VARINT_MAX + 3;
+
+inline uint32_t usageZigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t usageUnzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+inline size_t usagePutHead(uint8_t* out, uint32_t dtSeconds, UsageKind kind) {
+  return logPutVarint(out, (dtSeconds << 3) | kind);
+}
+
+// Length of the record at p, or 0 at the end of the written area (0xFF) or
+// if the record is malformed or runs past len.
+inline size_t usageRecordLength(const uint8_t* p, size_t len) {
+  uint32_t head;
+  size_t n = logGetVarint(p, len, &head);
+  if (n == 0 || p[0] == 0xFF) return 0;
+
+  uint32_t v;
+  size_t m;
+  switch (head & 7) {
+    case USAGE_BOOT:
+    case USAGE_TIME:
+    case USAGE_DIMMING:
+    case USAGE_TEMP:
+      m = logGetVarint(p + n, len - n, &v);
+      return m ? n + m : 0;
+    case USAGE_POWER:
+      return n + 1 <= len ? n + 1 : 0;
+    case USAGE_SNAPSHOT:
+      if (n + 1 > len) return 0;
+      n += 1;
+      m = logGetVarint(p + n, len - n, &v);
+      if (!m) return 0;
+      n += m;
+      m = logGetVarint(p + n, len - n, &v);
+      return m ? n + m : 0;
+    default:
+      return 0;
+  }
+}
+
+#endif
@@ -0,0 +1,258 @@
+#include <Arduino.h>
+#include <atomic>
+#include <AsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#include "web.h"
+#include "web_ui.h"
+#include "dimmer.h"
+#include "lights.h"
+#include "scheduler.h"
+
+const int WEB_PORT = 80;
+const unsigned long WEB_PUSH_INTERVAL_MS = 50;  // Coalesce fast encoder turns into one frame
+const int WEB_COMMAND_QUEUE_LEN = 16;
+const int WEB_HELLO_QUEUE_LEN = 8;
+const uint32_t WEB_PUSH_STACK = 3072;
+const UBaseType_t WEB_PUSH_PRIORITY = 1;  // Same as the loop; it runs while the loop sleeps
+
+struct WebCommand {
+  uint8_t op;
+  uint32_t value;
+};
+
+static AsyncWebServer server(WEB_PORT);
+static AsyncWebSocket ws("/ws");
+static QueueHandle_t commands = NULL;
+static QueueHandle_t hellos = NULL;  // IDs of new clients waiting for a snapshot
+static TaskHandle_t pushTask = NULL;
+static std::atomic<int> clientCount(0);
+
+// AsyncWebSocket (1.2.3) does not lock its client list or the clients'
+// message queues, and both the AsyncTCP task and the push task use them.
+// Every ws call below and the socket event callback hold this lock.
+// Recursive, because a call into ws can end in the event callback on the
+// same task (cleanupClients() closing a client).
+static SemaphoreHandle_t wsLock = NULL;
+
+struct SocketLock {
+  SocketLock() { xSemaphoreTakeRecursive(wsLock, portMAX_DELAY); }
+  ~SocketLock() { xSemaphoreGiveRecursive(wsLock); }
+};
+
+// Push task only: the state the clients were last sent, which deltas are
+// taken against
+static uint8_t published[WEB_FIELD_COUNT];
+static bool publishedValid = false;
+static uint32_t publishedVersion = 0;
+static unsigned long lastPush = 0;
+
+static void captureState(const ControllerSnapshot& s, uint8_t* fields) {
+  fields[WEB_FIELD_BRIGHTNESS] = (uint8_t)s.brightness;
+  fields[WEB_FIELD_POWER] = s.powerMask;
+  fields[WEB_FIELD_TEMP] = (uint8_t)(s.colorTemp / 100);
+  fields[WEB_FIELD_ALIVE] = s.aliveMask;
+}
+
+// AsyncTCP task: never touch controller state or send here, only enqueue
+static void onSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
+                          AwsEventType type, void* arg, uint8_t* data, size_t len) {
+  SocketLock lock;  // Waits out a fan-out in progress on the push task
+  if (type == WS_EVT_CONNECT) {
+    clientCount++;
+    uint32_t id = client->id();
+    if (xQueueSend(hellos, &id, 0) != pdTRUE) {
+      __atomic_fetch_add(&stats.webCommandsDropped, 1, __ATOMIC_RELAXED);
+    }
+    xTaskNotifyGive(pushTask);
+    return;
+  }
+  if (type == WS_EVT_DISCONNECT) {
+    clientCount--;
+    return;
+  }
+  if (type != WS_EVT_DATA) return;
+
+  AwsFrameInfo* info = (AwsFrameInfo*)arg;
+  if (!info->final || info->index != 0 || info->len != 2 || len != 2) return;
+  WebCommand cmd;
+  cmd.op = data[0];
+  cmd.value = data[1];
+  if (xQueueSend(commands, &cmd, 0) != pdTRUE) {
+    __atomic_fetch_add(&stats.webCommandsDropped, 1, __ATOMIC_RELAXED);
+  }
+  schedulerWake();
+}
+
+static void applyCommand(const WebCommand& cmd) {
+  switch (cmd.op) {
+    case WEB_OP_BRIGHTNESS:
+      setBrightness((int)cmd.value);
+      break;
+    case WEB_OP_STUDY:
+      if ((cmd.value != 0) != studyLampOn) setStudyLamp(cmd.value != 0);
+      break;
+    case WEB_OP_UPLIGHT:
+      if ((cmd.value != 0) != uplightOn) setUplight(cmd.value != 0);
+      break;
+    case WEB_OP_BOTH:
+      setBothLights(cmd.value != 0);
+      break;
+    case WEB_OP_TEMP:
+      if (cmd.value < 4) applyColorTemp((int)cmd.value);
+      break;
+  }
+}
+
+static void serveIndex(AsyncWebServerRequest* request) {
+  if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == WEB_UI_ETAG) {
+    AsyncWebServerResponse* response = request->beginResponse(304);
+    response->addHeader("ETag", WEB_UI_ETAG);
+    request->send(response);
+    return;
+  }
+  AsyncWebServerResponse* response =
+    request->beginResponse_P(200, "text/html", WEB_UI_INDEX_GZ, WEB_UI_INDEX_GZ_LEN);
+  response->addHeader("Content-Encoding", "gzip");
+  response->addHeader("ETag", WEB_UI_ETAG);
+  response->addHeader("Cache-Control", "no-cache");  // Revalidate; unchanged pages cost a 304
+  request->send(response);
+}
+
+// GET /. The request only keeps the headers some handler has asked for,
+// and a plain server.on() handler cannot ask before they are parsed
+class IndexHandler : public AsyncWebHandler {
+ public:
+  bool canHandle(AsyncWebServerRequest* request) override {
+    if (request->method() != HTTP_GET || request->url() != "/") return false;
+    request->addInterestingHeader("If-None-Match");
+    return true;
+  }
+  void handleRequest(AsyncWebServerRequest* request) override { serveIndex(request); }
+};
+
+static IndexHandler indexHandler;
+
+// Runs on the AsyncTCP task: reads the published snapshot, never the globals
+static void serveState(AsyncWebServerRequest* request) {
+  ControllerSnapshot s;
+  readControllerState(&s);
+  char json[160];
+  snprintf(json, sizeof(json),
+    "{\"version\":%u,\"ageMs\":%lu,\"brightness\":%d,\"temp\":%d,"
+    "\"study\":%s,\"uplight\":%s,\"alive\":%u}",
+    s.version, millis() - s.changedAtMs, s.brightness, s.colorTemp,
+    (s.powerMask & 1) ? "true" : "false", (s.powerMask & 2) ? "true" : "false", s.aliveMask);
+  request->send(200, "application/json", json);
+}
+
+// Push task: everything that goes out on the sockets. A send blocks until
+// the TCP/IP task has taken the data, so it is kept off the loop, which
+// only wakes this task (webStateChanged()). Sends hold wsLock against the
+// AsyncTCP task's own use of the client list.
+static void pushState(const ControllerSnapshot& s) {
+  publishedVersion = s.version;
+  uint8_t current[WEB_FIELD_COUNT];
+  captureState(s, current);
+
+  uint8_t frame[2 + WEB_FIELD_COUNT];
+  size_t len = 2;
+  uint8_t changed = 0;
+  for (int i = 0; i < WEB_FIELD_COUNT; i++) {
+    if (publishedValid && current[i] == published[i]) continue;
+    changed |= 1 << i;
+    frame[len++] = current[i];
+  }
+  if (!changed) return;
+
+  memcpy(published, current, sizeof(published));
+  publishedValid = true;
+  lastPush = millis();
+
+  SocketLock lock;
+  size_t clients = ws.count();
+  if (clients == 0) return;
+
+  frame[0] = WEB_FRAME_DELTA;
+  frame[1] = changed;
+  uint32_t start = micros();
+  ws.binaryAll(frame, len);
+  uint32_t us = micros() - start;
+
+  // Atomic: the loop task prints these and clears them on reset
+  __atomic_fetch_add(&stats.webFrames, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&stats.webFanoutUs, us, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&stats.webFanoutClients, (uint32_t)clients, __ATOMIC_RELAXED);
+  if (us > __atomic_load_n(&stats.webFanoutMaxUs, __ATOMIC_RELAXED)) {
+    __atomic_store_n(&stats.webFanoutMaxUs, us, __ATOMIC_RELAXED);  // Only this task raises it
+  }
+  ws.cleanupClients();
+}
+
+// New clients get the state the next delta will be taken against
+static void sendSnapshot(uint32_t client) {
+  uint8_t frame[1 + WEB_FIELD_COUNT];
+  frame[0] = WEB_FRAME_SNAPSHOT;
+  memcpy(frame + 1, published, sizeof(published));
+  SocketLock lock;
+  ws.binary(client, frame, sizeof(frame));
+}
+
+static void pushTaskMain(void*) {
+  ControllerSnapshot s;
+  readControllerState(&s);
+  pushState(s);
+  for (;;) {
+    TickType_t wait = portMAX_DELAY;
+    readControllerState(&s);
+    if (s.version != publishedVersion) {
+      unsigned long sinceLast = millis() - lastPush;
+      if (sinceLast >= WEB_PUSH_INTERVAL_MS) {
+        pushState(s);
+      } else {
+        wait = pdMS_TO_TICKS(WEB_PUSH_INTERVAL_MS - sinceLast);
+      }
+    }
+    uint32_t client;
+    while (xQueueReceive(hellos, &client, 0) == pdTRUE) sendSnapshot(client);
+    ulTaskNotifyTake(pdTRUE, wait);
+  }
+}
+
+void webBegin() {
+  commands = xQueueCreate(WEB_COMMAND_QUEUE_LEN, sizeof(WebCommand));
+  hellos = xQueueCreate(WEB_HELLO_QUEUE_LEN, sizeof(uint32_t));
+  wsLock = xSemaphoreCreateRecursiveMutex();
+  // On the loop's core, away from the WiFi and TCP tasks on core 0
+  xTaskCreatePinnedToCore(pushTaskMain, "webpush", WEB_PUSH_STACK, NULL, WEB_PUSH_PRIORITY, &pushTask,
+    ARDUINO_RUNNING_CORE);
+  ws.onEvent(onSocketEvent);
+  server.addHandler(&ws);
+  server.addHandler(&indexHandler);
+  server.on("/state", HTTP_GET, serveState);
+  server.onNotFound([](AsyncWebServerRequest* request) { request->send(404); });
+  server.begin();
+}
+
+void webPoll() {
+  WebCommand cmd;
+  while (xQueueReceive(commands, &cmd, 0) == pdTRUE) {
+    applyCommand(cmd);
+  }
+}
+
+void webStateChanged() {
+  if (pushTask) xTaskNotifyGive(pushTask);
+}
+
+void webPrintStatus() {
+  uint32_t frames = __atomic_load_n(&stats.webFrames, __ATOMIC_RELAXED);
+  uint32_t fanoutUs = __atomic_load_n(&stats.webFanoutUs, __ATOMIC_RELAXED);
+  uint32_t fanoutClients = __atomic_load_n(&stats.webFanoutClients, __ATOMIC_RELAXED);
+  Serial.printf("  Clients: %u  Frames pushed: %u  Commands dropped: %u\n",
+    (unsigned)clientCount.load(), frames, __atomic_load_n(&stats.webCommandsDropped, __ATOMIC_RELAXED));
+  if (frames) {
+    Serial.printf("  Fan-out: %u us avg, %u us max, %u us per client\n",
+      fanoutUs / frames, __atomic_load_n(&stats.webFanoutMaxUs, __ATOMIC_RELAXED),
+      fanoutClients ? fanoutUs / fanoutClients : 0);
+  }
+}
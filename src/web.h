@@ -0,0 +1,49 @@
+#ifndef WEB_H
+#define WEB_H
+
+#include <stdint.h>
+
+// Phone control page and live state push (web.cpp).
+//
+// GET / serves the pre-gzipped page from web_ui.h with an ETag. GET /state
+// returns the published ControllerSnapshot as JSON. /ws is a WebSocket
+// carrying small binary frames:
+//
+//   server -> client  [WEB_FRAME_SNAPSHOT, brightness, power mask, temp/100, alive mask]
+//                     [WEB_FRAME_DELTA, changed bits, one byte per changed field]
+//   client -> server  [WebOp, value]
+//
+// The socket callbacks run on the AsyncTCP task and only enqueue. webPoll()
+// applies commands on the main loop. Frames go out from a push task of
+// their own, which sends each new client a snapshot and, at most every
+// 50 ms, one delta to all of them; the loop's share is webStateChanged()
+// waking it.
+
+enum WebFrame : uint8_t {
+  WEB_FRAME_SNAPSHOT = 0,
+  WEB_FRAME_DELTA = 1,
+};
+
+// Field order in frames and bit order in the delta's changed mask
+enum WebField : uint8_t {
+  WEB_FIELD_BRIGHTNESS = 0,
+  WEB_FIELD_POWER = 1,  // bit 0 study lamp, bit 1 uplight
+  WEB_FIELD_TEMP = 2,   // Kelvin / 100, 0 = never set
+  WEB_FIELD_ALIVE = 3,  // Bulbs answering, same bits as power
+  WEB_FIELD_COUNT
+};
+
+enum WebOp : uint8_t {
+  WEB_OP_BRIGHTNESS = 1,
+  WEB_OP_STUDY = 2,
+  WEB_OP_UPLIGHT = 3,
+  WEB_OP_BOTH = 4,
+  WEB_OP_TEMP = 5,   // Value = color temp mode 0-3
+};
+
+void webBegin();
+void webPoll();  // Call every loop pass
+void webStateChanged();  // Loop task, after publishing a new snapshot
+void webPrintStatus();
+
+#endif
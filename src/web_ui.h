@@ -0,0 +1,103 @@
+// Generated by tools/embed_ui.py from web/index.html - do not edit
+#ifndef WEB_UI_H
+#define WEB_UI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WEB_UI_ETAG "\"39b14ba4f79efcd9\""
+
+// 3203 bytes raw, 1395 bytes gzipped
+static const size_t WEB_UI_INDEX_GZ_LEN = 1395;
+static const uint8_t WEB_UI_INDEX_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0x57, 0x6d, 0x6f, 0xdb, 0x36,
+  0x10, 0xfe, 0xee, 0x5f, 0x71, 0x51, 0xd1, 0x42, 0x82, 0x6d, 0x59, 0x72, 0x92, 0x36, 0x89, 0x25,
+  0x0f, 0x6d, 0x9a, 0x02, 0xc5, 0x32, 0xb4, 0x58, 0x52, 0x0c, 0x83, 0xe1, 0x0f, 0xb4, 0x44, 0xd9,
+  0x44, 0x69, 0x51, 0x23, 0xa9, 0xb8, 0x5e, 0x9b, 0xff, 0xbe, 0x23, 0x29, 0x39, 0x72, 0x12, 0x77,
+  0x68, 0x1c, 0x58, 0x14, 0x79, 0xf7, 0xdc, 0x0b, 0x9f, 0x3b, 0xd2, 0xc9, 0xd1, 0xfb, 0x4f, 0x97,
+  0xb7, 0x7f, 0x7f, 0xbe, 0x82, 0x95, 0x5e, 0xf3, 0x69, 0x2f, 0x31, 0x0f, 0xe0, 0xa4, 0x5c, 0xa6,
+  0x1e, 0x2d, 0x3d, 0x33, 0x41, 0x49, 0x8e, 0x8f, 0x35, 0xd5, 0x04, 0xb2, 0x15, 0x91, 0x8a, 0xea,
+  0xd4, 0xab, 0x75, 0x31, 0x3c, 0xf3, 0xda, 0xe9, 0x92, 0xac, 0x69, 0xea, 0xdd, 0x31, 0xba, 0xa9,
+  0x84, 0xd4, 0x1e, 0x64, 0xa2, 0xd4, 0xb4, 0x44, 0xb1, 0x0d, 0xcb, 0xf5, 0x2a, 0xcd, 0xe9, 0x1d,
+  0xcb, 0xe8, 0xd0, 0xbe, 0x0c, 0x80, 0x95, 0x4c, 0x33, 0xc2, 0x87, 0x2a, 0x23, 0x9c, 0xa6, 0xb1,
+  0x01, 0xd1, 0x4c, 0x73, 0x3a, 0xfd, 0x54, 0x14, 0x28, 0x06, 0xef, 0xd9, 0x7a, 0x4d, 0x65, 0x32,
+  0x72, 0x93, 0xbd, 0x44, 0xe9, 0xad, 0x79, 0x2e, 0x44, 0xbe, 0x85, 0xef, 0x50, 0x20, 0xf4, 0xb0,
+  0x20, 0x6b, 0xc6, 0xb7, 0x17, 0xa0, 0xb6, 0x4a, 0xd3, 0xf5, 0xb0, 0x66, 0x03, 0x50, 0xa4, 0x54,
+  0x43, 0x45, 0x25, 0x2b, 0x26, 0xb0, 0x26, 0x72, 0xc9, 0xca, 0x0b, 0x88, 0x26, 0x50, 0x91, 0x3c,
+  0x67, 0xe5, 0xf2, 0x02, 0xe2, 0xf0, 0x94, 0xae, 0x27, 0xb0, 0x20, 0xd9, 0xd7, 0xa5, 0x14, 0x75,
+  0x99, 0x5f, 0xc0, 0x8b, 0x78, 0x81, 0x1f, 0x94, 0xcf, 0x04, 0x17, 0x12, 0xdf, 0x29, 0xa5, 0x46,
+  0xf9, 0x9b, 0xf3, 0xf4, 0x02, 0xc6, 0x67, 0x46, 0xe5, 0xbe, 0xb7, 0x8a, 0x5b, 0xc3, 0x8a, 0xfd,
+  0x4b, 0x0d, 0xd6, 0xb1, 0x59, 0xd8, 0x99, 0xc1, 0x4f, 0xec, 0x24, 0x43, 0x29, 0x36, 0x28, 0x9b,
+  0x33, 0x55, 0x71, 0x82, 0x0e, 0x16, 0x9c, 0x7e, 0x9b, 0xc0, 0x92, 0x54, 0x17, 0x10, 0xbe, 0xee,
+  0xea, 0x84, 0x08, 0x6d, 0xfc, 0xbb, 0xef, 0x2d, 0x6a, 0xad, 0x45, 0x69, 0x0c, 0xa0, 0x2c, 0x62,
+  0x77, 0x7d, 0x46, 0x19, 0xe7, 0x76, 0xd7, 0xb8, 0x0d, 0x43, 0xc8, 0x9c, 0x4a, 0x1b, 0xa1, 0x1b,
+  0x0e, 0x25, 0xc9, 0x59, 0xad, 0x5a, 0x33, 0x7b, 0x61, 0x1e, 0x9b, 0xbf, 0xc5, 0xa3, 0x30, 0x5b,
+  0xc3, 0xa1, 0xb5, 0xbd, 0x27, 0x5f, 0x44, 0x8b, 0x93, 0xf1, 0xf9, 0x83, 0x7c, 0x1c, 0xc7, 0x1d,
+  0xf9, 0x1c, 0xe9, 0x80, 0x1a, 0xa2, 0x22, 0x19, 0xd3, 0x18, 0x62, 0x78, 0x62, 0x16, 0x59, 0x59,
+  0xd5, 0x7a, 0xa6, 0xb7, 0x15, 0x4d, 0x25, 0x72, 0x87, 0xce, 0x51, 0xa4, 0xc9, 0x62, 0x1c, 0x45,
+  0x2f, 0x27, 0xb0, 0xa2, 0x6c, 0xb9, 0xd2, 0x98, 0x53, 0x17, 0xd0, 0x7d, 0xef, 0x85, 0xd2, 0x44,
+  0xd7, 0x6a, 0x3f, 0xb3, 0xe1, 0x99, 0x5d, 0x6d, 0x2d, 0x9f, 0x9f, 0x9f, 0x1b, 0xd1, 0x64, 0xd4,
+  0x70, 0x20, 0x19, 0x35, 0x64, 0x34, 0x64, 0x30, 0xd4, 0x8c, 0x1f, 0x93, 0x06, 0x67, 0x7a, 0x49,
+  0xce, 0xee, 0x20, 0xe3, 0x44, 0xa9, 0xd4, 0xc3, 0xfd, 0x40, 0x82, 0x01, 0x24, 0x4d, 0x9a, 0x59,
+  0x9e, 0x7a, 0x4a, 0xd7, 0xf9, 0xd6, 0x83, 0x9c, 0x68, 0x32, 0x14, 0x55, 0xea, 0x8d, 0xbd, 0xe9,
+  0x8d, 0x99, 0x82, 0x6b, 0xb2, 0xae, 0x92, 0x91, 0x93, 0x7c, 0xac, 0x54, 0x57, 0xdc, 0x04, 0xd0,
+  0x51, 0x3b, 0xf6, 0xa6, 0x5f, 0xdc, 0xe4, 0x83, 0x4e, 0x32, 0x42, 0xdb, 0xff, 0xef, 0x01, 0xe1,
+  0xfc, 0x53, 0xd9, 0x81, 0x3a, 0x69, 0xc6, 0x77, 0x84, 0xd7, 0x58, 0x48, 0x58, 0x13, 0x6f, 0x39,
+  0x07, 0x51, 0x1e, 0x72, 0xc6, 0xe8, 0x17, 0xc5, 0x61, 0x80, 0xa8, 0x01, 0x28, 0x8a, 0xa7, 0xae,
+  0x71, 0xb2, 0xa0, 0x7c, 0xfa, 0x4e, 0x1a, 0xc7, 0x4b, 0xaa, 0x14, 0x24, 0xaa, 0x22, 0x0e, 0xb6,
+  0xca, 0xb4, 0x37, 0xc5, 0x64, 0xe3, 0x3b, 0x3e, 0x9c, 0x60, 0x2f, 0xb1, 0x5b, 0x6b, 0xd7, 0x17,
+  0x3b, 0x25, 0x0f, 0xec, 0x56, 0x7b, 0x76, 0xaf, 0x3d, 0x58, 0xb3, 0x12, 0xbd, 0x8e, 0x3c, 0x53,
+  0x3c, 0x66, 0x80, 0x23, 0x2c, 0x4c, 0x97, 0xda, 0x27, 0xc9, 0xb0, 0x50, 0x58, 0xb6, 0x95, 0xda,
+  0xcb, 0xcb, 0x2e, 0x96, 0xd3, 0x27, 0xb1, 0x8c, 0xc7, 0x51, 0xf4, 0xfb, 0x73, 0xb9, 0x38, 0xa4,
+  0x83, 0x09, 0x1c, 0xbf, 0xf9, 0x45, 0x1d, 0x74, 0xf5, 0x24, 0xfa, 0x45, 0x1d, 0xa4, 0xc0, 0xeb,
+  0xd3, 0x3d, 0x9d, 0x36, 0xcb, 0x55, 0xc3, 0x34, 0x43, 0x71, 0x6f, 0x7a, 0x29, 0xca, 0x92, 0x66,
+  0x1a, 0x8b, 0x3a, 0x0c, 0xc3, 0x64, 0x54, 0x99, 0xae, 0x96, 0x49, 0x56, 0xe9, 0x69, 0x6f, 0x34,
+  0x82, 0x0f, 0x12, 0xdb, 0x27, 0x96, 0xae, 0xa2, 0x14, 0x94, 0xcc, 0x46, 0x1b, 0xba, 0x08, 0x57,
+  0x3d, 0xec, 0xa1, 0x4a, 0xc3, 0x87, 0x8f, 0x57, 0xd7, 0xef, 0x6f, 0x20, 0x85, 0x13, 0x6c, 0x71,
+  0x88, 0x46, 0x71, 0x38, 0x8b, 0x06, 0xd0, 0xfc, 0xcf, 0x27, 0x8d, 0xdc, 0xed, 0xd5, 0x1f, 0x9f,
+  0x8d, 0xd8, 0x6c, 0x3c, 0x1e, 0xc0, 0xf8, 0xcd, 0x00, 0x4e, 0x70, 0xf9, 0xf5, 0x29, 0xae, 0x73,
+  0xaa, 0x61, 0xa3, 0x06, 0x90, 0x4b, 0xb2, 0xc4, 0xd6, 0xb3, 0x44, 0xa1, 0x82, 0x70, 0x45, 0x27,
+  0xbd, 0x5e, 0x51, 0x97, 0xe8, 0x14, 0xc6, 0xa7, 0x68, 0x99, 0xfb, 0xa2, 0x1a, 0x80, 0x8d, 0x2b,
+  0x80, 0xef, 0x18, 0x3b, 0x2b, 0xc0, 0xdf, 0x28, 0x78, 0xf5, 0x0a, 0xb5, 0x43, 0x89, 0x65, 0xb7,
+  0xbd, 0x71, 0xf6, 0xd3, 0x14, 0xe2, 0xc0, 0x4c, 0x5a, 0xad, 0x92, 0x6e, 0xe0, 0x0b, 0x2b, 0xf5,
+  0xd9, 0x5b, 0x29, 0xc9, 0xd6, 0x9f, 0xed, 0x50, 0xe6, 0x41, 0x30, 0xe9, 0xdd, 0x77, 0x8c, 0x48,
+  0x14, 0xa7, 0xd2, 0x77, 0xe8, 0xce, 0xeb, 0xd9, 0x03, 0xa3, 0x06, 0x50, 0x89, 0x0d, 0x95, 0x03,
+  0x30, 0xcc, 0x18, 0x00, 0xe1, 0xec, 0x0e, 0x9b, 0x48, 0xea, 0x82, 0x9e, 0xa0, 0xc6, 0xac, 0xa9,
+  0xdb, 0x01, 0xec, 0x6a, 0x71, 0x1e, 0x16, 0x42, 0x5e, 0x91, 0x6c, 0xe5, 0xfb, 0x2c, 0xc7, 0x83,
+  0x25, 0x80, 0x74, 0x6a, 0xd1, 0x5b, 0x7c, 0xca, 0x11, 0x21, 0x17, 0x59, 0xbd, 0xc6, 0xd3, 0x28,
+  0x5c, 0x52, 0x7d, 0xc5, 0xa9, 0x19, 0xbe, 0xdb, 0x7e, 0xcc, 0x51, 0x25, 0x98, 0x58, 0x59, 0xca,
+  0x43, 0x4b, 0xcf, 0x6b, 0xa6, 0x74, 0xa8, 0xc5, 0x72, 0xc9, 0xa9, 0xef, 0x89, 0x12, 0x2d, 0x1d,
+  0x1d, 0xf9, 0xd6, 0x2b, 0x78, 0x05, 0x7e, 0x0c, 0x49, 0x82, 0x26, 0x82, 0x9f, 0x29, 0x99, 0xde,
+  0x68, 0xd4, 0x7c, 0xeb, 0xfe, 0x13, 0xad, 0x7b, 0xfb, 0x6d, 0x12, 0x7b, 0xd4, 0xee, 0x46, 0x70,
+  0xd0, 0xbd, 0x6e, 0xb5, 0x05, 0xa1, 0x4d, 0x29, 0x06, 0xf3, 0x30, 0x69, 0xa0, 0x0e, 0xea, 0x9a,
+  0x4a, 0x0e, 0x42, 0x4d, 0xbf, 0xe9, 0x4b, 0x77, 0x14, 0xef, 0xa9, 0x42, 0x1f, 0xbc, 0x97, 0xde,
+  0x1e, 0xc0, 0x3f, 0x35, 0x95, 0xdb, 0x1b, 0xca, 0x91, 0xa5, 0x42, 0x62, 0xef, 0xf0, 0xbd, 0x17,
+  0xb6, 0x44, 0xc1, 0x11, 0x1b, 0xc1, 0x76, 0xa9, 0xa6, 0xbc, 0x4d, 0xf5, 0xe1, 0xc4, 0x59, 0x3a,
+  0xce, 0xd8, 0xdc, 0xb2, 0xc5, 0x00, 0x3d, 0x26, 0x43, 0xe6, 0x2a, 0xa2, 0x61, 0x03, 0xf2, 0x2c,
+  0x05, 0xc3, 0xa4, 0xbf, 0xe8, 0xe2, 0x46, 0x64, 0x5f, 0xa9, 0xf6, 0xbd, 0x8d, 0xba, 0x18, 0x8d,
+  0x3c, 0x74, 0x95, 0x8b, 0x8c, 0x18, 0x9d, 0x70, 0x25, 0x70, 0x4b, 0xd1, 0xf5, 0xd1, 0x06, 0x33,
+  0x32, 0xb1, 0x6a, 0xe1, 0x82, 0x95, 0x44, 0x6e, 0x6f, 0xb1, 0x19, 0x21, 0x82, 0x47, 0x0c, 0x07,
+  0x17, 0x75, 0x51, 0x50, 0xe9, 0x35, 0x02, 0xa2, 0x14, 0x15, 0x2d, 0x71, 0xd1, 0xb7, 0x2e, 0x1f,
+  0xcc, 0x58, 0x53, 0xaa, 0x8f, 0x93, 0xe6, 0x5d, 0xe3, 0x46, 0x3e, 0x60, 0x65, 0x5c, 0x28, 0xba,
+  0x03, 0x73, 0x54, 0xfb, 0x65, 0xc8, 0x3f, 0x69, 0xd6, 0xed, 0x07, 0x9e, 0x23, 0x14, 0x5e, 0xab,
+  0x6e, 0xd9, 0x9a, 0x8a, 0x5a, 0xfb, 0xcd, 0xf2, 0xc0, 0x1c, 0x9d, 0x91, 0x63, 0xce, 0xce, 0x03,
+  0xec, 0x14, 0x8a, 0x2c, 0xad, 0x0f, 0xf4, 0x09, 0xdf, 0x8b, 0x26, 0x8d, 0x9d, 0x82, 0xa4, 0xa1,
+  0x69, 0x58, 0x0d, 0x69, 0x0d, 0xf5, 0x8a, 0x59, 0xe4, 0xb6, 0x25, 0x0a, 0x1a, 0x5d, 0xc0, 0x13,
+  0x58, 0x82, 0x6f, 0x1a, 0x05, 0x43, 0x00, 0xbc, 0x53, 0x30, 0x48, 0x9a, 0xce, 0x83, 0xe3, 0x7e,
+  0x3f, 0x70, 0x55, 0x68, 0xf7, 0x13, 0x8a, 0x59, 0x8c, 0x9b, 0xc0, 0xe6, 0x0e, 0xf1, 0x1e, 0x49,
+  0x80, 0x19, 0x79, 0x1e, 0xc8, 0xd4, 0xb4, 0xd9, 0xd9, 0xf1, 0x33, 0x88, 0xce, 0x95, 0x78, 0xde,
+  0x2d, 0x92, 0x7d, 0x33, 0xa8, 0xdb, 0xef, 0xb7, 0x66, 0xec, 0x77, 0xdb, 0x41, 0x9a, 0x8c, 0x20,
+  0x9f, 0x7e, 0xc2, 0x5f, 0x47, 0xdc, 0x59, 0xd3, 0xba, 0xe7, 0xfb, 0x0c, 0x6e, 0xe9, 0x6b, 0x76,
+  0x94, 0x65, 0x5f, 0xf7, 0x76, 0xd4, 0xa5, 0x52, 0x54, 0x38, 0xd9, 0x47, 0x11, 0x03, 0x80, 0x7b,
+  0x13, 0x8a, 0xca, 0x98, 0x35, 0xb1, 0xb5, 0xb5, 0xd8, 0xf7, 0x3b, 0xcb, 0x6e, 0xf2, 0xc7, 0x0f,
+  0x88, 0x76, 0x45, 0x6e, 0x20, 0x30, 0xcf, 0x63, 0x33, 0xdb, 0x8c, 0x8f, 0x83, 0x9d, 0xb6, 0x8b,
+  0xb5, 0x93, 0x00, 0x23, 0x3f, 0x84, 0x31, 0xa6, 0xe1, 0x37, 0xbc, 0x50, 0x9a, 0x9b, 0x60, 0x0f,
+  0x1e, 0x77, 0x66, 0x0c, 0x3a, 0x68, 0x5b, 0xbe, 0xe2, 0x0c, 0xb3, 0xf1, 0x93, 0x06, 0xb7, 0xd7,
+  0x41, 0x26, 0x3d, 0x27, 0x8f, 0x21, 0xbb, 0x03, 0x7d, 0x17, 0x72, 0xf7, 0x64, 0xd0, 0xb2, 0xc6,
+  0xbb, 0xa1, 0x35, 0x1a, 0x0f, 0xa0, 0xdf, 0xa8, 0x34, 0xb6, 0x4d, 0xce, 0x77, 0x20, 0xf8, 0x4b,
+  0xa0, 0x5c, 0xd2, 0xe7, 0x51, 0xdc, 0xf9, 0x62, 0xc4, 0x77, 0x65, 0x3e, 0x31, 0x97, 0xb8, 0xe6,
+  0xc8, 0xc3, 0xd3, 0xd2, 0x5d, 0xdf, 0x46, 0xee, 0x27, 0xc7, 0x7f, 0x01, 0x13, 0x68, 0xa8, 0x83,
+  0x0c, 0x00, 0x00,
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Station connection state machine, fed from WiFi driver events (see
+// network.cpp) rather than by polling WiFi.status().
+//
+// The channel and BSSID of the last successful association are cached, and
+// reconnects go straight to that AP without scanning: a one-channel attempt
+// costs ~150 ms against ~2 s for a full scan, so it can be retried often.
+// Retries back off from RETRY_MIN_MS to RETRY_MAX_MS. Only an AP reboot can
+// move it to another channel, so full scans start once the link has been
+// down for SCAN_AFTER_MS, as every SCAN_EVERY-th attempt. An attempt the
+// driver never reports on is abandoned after ATTEMPT_TIMEOUT_MS.
+//
+// poll() returns what the caller should do now. Header-only and
+// Arduino-free so tools/wifi_sim.cpp can replay AP outages.
+
+enum WifiLinkState : uint8_t {
+  LINK_DOWN,        // Waiting to retry
+  LINK_CONNECTING,  // Attempt started, no association yet
+  LINK_ASSOCIATED,  // Associated, waiting for DHCP
+  LINK_UP,          // Have an IP
+};
+
+enum WifiAction : uint8_t {
+  WIFI_ACTION_NONE,
+  WIFI_ACTION_CONNECT_CACHED,  // Connect to cachedChannel()/cachedBssid()
+  WIFI_ACTION_CONNECT_SCAN,    // Connect by SSID, scanning every channel
+};
+
+class WifiLink {
+ public:
+  static const unsigned long SCAN_AFTER_MS = 10000;
+  static const uint8_t SCAN_EVERY = 3;
+  static const unsigned long RETRY_MIN_MS = 50;
+  static const unsigned long RETRY_MAX_MS = 200;
+  static const unsigned long ATTEMPT_TIMEOUT_MS = 5000;
+
+  WifiLink()
+    : state_(LINK_DOWN), channel_(0), hasCache_(false), attempt_(0), sinceScan_(0),
+      nextAttempt_(0), attemptStart_(0), downSince_(0), lastReason_(0) {
+    memset(bssid_, 0, sizeof(bssid_));
+  }
+
+  void begin(unsigned long now) {
+    state_ = LINK_DOWN;
+    attempt_ = 0;
+    nextAttempt_ = now;
+    downSince_ = now;
+  }
+
+  WifiAction poll(unsigned long now) {
+    if ((state_ == LINK_CONNECTING || state_ == LINK_ASSOCIATED) &&
+        now - attemptStart_ >= ATTEMPT_TIMEOUT_MS) {
+      failed(now);
+    }
+    if (state_ != LINK_DOWN || (long)(now - nextAttempt_) < 0) return WIFI_ACTION_NONE;
+
+    state_ = LINK_CONNECTING;
+    attemptStart_ = now;
+    bool scan = !hasCache_ || (now - downSince_ >= SCAN_AFTER_MS && ++sinceScan_ >= SCAN_EVERY);
+    if (scan) sinceScan_ = 0;
+    if (attempt_ < 255) attempt_++;
+    return scan ? WIFI_ACTION_CONNECT_SCAN : WIFI_ACTION_CONNECT_CACHED;
+  }
+
+  void associated(uint8_t channel, const uint8_t* bssid) {
+    state_ = LINK_ASSOCIATED;
+    channel_ = channel;
+    memcpy(bssid_, bssid, sizeof(bssid_));
+    hasCache_ = true;
+  }
+
+  void gotIp() {
+    state_ = LINK_UP;
+  }
+
+  void disconnected(unsigned long now, uint8_t reason) {
+    lastReason_ = reason;
+    if (state_ == LINK_UP || state_ == LINK_ASSOCIATED) {
+      if (state_ == LINK_UP) {
+        downSince_ = now;
+        attempt_ = 0;
+        sinceScan_ = SCAN_EVERY;  // First attempt after SCAN_AFTER_MS scans
+      }
+      state_ = LINK_DOWN;
+      nextAttempt_ = now;  // Retry at once: the AP is usually still there
+      return;
+    }
+    if (state_ == LINK_CONNECTING) failed(now);
+  }
+
+  WifiLinkState state() const { return state_; }
+  bool up() const { return state_ == LINK_UP; }
+  unsigned long downSince() const { return downSince_; }
+  uint8_t attempts() const { return attempt_; }  // Since the link went down
+  uint8_t lastReason() const { return lastReason_; }
+  bool hasCache() const { return hasCache_; }
+  uint8_t cachedChannel() const { return channel_; }
+  const uint8_t* cachedBssid() const { return bssid_; }
+
+ private:
+  void failed(unsigned long now) {
+    state_ = LINK_DOWN;
+    unsigned long delay = attempt_ > 1 ? RETRY_MIN_MS << (attempt_ - 1 < 8 ? attempt_ - 1 : 8) : RETRY_MIN_MS;
+    nextAttempt_ = now + (delay < RETRY_MAX_MS ? delay : RETRY_MAX_MS);
+  }
+
+  WifiLinkState state_;
+  uint8_t channel_;
+  uint8_t bssid_[6];
+  bool hasCache_;
+  uint8_t attempt_;
+  uint8_t sinceScan_;      // Cached attempts since the last scan
+  unsigned long nextAttempt_;
+  unsigned long attemptStart_;
+  unsigned long downSince_;
+  uint8_t lastReason_;
+};
+
+#endif
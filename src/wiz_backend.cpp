@@ -0,0 +1,58 @@
+#include "wiz_backend.h"
+#include "capture.h"
+#include "lights.h"
+#include "wiz_json.h"
+
+void WizBackend::begin() {
+  udp_.begin(WIZ_LOCAL_PORT);
+}
+
+bool WizBackend::sendJson(int bulb, uint32_t id, const char* method, const char* params) {
+  char json[160];
+  snprintf(json, sizeof(json), "{\"id\":%u,\"method\":\"%s\",\"params\":{%s}}",
+    id, method, params);
+
+  size_t len = strlen(json);
+  capturePacket(bulb, CAPTURE_SENT, (const uint8_t*)json, len);
+  udp_.beginPacket(bulbs[bulb].ip, WIZ_PORT);
+  udp_.write((const uint8_t*)json, len);
+  return udp_.endPacket() != 0;
+}
+
+bool WizBackend::send(int bulb, uint32_t id, const PilotCommand& cmd) {
+  char params[64];
+  wizFormatPilot(params, sizeof(params), cmd);
+  return sendJson(bulb, id, "setPilot", params);
+}
+
+bool WizBackend::probe(int bulb, uint32_t id) {
+  return sendJson(bulb, id, "getPilot", "");
+}
+
+static int findBulb(IPAddress ip) {
+  for (int i = 0; i < BULB_COUNT; i++) {
+    if (bulbs[i].backend == BACKEND_WIZ && bulbs[i].ip == ip) return i;
+  }
+  return -1;
+}
+
+bool WizBackend::poll(BackendReply* reply) {
+  char json[256];
+  while (udp_.parsePacket()) {
+    int bulb = findBulb(udp_.remoteIP());
+    int len = udp_.read(json, sizeof(json) - 1);
+    udp_.flush();
+    if (bulb < 0) continue;
+
+    json[len > 0 ? len : 0] = '\0';
+    capturePacket(bulb, CAPTURE_RECEIVED, (const uint8_t*)json, len > 0 ? len : 0);
+    reply->bulb = bulb;
+    long id;
+    reply->hasId = wizFindInt(json, "\"id\"", &id);
+    reply->id = reply->hasId ? (uint32_t)id : 0;
+    reply->success = strstr(json, "\"success\":true") != NULL;
+    wizParsePilot(json, &reply->state);  // getPilot result: {"state":true,...,"temp":2700,"dimming":50}
+    return true;
+  }
+  return false;
+}
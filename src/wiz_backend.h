@@ -0,0 +1,32 @@
+#ifndef WIZ_BACKEND_H
+#define WIZ_BACKEND_H
+
+#include "backend.h"
+
+// WiZ UDP JSON transport (wiz_backend.cpp); bulbs are addressed by Bulb::ip.
+// QEMU_TARGET builds have no WiFi and tunnel the datagrams over a UART.
+#ifdef QEMU_TARGET
+#include "serial_udp.h"
+typedef SerialUdp WizUdp;
+#else
+#include <WiFiUdp.h>
+typedef WiFiUDP WizUdp;
+#endif
+
+const int WIZ_PORT = 38899;
+const int WIZ_LOCAL_PORT = 38900;
+
+class WizBackend : public LightBackend<WizBackend> {
+ public:
+  void begin();
+  bool send(int bulb, uint32_t id, const PilotCommand& cmd);
+  bool probe(int bulb, uint32_t id);
+  bool poll(BackendReply* reply);
+
+ private:
+  bool sendJson(int bulb, uint32_t id, const char* method, const char* params);
+
+  WizUdp udp_;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef WIZ_JSON_H
+#define WIZ_JSON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "command_queue.h"
+
+// Just enough WiZ JSON for the dimmer, shared by wiz_backend.cpp, proxy.cpp
+// and tools/wizclients.cpp. WiZ messages are flat, so keys are found with
+// strstr; "state", "dimming" and "temp" mean the same in setPilot params and
+// getPilot results. Header-only and Arduino-free.
+
+enum WizMethod : uint8_t {
+  WIZ_OTHER,
+  WIZ_SET_PILOT,
+  WIZ_GET_PILOT,
+};
+
+// JSON-RPC error codes
+const int WIZ_ERROR_NO_STATE = -32000;  // Proxy: the bulb has not confirmed any state
+const int WIZ_ERROR_METHOD_NOT_FOUND = -32601;
+
+struct WizRequest {
+  WizMethod method;
+  bool hasId;
+  uint32_t id;
+  PilotCommand pilot;  // setPilot params the dimmer understands
+};
+
+inline const char* wizFindValue(const char* json, const char* key) {
+  const char* p = strstr(json, key);
+  if (!p) return NULL;
+  p += strlen(key);
+  while (*p == ' ' || *p == ':') p++;
+  return p;
+}
+
+inline bool wizFindInt(const char* json, const char* key, long* out) {
+  const char* p = wizFindValue(json, key);
+  if (!p) return false;
+  char* end;
+  *out = strtol(p, &end, 10);
+  return end != p;
+}
+
+// Pilot fields present in a setPilot request or getPilot reply
+inline void wizParsePilot(const char* json, PilotCommand* pilot) {
+  *pilot = PilotCommand();
+  const char* state = wizFindValue(json, "\"state\"");
+  if (state && (strncmp(state, "true", 4) == 0 || strncmp(state, "false", 5) == 0)) {
+    pilot->fields |= PILOT_STATE;
+    pilot->on = state[0] == 't';
+  }
+  long v;
+  if (wizFindInt(json, "\"dimming\"", &v) && v >= 0 && v <= 100) {
+    pilot->fields |= PILOT_DIMMING;
+    pilot->dimming = (uint8_t)v;
+  }
+  if (wizFindInt(json, "\"temp\"", &v) && v > 0 && v < 65536) {
+    pilot->fields |= PILOT_TEMP;
+    pilot->temp = (uint16_t)v;
+  }
+}
+
+inline void wizParseRequest(const char* json, WizRequest* req) {
+  req->method = strstr(json, "\"setPilot\"") ? WIZ_SET_PILOT
+              : strstr(json, "\"getPilot\"") ? WIZ_GET_PILOT
+              : WIZ_OTHER;
+  long id;
+  req->hasId = wizFindInt(json, "\"id\"", &id);
+  req->id = req->hasId ? (uint32_t)id : 0;
+  if (req->method == WIZ_SET_PILOT) {
+    wizParsePilot(json, &req->pilot);
+  } else {
+    req->pilot = PilotCommand();
+  }
+}
+
+// "state":true,"dimming":50 - no braces; returns the length written
+inline int wizFormatPilot(char* out, size_t len, const PilotCommand& cmd) {
+  int n = 0;
+  if (cmd.fields & PILOT_STATE) {
+    n += snprintf(out + n, len - n, "\"state\":%s,", cmd.on ? "true" : "false");
+  }
+  if (cmd.fields & PILOT_DIMMING) {
+    n += snprintf(out + n, len - n, "\"dimming\":%d,", cmd.dimming);
+  }
+  if (cmd.fields & PILOT_TEMP) {
+    n += snprintf(out + n, len - n, "\"temp\":%d,", cmd.temp);
+  }
+  if (n > 0) out[--n] = '\0';  // Drop trailing comma
+  return n;
+}
+
+inline int wizFormatId(char* out, size_t len, const WizRequest& req) {
+  return req.hasId ? snprintf(out, len, "\"id\":%u,", (unsigned)req.id) : (out[0] = '\0', 0);
+}
+
+inline int wizFormatSetReply(char* out, size_t len, const WizRequest& req) {
+  char id[20];
+  wizFormatId(id, sizeof(id), req);
+  return snprintf(out, len, "{\"method\":\"setPilot\",%s\"env\":\"pro\",\"result\":{\"success\":true}}", id);
+}
+
+// extra is appended inside "result" (e.g. ",\"ageMs\":120") and may be ""
+inline int wizFormatGetReply(char* out, size_t len, const WizRequest& req,
+                             const PilotCommand& state, const char* extra) {
+  char id[20], pilot[64];
+  wizFormatId(id, sizeof(id), req);
+  wizFormatPilot(pilot, sizeof(pilot), state);
+  return snprintf(out, len, "{\"method\":\"getPilot\",%s\"env\":\"pro\",\"result\":{%s%s}}",
+    id, pilot, extra);
+}
+
+inline int wizFormatError(char* out, size_t len, const WizRequest& req, int code, const char* message) {
+  char id[20];
+  wizFormatId(id, sizeof(id), req);
+  return snprintf(out, len, "{%s\"env\":\"pro\",\"error\":{\"code\":%d,\"message\":\"%s\"}}",
+    id, code, message);
+}
+
+#endif
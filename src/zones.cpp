@@ -0,0 +1,96 @@
+#include "zones.h"
+#include "dimmer.h"
+#include "lights.h"
+#include "scheduler.h"
+
+static ESP32Encoder encoders[ZONE_MAX];
+
+static const int MIN_COUNT = MIN_BRIGHTNESS / BRIGHTNESS_STEP;
+static const int MAX_COUNT = MAX_BRIGHTNESS / BRIGHTNESS_STEP;
+
+void zonesBegin() {
+  ESP32Encoder::useInternalWeakPullResistors = UP;
+  for (int z = 0; z < zoneCount; z++) {
+    Zone& zone = zones[z];
+    zone.encoder = &encoders[z];
+    zone.encoder->attachHalfQuad(zone.pinDt, zone.pinClk);
+    if (!zone.brightness) zone.brightness = brightness;
+    zone.lastCount = zone.brightness / BRIGHTNESS_STEP;
+    zone.encoder->setCount(zone.lastCount);
+
+    // Edges wake the loop; the encoder still counts in hardware
+    attachInterrupt(digitalPinToInterrupt(zone.pinClk), schedulerInputEdge, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(zone.pinDt), schedulerInputEdge, CHANGE);
+  }
+}
+
+uint8_t zonesScan(Zone* table, int count) {
+  // Counters first, back to back, so the knobs are sampled together
+  int counts[ZONE_MAX];
+  for (int z = 0; z < count; z++) counts[z] = (int)table[z].encoder->getCount();
+
+  uint8_t moved = 0;
+  for (int z = 0; z < count; z++) {
+    Zone& zone = table[z];
+    int c = counts[z];
+    // Clamp unconditionally (prevents dead zones at the limits)
+    if (c < MIN_COUNT || c > MAX_COUNT) {
+      c = c < MIN_COUNT ? MIN_COUNT : MAX_COUNT;
+      zone.encoder->setCount(c);
+    }
+    if (c == zone.lastCount) continue;
+    zone.lastCount = c;
+    zone.brightness = c * BRIGHTNESS_STEP;
+    moved |= 1 << z;
+  }
+  return moved;
+}
+
+void zoneMoveKnob(int zone, int level) {
+  // The level holds at once, so a power-on right after uses it
+  Zone& z = zones[zone];
+  z.brightness = constrain(level, MIN_BRIGHTNESS, MAX_BRIGHTNESS) / BRIGHTNESS_STEP * BRIGHTNESS_STEP;
+  z.encoder->setCount(z.brightness / BRIGHTNESS_STEP);
+  if (zone == 0) brightness = z.brightness;
+}
+
+void zoneSeed(int zone, int level) {
+  Zone& z = zones[zone];
+  z.lastCount = constrain(level, MIN_BRIGHTNESS, MAX_BRIGHTNESS) / BRIGHTNESS_STEP;
+  z.brightness = z.lastCount * BRIGHTNESS_STEP;
+  z.encoder->setCount(z.lastCount);
+  if (zone == 0) brightness = z.brightness;
+}
+
+int zoneOf(int bulb) {
+  for (int z = 0; z < zoneCount; z++) {
+    if (zones[z].bulbMask & (1 << bulb)) return z;
+  }
+  return -1;
+}
+
+uint8_t zoneBulbs(int zone) {
+  uint8_t mask = zones[zone].bulbMask;
+  if (zone == 0) {
+    for (int i = 0; i < BULB_COUNT; i++) {
+      if (zoneOf(i) < 0) mask |= 1 << i;
+    }
+  }
+  return mask;
+}
+
+int bulbLevel(int bulb) {
+  int z = zoneOf(bulb);
+  return z < 0 ? brightness : zones[z].brightness;
+}
+
+void zonesPrintStatus() {
+  for (int z = 0; z < zoneCount; z++) {
+    const Zone& zone = zones[z];
+    Serial.printf("  Zone %-10s %3d%%  knob GPIO %u/%u  bulbs:", zone.name, zone.brightness, zone.pinClk, zone.pinDt);
+    for (int i = 0; i < BULB_COUNT; i++) {
+      if (zoneBulbs(z) & (1 << i)) Serial.printf(" %s", bulbs[i].name);
+    }
+    Serial.println();
+  }
+}
@@ -0,0 +1,46 @@
+#ifndef ZONES_H
+#define ZONES_H
+
+#include <Arduino.h>
+#include <ESP32Encoder.h>
+
+// Knobs and the lights they dim (zones.cpp). Each row of the zone table in
+// main.cpp is one rotary encoder on its own PCNT unit and a group of bulbs
+// with its own brightness. A bulb belongs to at most one zone; a bulb in
+// none is dimmed by the first zone. The first zone's level is also the
+// controller's brightness, which the web UI, rules and usage history use.
+
+const int ZONE_MAX = 4;  // ESP32Encoder takes PCNT units in attach order; the ESP32 has 8
+
+struct Zone {
+  const char* name;
+  uint8_t bulbMask;       // Bit per BulbIndex
+  uint8_t pinClk;
+  uint8_t pinDt;
+  ESP32Encoder* encoder;  // Set by zonesBegin()
+  int brightness;         // MIN_BRIGHTNESS..MAX_BRIGHTNESS, 0 until zonesBegin()
+  int lastCount;          // Detent count last acted on
+};
+
+extern Zone zones[];         // Defined in main.cpp
+extern const int zoneCount;
+
+void zonesBegin();  // Attach the encoders and wake the loop on their edges
+
+// One pass over the knobs: read every counter, then clamp and compare.
+// Updates brightness and lastCount of the zones that moved and returns
+// them as a bitmask. Takes the table so bench.cpp can scan a larger one.
+uint8_t zonesScan(Zone* table, int count);
+
+// Move a zone's knob to level; the next scan picks it up like a turn and
+// sends it, but bulbLevel() returns it straight away
+void zoneMoveKnob(int zone, int level);
+// Take level as the zone's brightness without it counting as a turn
+void zoneSeed(int zone, int level);
+
+int zoneOf(int bulb);      // -1 if no zone holds it
+uint8_t zoneBulbs(int zone);  // Bulbs the zone dims, including the unzoned ones for the first
+int bulbLevel(int bulb);   // Brightness to turn the bulb on at
+void zonesPrintStatus();
+
+#endif
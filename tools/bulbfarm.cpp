@@ -0,0 +1,317 @@
+// Emulates a building full of WiZ bulbs for load-testing the dimmer.
+//
+// Build:  g++ -std=c++17 -O2 -o bulbfarm tools/bulbfarm.cpp
+// Usage:  ./bulbfarm [-n 200] [--addr 127.0.1.1] [--port 38899] [--ports]
+//                    [--quiet-ms 500] [--report-s 10]
+//
+// Each virtual bulb owns a UDP socket. By default bulb i binds --addr + i on
+// --port (all of 127.0.0.0/8 is loopback on Linux; for a real dimmer add LAN
+// aliases, e.g. "ip addr add 192.168.0.200/24 dev eth0"). With --ports all
+// bulbs share --addr and bulb i listens on --port + i.
+//
+// One epoll loop services every socket; each readable socket is drained with
+// recvmmsg() and answered with a single sendmmsg(), so a controller burst
+// costs a handful of syscalls rather than two per packet.
+//
+// A burst starts at the first command after --quiet-ms of silence and ends
+// when the bulb has been quiet that long again. Its convergence time is the
+// gap from the first command to the last state change. Per-bulb counts and
+// convergence are printed every --report-s seconds and on Ctrl-C.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int BATCH = 32;
+const int PACKET_MAX = 512;
+
+struct BulbState {
+  bool on = false;
+  int dimming = 50;
+  int temp = 2700;
+  bool operator!=(const BulbState& o) const {
+    return on != o.on || dimming != o.dimming || temp != o.temp;
+  }
+};
+
+struct Bulb {
+  int fd = -1;
+  sockaddr_in addr = {};
+  BulbState state;
+
+  unsigned long commands = 0;   // setPilot
+  unsigned long queries = 0;    // getPilot
+  unsigned long changes = 0;    // setPilot that altered state
+
+  bool inBurst = false;
+  double burstStart = 0;
+  double lastCommand = 0;
+  double lastChange = 0;
+  unsigned long bursts = 0;
+  double convergeSumMs = 0;
+  double convergeMaxMs = 0;
+};
+
+volatile sig_atomic_t stopRequested = 0;
+
+void onSignal(int) { stopRequested = 1; }
+
+double nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Minimal field extraction; WiZ JSON is flat enough for strstr
+bool findInt(const char* json, const char* key, long* out) {
+  const char* p = strstr(json, key);
+  if (!p) return false;
+  p += strlen(key);
+  while (*p == ' ' || *p == ':' || *p == '"') p++;
+  char* end;
+  long v = strtol(p, &end, 10);
+  if (end == p) return false;
+  *out = v;
+  return true;
+}
+
+bool findBool(const char* json, const char* key, bool* out) {
+  const char* p = strstr(json, key);
+  if (!p) return false;
+  p += strlen(key);
+  while (*p == ' ' || *p == ':') p++;
+  if (strncmp(p, "true", 4) == 0) { *out = true; return true; }
+  if (strncmp(p, "false", 5) == 0) { *out = false; return true; }
+  return false;
+}
+
+// Apply one request and write the reply. Returns reply length (0 = no reply).
+int handleRequest(Bulb& bulb, int index, char* req, int len, char* reply, double now) {
+  req[len] = '\0';
+  long id = 0;
+  bool hasId = findInt(req, "\"id\"", &id);
+  char idField[24] = "";
+  if (hasId) snprintf(idField, sizeof(idField), "\"id\":%ld,", id);
+
+  if (strstr(req, "\"getPilot\"")) {
+    bulb.queries++;
+    return snprintf(reply, PACKET_MAX,
+      "{\"method\":\"getPilot\",%s\"env\":\"pro\",\"result\":{\"mac\":\"a8bb50%06x\","
+      "\"rssi\":-55,\"state\":%s,\"sceneId\":0,\"temp\":%d,\"dimming\":%d}}",
+      idField, index, bulb.state.on ? "true" : "false", bulb.state.temp, bulb.state.dimming);
+  }
+
+  if (!strstr(req, "\"setPilot\"")) {
+    return snprintf(reply, PACKET_MAX,
+      "{%s\"env\":\"pro\",\"error\":{\"code\":-32601,\"message\":\"Method not found\"}}", idField);
+  }
+
+  bulb.commands++;
+  if (!bulb.inBurst) {
+    bulb.inBurst = true;
+    bulb.burstStart = now;
+    bulb.lastChange = now;
+  }
+  bulb.lastCommand = now;
+
+  BulbState next = bulb.state;
+  long v;
+  bool b;
+  if (findBool(req, "\"state\"", &b)) next.on = b;
+  if (findInt(req, "\"dimming\"", &v)) {
+    next.dimming = (int)v;
+    if (!strstr(req, "\"state\"")) next.on = true;  // Real bulbs turn on when dimmed
+  }
+  if (findInt(req, "\"temp\"", &v)) next.temp = (int)v;
+  if (next != bulb.state) {
+    bulb.state = next;
+    bulb.changes++;
+    bulb.lastChange = now;
+  }
+
+  return snprintf(reply, PACKET_MAX,
+    "{\"method\":\"setPilot\",%s\"env\":\"pro\",\"result\":{\"success\":true}}", idField);
+}
+
+void closeBursts(std::vector<Bulb>& bulbs, double now, double quietMs) {
+  for (Bulb& bulb : bulbs) {
+    if (!bulb.inBurst || now - bulb.lastCommand < quietMs) continue;
+    double ms = bulb.lastChange - bulb.burstStart;
+    bulb.inBurst = false;
+    bulb.bursts++;
+    bulb.convergeSumMs += ms;
+    if (ms > bulb.convergeMaxMs) bulb.convergeMaxMs = ms;
+  }
+}
+
+void report(const std::vector<Bulb>& bulbs, double elapsedMs, unsigned long syscalls) {
+  unsigned long totalCommands = 0, totalQueries = 0;
+  printf("\n%-15s %5s %8s %8s %8s %7s %9s %9s  %s\n",
+    "bulb", "port", "setPilot", "getPilot", "changes", "bursts", "avg ms", "max ms", "state");
+  for (const Bulb& bulb : bulbs) {
+    totalCommands += bulb.commands;
+    totalQueries += bulb.queries;
+    if (bulb.commands == 0 && bulb.queries == 0) continue;
+    char ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &bulb.addr.sin_addr, ip, sizeof(ip));
+    printf("%-15s %5u %8lu %8lu %8lu %7lu %9.1f %9.1f  %s %d%% %dK\n",
+      ip, ntohs(bulb.addr.sin_port), bulb.commands, bulb.queries, bulb.changes, bulb.bursts,
+      bulb.bursts ? bulb.convergeSumMs / bulb.bursts : 0.0, bulb.convergeMaxMs,
+      bulb.state.on ? "ON " : "OFF", bulb.state.dimming, bulb.state.temp);
+  }
+  double seconds = elapsedMs / 1e3;
+  printf("total: %lu setPilot, %lu getPilot in %.1f s (%.0f pkt/s), %lu syscalls\n",
+    totalCommands, totalQueries, seconds,
+    seconds > 0 ? (totalCommands + totalQueries) / seconds : 0.0, syscalls);
+  fflush(stdout);
+}
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+    "usage: %s [-n bulbs] [--addr a.b.c.d] [--port p] [--ports] [--quiet-ms ms] [--report-s s]\n",
+    argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int count = 200;
+  const char* baseAddr = "127.0.1.1";
+  int basePort = 38899;
+  bool distinctPorts = false;
+  double quietMs = 500;
+  double reportEveryMs = 10000;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (strcmp(arg, "-n") == 0 && hasValue) count = atoi(argv[++i]);
+    else if (strcmp(arg, "--addr") == 0 && hasValue) baseAddr = argv[++i];
+    else if (strcmp(arg, "--port") == 0 && hasValue) basePort = atoi(argv[++i]);
+    else if (strcmp(arg, "--ports") == 0) distinctPorts = true;
+    else if (strcmp(arg, "--quiet-ms") == 0 && hasValue) quietMs = atof(argv[++i]);
+    else if (strcmp(arg, "--report-s") == 0 && hasValue) reportEveryMs = atof(argv[++i]) * 1e3;
+    else { usage(argv[0]); return 2; }
+  }
+
+  in_addr base;
+  if (count <= 0 || inet_pton(AF_INET, baseAddr, &base) != 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  int epfd = epoll_create1(0);
+  if (epfd < 0) { perror("epoll_create1"); return 1; }
+
+  std::vector<Bulb> bulbs(count);
+  for (int i = 0; i < count; i++) {
+    Bulb& bulb = bulbs[i];
+    bulb.addr.sin_family = AF_INET;
+    bulb.addr.sin_addr.s_addr = distinctPorts ? base.s_addr : htonl(ntohl(base.s_addr) + i);
+    bulb.addr.sin_port = htons(distinctPorts ? basePort + i : basePort);
+
+    bulb.fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    int one = 1;
+    setsockopt(bulb.fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bulb.fd < 0 || bind(bulb.fd, (sockaddr*)&bulb.addr, sizeof(bulb.addr)) < 0) {
+      char ip[INET_ADDRSTRLEN];
+      inet_ntop(AF_INET, &bulb.addr.sin_addr, ip, sizeof(ip));
+      fprintf(stderr, "bulb %d: cannot bind %s:%d: %s\n", i, ip, ntohs(bulb.addr.sin_port), strerror(errno));
+      return 1;
+    }
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t)i;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, bulb.fd, &ev);
+  }
+
+  char ip[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &bulbs[0].addr.sin_addr, ip, sizeof(ip));
+  printf("%d bulbs listening from %s:%d (%s)\n", count, ip, ntohs(bulbs[0].addr.sin_port),
+    distinctPorts ? "distinct ports" : "consecutive addresses");
+  fflush(stdout);
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  // Batch buffers reused for every socket
+  static char rxBuf[BATCH][PACKET_MAX + 1];
+  static char txBuf[BATCH][PACKET_MAX];
+  sockaddr_in peers[BATCH];
+  iovec rxIov[BATCH], txIov[BATCH];
+  mmsghdr rxMsgs[BATCH], txMsgs[BATCH];
+
+  double start = nowMs();
+  double lastReport = start;
+  unsigned long syscalls = 0;
+  epoll_event events[64];
+
+  while (!stopRequested) {
+    int ready = epoll_wait(epfd, events, 64, 50);
+    if (ready < 0 && errno != EINTR) { perror("epoll_wait"); break; }
+    double now = nowMs();
+
+    for (int e = 0; e < ready; e++) {
+      int index = (int)events[e].data.u32;
+      Bulb& bulb = bulbs[index];
+
+      for (;;) {
+        memset(rxMsgs, 0, sizeof(rxMsgs));
+        for (int i = 0; i < BATCH; i++) {
+          rxIov[i] = {rxBuf[i], PACKET_MAX};
+          rxMsgs[i].msg_hdr.msg_iov = &rxIov[i];
+          rxMsgs[i].msg_hdr.msg_iovlen = 1;
+          rxMsgs[i].msg_hdr.msg_name = &peers[i];
+          rxMsgs[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+        }
+        int got = recvmmsg(bulb.fd, rxMsgs, BATCH, MSG_DONTWAIT, nullptr);
+        syscalls++;
+        if (got <= 0) break;
+
+        int replies = 0;
+        memset(txMsgs, 0, sizeof(txMsgs));
+        for (int i = 0; i < got; i++) {
+          int len = handleRequest(bulb, index, rxBuf[i], (int)rxMsgs[i].msg_len, txBuf[replies], now);
+          if (len <= 0) continue;
+          txIov[replies] = {txBuf[replies], (size_t)len};
+          txMsgs[replies].msg_hdr.msg_iov = &txIov[replies];
+          txMsgs[replies].msg_hdr.msg_iovlen = 1;
+          txMsgs[replies].msg_hdr.msg_name = &peers[i];
+          txMsgs[replies].msg_hdr.msg_namelen = rxMsgs[i].msg_hdr.msg_namelen;
+          replies++;
+        }
+        if (replies > 0) {
+          sendmmsg(bulb.fd, txMsgs, replies, 0);
+          syscalls++;
+        }
+        if (got < BATCH) break;
+      }
+    }
+
+    closeBursts(bulbs, now, quietMs);
+    if (reportEveryMs > 0 && now - lastReport >= reportEveryMs) {
+      lastReport = now;
+      report(bulbs, now - start, syscalls);
+    }
+  }
+
+  double now = nowMs();
+  closeBursts(bulbs, now + quietMs, quietMs);
+  report(bulbs, now - start, syscalls);
+  for (Bulb& bulb : bulbs) close(bulb.fd);
+  close(epfd);
+  return 0;
+}
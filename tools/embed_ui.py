@@ -0,0 +1,60 @@
+"""Gzip web/index.html into src/web_ui.h with an ETag.
+
+Runs automatically before each PlatformIO build (extra_scripts in
+platformio.ini) and can also be run by hand: python3 tools/embed_ui.py
+"""
+
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    ROOT = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SOURCE = os.path.join(ROOT, "web", "index.html")
+TARGET = os.path.join(ROOT, "src", "web_ui.h")
+
+
+def render(data):
+    packed = gzip.compress(data, compresslevel=9, mtime=0)
+    etag = '"%s"' % hashlib.sha1(data).hexdigest()[:16]
+    rows = []
+    for i in range(0, len(packed), 16):
+        rows.append("  " + ", ".join("0x%02x" % b for b in packed[i:i + 16]) + ",")
+    return "\n".join([
+        "// Generated by tools/embed_ui.py from web/index.html - do not edit",
+        "#ifndef WEB_UI_H",
+        "#define WEB_UI_H",
+        "",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "#define WEB_UI_ETAG \"%s\"" % etag.replace('"', '\\"'),
+        "",
+        "// %d bytes raw, %d bytes gzipped" % (len(data), len(packed)),
+        "static const size_t WEB_UI_INDEX_GZ_LEN = %d;" % len(packed),
+        "static const uint8_t WEB_UI_INDEX_GZ[] PROGMEM = {",
+        *rows,
+        "};",
+        "",
+        "#endif",
+        "",
+    ])
+
+
+def main():
+    with open(SOURCE, "rb") as f:
+        header = render(f.read())
+    if os.path.exists(TARGET):
+        with open(TARGET) as f:
+            if f.read() == header:
+                return
+    with open(TARGET, "w") as f:
+        f.write(header)
+    print("embed_ui: wrote %s" % os.path.relpath(TARGET, ROOT))
+
+
+main()
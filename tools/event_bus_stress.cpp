@@ -0,0 +1,101 @@
+// Checks the controller event bus (src/event_bus.h) with one fast and one
+// slow subscriber, and measures what publishing costs the loop.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src -o event_bus_stress tools/event_bus_stress.cpp
+// Usage:  ./event_bus_stress [events] [slow consumer us per event]   (default 200000, 200)
+//
+// The publisher sends numbered brightness events as fast as it can. The
+// fast subscriber must see every one in order. The slow subscriber must see
+// a subset, still in order, with the rest counted as dropped. Publish
+// latency is reported as percentiles, so a stall caused by a subscriber
+// would show up at the tail.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "event_bus.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+EventBus<2, 32> bus;
+std::atomic<bool> done(false);
+
+struct Seen {
+  uint32_t received = 0;
+  uint32_t outOfOrder = 0;
+};
+
+void consume(int id, int delayUs, Seen* seen) {
+  int64_t last = -1;
+  BusEvent e;
+  for (;;) {
+    if (!bus.poll(id, &e)) {
+      // Re-check after seeing done, so events published just before it count
+      if (!done.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (!bus.poll(id, &e)) break;
+    }
+    int64_t seq = e.ms;  // Publisher puts the sequence number in ms
+    if (seq <= last) seen->outOfOrder++;
+    last = seq;
+    seen->received++;
+    if (delayUs) std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint32_t events = argc > 1 ? (uint32_t)atol(argv[1]) : 200000;
+  int slowUs = argc > 2 ? atoi(argv[2]) : 200;
+  if (events == 0 || slowUs < 0) {
+    fprintf(stderr, "Usage: %s [events] [slow consumer us per event]\n", argv[0]);
+    return 2;
+  }
+
+  int fastId = bus.subscribe(EVENT_ALL_TYPES, NULL, NULL);
+  int slowId = bus.subscribe(eventMask(EVENT_BRIGHTNESS), NULL, NULL);
+  Seen fast, slow;
+  std::thread fastThread(consume, fastId, 0, &fast);
+  std::thread slowThread(consume, slowId, slowUs, &slow);
+
+  // The fast subscriber keeps up by spinning; pace the publisher only when
+  // its ring is full, which is the one case the firmware does not wait on
+  std::vector<uint32_t> costNs;
+  costNs.reserve(events);
+  uint32_t fastWaits = 0;
+  for (uint32_t i = 0; i < events; i++) {
+    while (bus.pending(fastId) >= 32) {
+      fastWaits++;
+      std::this_thread::yield();
+    }
+    Clock::time_point start = Clock::now();
+    bus.publish(EVENT_BRIGHTNESS, 3, (int16_t)(i % 100), i);
+    costNs.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+  }
+  done.store(true, std::memory_order_release);
+  fastThread.join();
+  slowThread.join();
+
+  std::sort(costNs.begin(), costNs.end());
+  auto pct = [&](double p) { return costNs[std::min(costNs.size() - 1, (size_t)(p * costNs.size()))]; };
+  printf("published %u  publish ns p50 %u  p99 %u  p99.9 %u  max %u\n", bus.published(),
+    pct(0.5), pct(0.99), pct(0.999), costNs.back());
+  printf("fast: received %u  dropped %u  out of order %u  (publisher paced %u times)\n",
+    fast.received, bus.dropped(fastId), fast.outOfOrder, fastWaits);
+  printf("slow: received %u  dropped %u  out of order %u\n", slow.received, bus.dropped(slowId), slow.outOfOrder);
+
+  bool ok = fast.received == events && bus.dropped(fastId) == 0 && !fast.outOfOrder &&
+    slow.received + bus.dropped(slowId) == events && !slow.outOfOrder;
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
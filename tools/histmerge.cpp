@@ -0,0 +1,154 @@
+// Merges latency histograms dumped by the dimmer's "hist dump" console
+// command and prints percentiles per histogram.
+//
+// Build:  g++ -std=c++17 -O2 -I src -o histmerge tools/histmerge.cpp
+// Usage:  ./histmerge [--buckets] [console.txt ...]   (stdin if no files)
+//         ./histmerge --synth devices                 (print sample dumps)
+//
+// Input is any text holding "HIST <name> <hex>" lines, e.g. saved monitor
+// output from several dimmers or several sessions; histograms with the same
+// name are added together. --buckets also lists the non-empty buckets.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+
+namespace {
+
+struct Merged {
+  std::string name;
+  LatencyHistogram hist = {};
+  int dumps = 0;
+};
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Returns false if the line holds no well-formed dump
+bool parseLine(const char* line, std::string* name, LatencyHistogram* hist) {
+  const char* p = strstr(line, "HIST ");
+  if (!p) return false;
+  p += 5;
+  const char* space = strchr(p, ' ');
+  if (!space || space == p) return false;
+  name->assign(p, space - p);
+
+  std::vector<uint8_t> bytes;
+  for (p = space + 1; hexValue(p[0]) >= 0 && hexValue(p[1]) >= 0; p += 2) {
+    bytes.push_back((uint8_t)(hexValue(p[0]) << 4 | hexValue(p[1])));
+  }
+  return hist->deserialize(bytes.data(), bytes.size());
+}
+
+void printBuckets(const LatencyHistogram& h) {
+  uint32_t peak = 0;
+  for (int i = 0; i < HIST_BUCKETS; i++) peak = std::max(peak, h.counts[i]);
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    if (!h.counts[i]) continue;
+    int bar = (int)((uint64_t)h.counts[i] * 40 / peak);
+    printf("    %10u - %-10u %9u %s\n", LatencyHistogram::bucketLow(i),
+      LatencyHistogram::bucketHigh(i), h.counts[i], std::string(bar > 0 ? bar : 1, '#').c_str());
+  }
+}
+
+void printDump(const char* name, const LatencyHistogram& h) {
+  uint8_t buf[HIST_SERIALIZED_MAX];
+  size_t len = h.serialize(buf);
+  printf("HIST %s ", name);
+  for (size_t i = 0; i < len; i++) printf("%02x", buf[i]);
+  printf("\n");
+}
+
+// Loop passes mostly near 300 us with a slow tail, and ack round trips of
+// a few ms, per device
+int synth(int devices) {
+  std::mt19937 rng(1);
+  std::lognormal_distribution<double> loop(std::log(300.0), 0.4);
+  std::lognormal_distribution<double> ack(std::log(4000.0), 0.6);
+  std::uniform_real_distribution<double> unit(0, 1);
+  for (int d = 0; d < devices; d++) {
+    LatencyHistogram loopHist = {}, ackHist = {};
+    for (int i = 0; i < 100000; i++) {
+      double us = loop(rng);
+      if (unit(rng) < 0.002) us += 20000;  // Occasional blocking call
+      loopHist.record((uint32_t)us);
+    }
+    for (int i = 0; i < 2000; i++) ackHist.record((uint32_t)ack(rng));
+    printDump("loop", loopHist);
+    printDump("ack", ackHist);
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc == 3 && strcmp(argv[1], "--synth") == 0) return synth(atoi(argv[2]));
+
+  bool buckets = false;
+  std::vector<const char*> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--buckets") == 0) buckets = true;
+    else if (argv[i][0] == '-') {
+      fprintf(stderr, "usage: %s [--buckets] [console.txt ...] | --synth devices\n", argv[0]);
+      return 2;
+    } else paths.push_back(argv[i]);
+  }
+  if (paths.empty()) paths.push_back("-");
+
+  std::vector<Merged> merged;
+  int bad = 0;
+  std::vector<char> line(1 << 16);
+  for (const char* path : paths) {
+    FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!f) {
+      perror(path);
+      return 1;
+    }
+    while (fgets(line.data(), (int)line.size(), f)) {
+      if (!strstr(line.data(), "HIST ")) continue;
+      std::string name;
+      LatencyHistogram h;
+      if (!parseLine(line.data(), &name, &h)) {
+        bad++;
+        continue;
+      }
+      size_t i = 0;
+      while (i < merged.size() && merged[i].name != name) i++;
+      if (i == merged.size()) {
+        merged.emplace_back();
+        merged.back().name = name;
+      }
+      merged[i].hist.merge(h);
+      merged[i].dumps++;
+    }
+    if (f != stdin) fclose(f);
+  }
+
+  if (merged.empty()) {
+    fprintf(stderr, "no HIST lines found\n");
+    return 1;
+  }
+  printf("%-8s %6s %10s %8s %8s %8s %8s %8s %8s %8s  (us)\n",
+    "", "dumps", "count", "min", "mean", "p50", "p90", "p99", "p99.9", "max");
+  for (const Merged& m : merged) {
+    const LatencyHistogram& h = m.hist;
+    printf("%-8s %6d %10u %8u %8u %8u %8u %8u %8u %8u\n", m.name.c_str(), m.dumps, h.total,
+      h.total ? h.minValue : 0, h.mean(), h.percentile(50), h.percentile(90), h.percentile(99),
+      h.percentile(99.9f), h.maxValue);
+    if (buckets) printBuckets(h);
+  }
+  if (bad) printf("%d malformed HIST lines skipped\n", bad);
+  return 0;
+}
@@ -0,0 +1,578 @@
+// Stand-in for a Hue bridge's HTTP API, for testing the dimmer's Hue backend.
+//
+// Build:  g++ -std=c++17 -O2 -I src -o huebridge tools/huebridge.cpp
+// Usage:  ./huebridge [--addr 127.0.0.1] [--port 80] [--delay-ms 0] [--report-s 10]
+//         ./huebridge --bench 500 [--addr 127.0.0.1] [--port 80] [--depth 4] [--pass-ms 0]
+//
+// Serves PUT /api/<key>/lights/<n>/state and GET /api/<key>/lights/<n> on
+// any number of keep-alive connections. Pipelined requests are answered in
+// order; --delay-ms models the bridge's per-request processing time, one
+// request at a time per connection. Requests, connections, pipeline depth
+// and request-to-response latency are printed every --report-s seconds and
+// on Ctrl-C, with each light's final state.
+//
+// --bench runs clients against a running stand-in (or a real bridge). It
+// compares a connection per request, keep-alive, and keep-alive with
+// --depth requests pipelined, then runs the firmware's own transport
+// (src/hue_http.h, the state machine behind HueBackend) over a socket: a
+// knob spin of N detents, one per --pass-ms loop pass, through sendBatch()
+// and poll(), followed by a probe that must read back the last detent.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <sys/ioctl.h>
+
+#include "hue_http.h"
+
+namespace {
+
+struct Light {
+  bool on = false;
+  int bri = 254;
+  int ct = 370;
+  unsigned long commands = 0;
+};
+
+struct Response {
+  double due;       // When the "bridge" has finished processing it
+  double received;  // When the request was complete
+  std::string data;
+  bool close;
+};
+
+struct Connection {
+  int fd = -1;
+  std::string in;
+  std::deque<Response> out;
+  double busyUntil = 0;
+};
+
+struct Totals {
+  unsigned long connections = 0;
+  unsigned long puts = 0;
+  unsigned long gets = 0;
+  unsigned long errors = 0;
+  size_t maxDepth = 0;  // Requests received but not yet answered on one connection
+  unsigned long answered = 0;
+  double latencySumMs = 0;
+  double latencyMaxMs = 0;
+};
+
+volatile sig_atomic_t stopRequested = 0;
+
+void onSignal(int) { stopRequested = 1; }
+
+double nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+bool findInt(const std::string& json, const char* key, int* out) {
+  size_t p = json.find(key);
+  if (p == std::string::npos) return false;
+  p += strlen(key);
+  while (p < json.size() && (json[p] == ' ' || json[p] == ':')) p++;
+  char* end;
+  long v = strtol(json.c_str() + p, &end, 10);
+  if (end == json.c_str() + p) return false;
+  *out = (int)v;
+  return true;
+}
+
+std::string httpResponse(int status, const std::string& body) {
+  char head[160];
+  snprintf(head, sizeof(head),
+    "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n",
+    status, status == 200 ? "OK" : "Not Found", body.size());
+  return head + body;
+}
+
+std::string handleRequest(std::map<int, Light>& lights, Totals& totals,
+                          const std::string& method, const std::string& path, const std::string& body) {
+  int n = 0;
+  size_t at = path.find("/lights/");
+  if (path.compare(0, 5, "/api/") != 0 || at == std::string::npos ||
+      sscanf(path.c_str() + at, "/lights/%d", &n) != 1) {
+    totals.errors++;
+    return httpResponse(404,
+      "[{\"error\":{\"type\":3,\"address\":\"" + path + "\",\"description\":\"resource not available\"}}]");
+  }
+
+  Light& light = lights[n];
+  char buf[256];
+  if (method == "GET") {
+    totals.gets++;
+    snprintf(buf, sizeof(buf),
+      "{\"state\":{\"on\":%s,\"bri\":%d,\"ct\":%d,\"colormode\":\"ct\",\"reachable\":true},"
+      "\"type\":\"Color temperature light\",\"name\":\"Light %d\"}",
+      light.on ? "true" : "false", light.bri, light.ct, n);
+    return httpResponse(200, buf);
+  }
+
+  totals.puts++;
+  light.commands++;
+  std::string result = "[";
+  if (body.find("\"on\":true") != std::string::npos) light.on = true;
+  if (body.find("\"on\":false") != std::string::npos) light.on = false;
+  snprintf(buf, sizeof(buf), "{\"success\":{\"/lights/%d/state/on\":%s}}", n, light.on ? "true" : "false");
+  result += buf;
+  int v;
+  if (findInt(body, "\"bri\"", &v)) {
+    light.bri = v;
+    snprintf(buf, sizeof(buf), ",{\"success\":{\"/lights/%d/state/bri\":%d}}", n, v);
+    result += buf;
+  }
+  if (findInt(body, "\"ct\"", &v)) {
+    light.ct = v;
+    snprintf(buf, sizeof(buf), ",{\"success\":{\"/lights/%d/state/ct\":%d}}", n, v);
+    result += buf;
+  }
+  return httpResponse(200, result + "]");
+}
+
+// Parse every complete request in c.in and schedule its response
+void parseRequests(Connection& c, std::map<int, Light>& lights, Totals& totals,
+                   double delayMs, double now) {
+  for (;;) {
+    size_t end = c.in.find("\r\n\r\n");
+    if (end == std::string::npos) return;
+    std::string head = c.in.substr(0, end);
+    size_t length = 0;
+    for (size_t p = head.find("\r\n"); p != std::string::npos; p = head.find("\r\n", p + 2)) {
+      if (strncasecmp(head.c_str() + p + 2, "Content-Length:", 15) == 0) {
+        length = strtoul(head.c_str() + p + 17, nullptr, 10);
+      }
+    }
+    if (c.in.size() < end + 4 + length) return;
+
+    char method[8] = "", path[128] = "";
+    sscanf(head.c_str(), "%7s %127s", method, path);
+    std::string body = c.in.substr(end + 4, length);
+    c.in.erase(0, end + 4 + length);
+
+    Response r;
+    r.received = now;
+    c.busyUntil = std::max(c.busyUntil, now) + delayMs;
+    r.due = c.busyUntil;
+    r.data = handleRequest(lights, totals, method, path, body);
+    r.close = strcasestr(head.c_str(), "Connection: close") != nullptr;
+    c.out.push_back(r);
+    totals.maxDepth = std::max(totals.maxDepth, c.out.size());
+  }
+}
+
+// Write responses that are due; false if the connection should be closed
+bool sendDue(Connection& c, Totals& totals, double now) {
+  while (!c.out.empty() && c.out.front().due <= now) {
+    Response& r = c.out.front();
+    if (send(c.fd, r.data.data(), r.data.size(), MSG_NOSIGNAL) < 0) return false;
+    double latency = now - r.received;
+    totals.answered++;
+    totals.latencySumMs += latency;
+    totals.latencyMaxMs = std::max(totals.latencyMaxMs, latency);
+    bool close = r.close;
+    c.out.pop_front();
+    if (close) return false;
+  }
+  return true;
+}
+
+void report(const std::map<int, Light>& lights, const Totals& t, double elapsedMs) {
+  printf("--- %.1f s: %lu connections, %lu PUT, %lu GET, %lu errors, max pipeline depth %zu\n",
+    elapsedMs / 1e3, t.connections, t.puts, t.gets, t.errors, t.maxDepth);
+  if (t.answered) {
+    printf("    request-to-response: %.2f ms avg, %.2f ms max\n",
+      t.latencySumMs / t.answered, t.latencyMaxMs);
+  }
+  for (const auto& entry : lights) {
+    const Light& l = entry.second;
+    printf("    light %d: %-3s bri %3d ct %3d  %lu commands\n",
+      entry.first, l.on ? "on" : "off", l.bri, l.ct, l.commands);
+  }
+  fflush(stdout);
+}
+
+int serve(const sockaddr_in& addr, double delayMs, double reportEveryMs) {
+  int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int one = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (listenFd < 0 || bind(listenFd, (const sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 16) < 0) {
+    fprintf(stderr, "cannot listen on port %d: %s\n", ntohs(addr.sin_port), strerror(errno));
+    return 1;
+  }
+
+  int epfd = epoll_create1(0);
+  epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.fd = listenFd;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, listenFd, &ev);
+
+  char ip[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+  printf("Hue bridge stand-in on %s:%d, %.1f ms per request\n", ip, ntohs(addr.sin_port), delayMs);
+  fflush(stdout);
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  std::map<int, Connection> connections;
+  std::map<int, Light> lights;
+  Totals totals;
+  double start = nowMs();
+  double lastReport = start;
+  epoll_event events[64];
+
+  while (!stopRequested) {
+    // Wake for the next scheduled response
+    int timeout = 50;
+    double now = nowMs();
+    for (auto& entry : connections) {
+      if (!entry.second.out.empty()) {
+        timeout = std::min(timeout, std::max(0, (int)(entry.second.out.front().due - now + 0.999)));
+      }
+    }
+
+    int ready = epoll_wait(epfd, events, 64, timeout);
+    if (ready < 0 && errno != EINTR) { perror("epoll_wait"); break; }
+    now = nowMs();
+
+    for (int e = 0; e < ready; e++) {
+      int fd = events[e].data.fd;
+      if (fd == listenFd) {
+        int client;
+        while ((client = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+          setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          epoll_event cev = {};
+          cev.events = EPOLLIN;
+          cev.data.fd = client;
+          epoll_ctl(epfd, EPOLL_CTL_ADD, client, &cev);
+          connections[client].fd = client;
+          totals.connections++;
+        }
+        continue;
+      }
+
+      Connection& c = connections[fd];
+      char buf[4096];
+      ssize_t got;
+      bool closed = false;
+      while ((got = recv(fd, buf, sizeof(buf), 0)) > 0) c.in.append(buf, (size_t)got);
+      if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) closed = true;
+      parseRequests(c, lights, totals, delayMs, now);
+      if (closed) {
+        close(fd);
+        connections.erase(fd);
+      }
+    }
+
+    for (auto it = connections.begin(); it != connections.end();) {
+      if (sendDue(it->second, totals, now)) {
+        ++it;
+      } else {
+        close(it->first);
+        it = connections.erase(it);
+      }
+    }
+
+    if (reportEveryMs > 0 && now - lastReport >= reportEveryMs) {
+      lastReport = now;
+      report(lights, totals, now - start);
+    }
+  }
+
+  report(lights, totals, nowMs() - start);
+  for (auto& entry : connections) close(entry.first);
+  close(listenFd);
+  close(epfd);
+  return 0;
+}
+
+// --- Client benchmark ---
+
+int connectTo(const sockaddr_in& addr) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (connect(fd, (const sockaddr*)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+std::string putRequest(int i, bool keepAlive) {
+  char body[48], req[256];
+  snprintf(body, sizeof(body), "{\"on\":true,\"bri\":%d}", 1 + i % 254);
+  snprintf(req, sizeof(req),
+    "PUT /api/bench/lights/1/state HTTP/1.1\r\nHost: bridge\r\n%s"
+    "Content-Type: application/json\r\nContent-Length: %zu\r\n\r\n%s",
+    keepAlive ? "" : "Connection: close\r\n", strlen(body), body);
+  return req;
+}
+
+// Block until one full response has been read from fd
+bool readResponse(int fd, std::string& buffer) {
+  for (;;) {
+    size_t end = buffer.find("\r\n\r\n");
+    if (end != std::string::npos) {
+      const char* cl = strcasestr(buffer.c_str(), "Content-Length:");
+      size_t length = cl && cl < buffer.c_str() + end ? strtoul(cl + 15, nullptr, 10) : 0;
+      if (buffer.size() >= end + 4 + length) {
+        buffer.erase(0, end + 4 + length);
+        return true;
+      }
+    }
+    char buf[4096];
+    ssize_t got = recv(fd, buf, sizeof(buf), 0);
+    if (got <= 0) return false;
+    buffer.append(buf, (size_t)got);
+  }
+}
+
+void printBench(const char* name, int count, double totalMs, double latencySumMs, double latencyMaxMs) {
+  printf("  %-22s %8.1f ms total  %6.2f ms/request  latency %.2f ms avg, %.2f ms max\n",
+    name, totalMs, totalMs / count, latencySumMs / count, latencyMaxMs);
+}
+
+// HueHttp's Link on a POSIX socket: blocking writes, non-blocking reads
+class SocketLink {
+ public:
+  sockaddr_in addr = {};
+  unsigned long connects = 0, requests = 0, responses = 0;
+  double latencySumMs = 0, latencyMaxMs = 0;
+
+  bool open() {
+    stop();
+    fd_ = connectTo(addr);
+    return fd_ >= 0;
+  }
+
+  bool connected() {
+    if (fd_ < 0) return false;
+    char c;
+    ssize_t got = recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return got > 0 || (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+  }
+
+  size_t write(const uint8_t* data, size_t len) {
+    size_t done = 0;
+    while (fd_ >= 0 && done < len) {
+      ssize_t n = send(fd_, data + done, len - done, MSG_NOSIGNAL);
+      if (n <= 0) break;
+      done += (size_t)n;
+    }
+    return done;
+  }
+
+  int available() {
+    int n = 0;
+    if (fd_ < 0 || ioctl(fd_, FIONREAD, &n) < 0) return 0;
+    return n;
+  }
+
+  int read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+
+  int read(uint8_t* data, size_t len) {
+    return fd_ < 0 ? -1 : (int)recv(fd_, data, len, MSG_DONTWAIT);
+  }
+
+  void stop() {
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+  }
+
+  uint32_t nowMs() { return (uint32_t)::nowMs(); }
+  uint32_t nowUs() { return (uint32_t)(::nowMs() * 1e3); }
+  void onConnect() { connects++; }
+  void onRequests(int count) { requests += (unsigned long)count; }
+  void onResponse(uint32_t latencyUs) {
+    responses++;
+    latencySumMs += latencyUs / 1e3;
+    latencyMaxMs = std::max(latencyMaxMs, latencyUs / 1e3);
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+// A knob spin on light 1 through the firmware transport, paced like the
+// dimmer's loop: each pass drains replies and sends one detent
+int benchTransport(const sockaddr_in& addr, int count, double passMs) {
+  HueHttp<SocketLink, 2> hue;
+  hue.link.addr = addr;
+  hue.configure("bridge", "bench");
+  hue.setChannel(1, 1);
+
+  uint32_t nextId = 1;
+  unsigned long replies = 0, failed = 0;
+  BackendReply reply;
+  double start = nowMs();
+  for (int i = 0; i < count; i++) {
+    double passStart = nowMs();
+    while (hue.poll(&reply)) {
+      replies++;
+      if (!reply.success) failed++;
+    }
+    BatchEntry e;
+    e.bulb = 1;
+    e.id = nextId++;
+    e.cmd = PilotCommand();
+    e.cmd.fields = PILOT_DIMMING;
+    e.cmd.dimming = (uint8_t)(10 + i % 91);
+    hue.sendBatch(&e, 1);
+    while (nowMs() - passStart < passMs) {}
+  }
+  int last = 10 + (count - 1) % 91;
+
+  // Drain, then read the light back
+  hue.probe(1, nextId++);
+  PilotCommand state = PilotCommand();
+  bool probed = false;
+  double deadline = nowMs() + 5000;
+  while (!probed && nowMs() < deadline) {
+    while (hue.poll(&reply)) {
+      if (reply.state.fields) {
+        state = reply.state;
+        probed = true;
+      } else {
+        replies++;
+        if (!reply.success) failed++;
+      }
+    }
+  }
+  double total = nowMs() - start;
+  SocketLink& l = hue.link;
+  printf("  %-22s %8.1f ms total  %lu PUTs for %d detents (%lu merged), %lu connects\n",
+    "HueHttp transport", total, l.requests - 1, count, (unsigned long)count - (l.requests - 1), l.connects);
+  if (l.responses) {
+    printf("  %-22s latency %.2f ms avg, %.2f ms max\n", "", l.latencySumMs / l.responses, l.latencyMaxMs);
+  }
+  hue.link.stop();
+
+  // Dimming goes out as bri and comes back rounded
+  int readBack = state.dimming;
+  if (!probed || failed || replies != l.requests - 1 || readBack < last - 1 || readBack > last + 1) {
+    fprintf(stderr, "transport check failed: probe %s, %lu failed, %lu replies, dimming %d (sent %d)\n",
+      probed ? "answered" : "unanswered", failed, replies, readBack, last);
+    return 1;
+  }
+  return 0;
+}
+
+int bench(const sockaddr_in& addr, int count, int depth, double passMs) {
+  printf("%d PUTs per mode, pipeline depth %d\n", count, depth);
+
+  // One connection per request
+  double start = nowMs(), sum = 0, max = 0;
+  for (int i = 0; i < count; i++) {
+    double t0 = nowMs();
+    int fd = connectTo(addr);
+    if (fd < 0) { perror("connect"); return 1; }
+    std::string req = putRequest(i, false), buffer;
+    send(fd, req.data(), req.size(), MSG_NOSIGNAL);
+    if (!readResponse(fd, buffer)) { fprintf(stderr, "connection closed early\n"); return 1; }
+    close(fd);
+    double dt = nowMs() - t0;
+    sum += dt;
+    max = std::max(max, dt);
+  }
+  printBench("connection per request", count, nowMs() - start, sum, max);
+
+  // Keep-alive, one request at a time
+  int fd = connectTo(addr);
+  if (fd < 0) { perror("connect"); return 1; }
+  std::string buffer;
+  start = nowMs(), sum = 0, max = 0;
+  for (int i = 0; i < count; i++) {
+    double t0 = nowMs();
+    std::string req = putRequest(i, true);
+    send(fd, req.data(), req.size(), MSG_NOSIGNAL);
+    if (!readResponse(fd, buffer)) { fprintf(stderr, "connection closed early\n"); return 1; }
+    double dt = nowMs() - t0;
+    sum += dt;
+    max = std::max(max, dt);
+  }
+  printBench("keep-alive", count, nowMs() - start, sum, max);
+
+  // Keep-alive with up to depth requests outstanding
+  std::deque<double> sentAt;
+  start = nowMs(), sum = 0, max = 0;
+  int sent = 0, answered = 0;
+  while (answered < count) {
+    std::string batch;
+    while (sent < count && (int)sentAt.size() < depth) {
+      batch += putRequest(sent++, true);
+      sentAt.push_back(nowMs());
+    }
+    if (!batch.empty()) send(fd, batch.data(), batch.size(), MSG_NOSIGNAL);
+    if (!readResponse(fd, buffer)) { fprintf(stderr, "connection closed early\n"); return 1; }
+    double dt = nowMs() - sentAt.front();
+    sentAt.pop_front();
+    sum += dt;
+    max = std::max(max, dt);
+    answered++;
+  }
+  printBench("keep-alive pipelined", count, nowMs() - start, sum, max);
+  close(fd);
+  return benchTransport(addr, count, passMs);
+}
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+    "usage: %s [--addr 127.0.0.1] [--port 80] [--delay-ms 0] [--report-s 10]\n"
+    "       %s --bench N [--addr 127.0.0.1] [--port 80] [--depth 4] [--pass-ms 0]\n", argv0, argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* addrText = "127.0.0.1";
+  int port = 80;
+  double delayMs = 0;
+  double reportEveryMs = 10000;
+  int benchCount = 0;
+  int depth = 4;
+  double passMs = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (strcmp(arg, "--addr") == 0 && hasValue) addrText = argv[++i];
+    else if (strcmp(arg, "--port") == 0 && hasValue) port = atoi(argv[++i]);
+    else if (strcmp(arg, "--delay-ms") == 0 && hasValue) delayMs = atof(argv[++i]);
+    else if (strcmp(arg, "--report-s") == 0 && hasValue) reportEveryMs = atof(argv[++i]) * 1e3;
+    else if (strcmp(arg, "--bench") == 0 && hasValue) benchCount = atoi(argv[++i]);
+    else if (strcmp(arg, "--depth") == 0 && hasValue) depth = atoi(argv[++i]);
+    else if (strcmp(arg, "--pass-ms") == 0 && hasValue) passMs = atof(argv[++i]);
+    else { usage(argv[0]); return 2; }
+  }
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  if (inet_pton(AF_INET, addrText, &addr.sin_addr) != 1 || depth < 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  return benchCount > 0 ? bench(addr, benchCount, depth, passMs) : serve(addr, delayMs, reportEveryMs);
+}
@@ -0,0 +1,131 @@
+// Host-side decoder for deferred log frames (firmware built with -D LOG_DEFERRED).
+//
+// Build:  g++ -std=c++17 -O2 -I src -o logdecode tools/logdecode.cpp
+// Usage:  pio device monitor -e esp32dev-deflog --raw | ./logdecode [--stats]
+//         ./logdecode [--stats] capture.bin
+//         ./logdecode --table
+//
+// Plain Serial text (setup banner, console replies) passes through unchanged;
+// 0xFF-prefixed frames are rendered with the formats from src/log_messages.h.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "log_codec.h"
+#include "log_messages.h"
+
+namespace {
+
+#define X(id, level, fmt) fmt,
+const char* const FORMATS[] = {LOG_MESSAGES(X)};
+#undef X
+
+#define X(id, level, fmt) #id,
+const char* const NAMES[] = {LOG_MESSAGES(X)};
+#undef X
+
+const int MSG_COUNT = sizeof(FORMATS) / sizeof(FORMATS[0]);
+
+struct Totals {
+  unsigned long frames = 0;
+  unsigned long frameBytes = 0;
+  unsigned long textBytes = 0;  // What the same events cost as text logs (incl. CRLF)
+  unsigned long badFrames = 0;
+};
+
+// Try to decode one frame at buf[0] (== LOG_FRAME_SYNC). Returns bytes consumed,
+// 0 if more input is needed, or 1 to skip a bad sync byte.
+size_t decodeFrame(const uint8_t* buf, size_t len, bool eof, Totals& totals) {
+  if (len < 2) return eof ? 1 : 0;
+  uint8_t id = buf[1];
+  if (id >= MSG_COUNT) {
+    totals.badFrames++;
+    return 1;
+  }
+
+  int argc = logArgCount(FORMATS[id]);
+  uint32_t args[LOG_MAX_ARGS] = {};
+  size_t pos = 2;
+  for (int i = 0; i < argc; i++) {
+    size_t used = logGetVarint(buf + pos, len - pos, &args[i]);
+    if (used == 0) {
+      if (!eof && len - pos < (size_t)LOG_VARINT_MAX) return 0;
+      totals.badFrames++;
+      return 1;
+    }
+    pos += used;
+  }
+
+  char text[256];
+  size_t n = logFormat(text, sizeof(text), FORMATS[id], args, argc);
+  fwrite(text, 1, n, stdout);
+  fputc('\n', stdout);
+
+  totals.frames++;
+  totals.frameBytes += pos;
+  totals.textBytes += n + 2;
+  return pos;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool showStats = false;
+  const char* path = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--stats") == 0) {
+      showStats = true;
+    } else if (strcmp(argv[i], "--table") == 0) {
+      for (int id = 0; id < MSG_COUNT; id++) {
+        printf("%3d  %-20s %s\n", id, NAMES[id], FORMATS[id]);
+      }
+      return 0;
+    } else {
+      path = argv[i];
+    }
+  }
+
+  FILE* in = stdin;
+  if (path && !(in = fopen(path, "rb"))) {
+    perror(path);
+    return 1;
+  }
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+
+  Totals totals;
+  std::vector<uint8_t> buf;
+  uint8_t chunk[4096];
+  bool eof = false;
+
+  while (!eof) {
+    size_t got = fread(chunk, 1, sizeof(chunk), in);
+    if (got == 0) eof = true;
+    buf.insert(buf.end(), chunk, chunk + got);
+
+    size_t pos = 0;
+    while (pos < buf.size()) {
+      if (buf[pos] != LOG_FRAME_SYNC) {
+        const uint8_t* sync = (const uint8_t*)memchr(&buf[pos], LOG_FRAME_SYNC, buf.size() - pos);
+        size_t end = sync ? (size_t)(sync - buf.data()) : buf.size();
+        fwrite(&buf[pos], 1, end - pos, stdout);
+        pos = end;
+        continue;
+      }
+      size_t used = decodeFrame(&buf[pos], buf.size() - pos, eof, totals);
+      if (used == 0) break;
+      pos += used;
+    }
+    buf.erase(buf.begin(), buf.begin() + pos);
+  }
+
+  if (showStats) {
+    fprintf(stderr, "frames: %lu  bytes: %lu  as text: %lu  ratio: %.1fx  bad: %lu\n",
+      totals.frames, totals.frameBytes, totals.textBytes,
+      totals.frameBytes ? (double)totals.textBytes / totals.frameBytes : 0.0,
+      totals.badFrames);
+  }
+  if (in != stdin) fclose(in);
+  return 0;
+}
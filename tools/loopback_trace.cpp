@@ -0,0 +1,286 @@
+// Drives src/command_queue.h and src/loopback_backend.h through the same
+// pass cycle as lights.cpp on the host: inputs push, the pass's commands
+// go out as one sendBatch(), probes follow, replies come back on poll().
+//
+// Build:  g++ -std=c++17 -O2 -I src -o loopback_trace tools/loopback_trace.cpp
+// Usage:  ./loopback_trace [passes] [seed]   (default 20000 per phase, 1)
+//
+// The controller side is a pared-down copy of the lights.cpp liveness rules
+// (ack timeout, misses in a row, dead-bulb probes, restore on the first
+// reply). It runs four phases on the loopback's dropEvery knob: no loss,
+// total loss, one packet in three lost, then no loss with a resync.
+// Checked throughout:
+//   - each bulb gets at most one packet per pass (PassPackets)
+//   - every command sent carries the latest state pushed for its fields
+//   - every push is queued, merged or dropped, and each queued slot sends once
+//   - replies == packets - losses, each matching one packet
+// and at the end of the phases:
+//   - no loss: no bulb missed a reply or died
+//   - total loss: every bulb with traffic is dead
+//   - partial loss: dead bulbs are probed back to life
+//   - after the resync every model light matches the desired state
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+
+#include "loopback_backend.h"
+
+namespace {
+
+const int BULBS = 4;
+const unsigned long PASS_MS = 10;
+const unsigned long ACK_TIMEOUT_MS = 1000;  // lights.h
+const int DEAD_AFTER_MISSES = 3;
+const unsigned long PROBE_INTERVAL_MS = 5000;
+const unsigned long STREAM_INTERVAL_MS = 50;
+
+struct Desired {
+  bool on = false;
+  int dimming = 50;
+  int temp = 0;
+};
+
+struct BulbState {
+  Desired want;
+  bool alive = true;
+  int misses = 0;
+  uint32_t missesTotal = 0;
+  bool awaitingReply = false;
+  unsigned long sentAt = 0;
+  unsigned long lastProbe = 0;
+  bool everSent = false;
+};
+
+CommandQueue<BULBS> queue;
+LoopbackBackend<BULBS> loopback;
+BulbState bulbs[BULBS];
+std::map<uint32_t, std::pair<int, unsigned long> > outstanding;  // id -> bulb, sent at
+std::mt19937 rng;
+unsigned long now = 1000;
+uint32_t nextId = 1;
+uint32_t packets = 0, lost = 0, replies = 0;
+uint32_t pushes = 0, queued = 0, merged = 0, dropped = 0, commandsSent = 0;
+uint32_t deaths = 0, revivals = 0;
+int failures = 0;
+
+void fail(const char* what, int bulb) {
+  if (failures < 10) fprintf(stderr, "t=%lu bulb %d: %s\n", now, bulb, what);
+  failures++;
+}
+
+void push(int bulb, const PilotCommand& cmd, CommandPriority priority) {
+  pushes++;
+  switch (queue.push(bulb, cmd, priority)) {
+    case CommandQueue<BULBS>::PUSH_QUEUED: queued++; break;
+    case CommandQueue<BULBS>::PUSH_MERGED: merged++; break;
+    default: dropped++; break;
+  }
+}
+
+void pushControl(int bulb) {
+  const Desired& w = bulbs[bulb].want;
+  PilotCommand cmd = {};
+  cmd.fields = PILOT_STATE;
+  cmd.on = w.on;
+  if (w.on) {
+    cmd.fields |= PILOT_DIMMING;
+    cmd.dimming = (uint8_t)w.dimming;
+    if (w.temp) {
+      cmd.fields |= PILOT_TEMP;
+      cmd.temp = (uint16_t)w.temp;
+    }
+  }
+  push(bulb, cmd, PRIORITY_CONTROL);
+}
+
+// Counts the backend's packets the same way its lost() does
+void notePacket() {
+  packets++;
+  if (loopback.dropEvery && packets % loopback.dropEvery == 0) lost++;
+}
+
+void drainReplies() {
+  BackendReply r;
+  while (loopback.poll(&r)) {
+    replies++;
+    std::map<uint32_t, std::pair<int, unsigned long> >::iterator it = outstanding.find(r.id);
+    if (it == outstanding.end() || it->second.first != r.bulb) {
+      fail("reply to no outstanding packet", r.bulb);
+      continue;
+    }
+    outstanding.erase(it);
+    BulbState& b = bulbs[r.bulb];
+    b.awaitingReply = false;
+    b.misses = 0;
+    if (!b.alive) {
+      b.alive = true;
+      revivals++;
+      pushControl(r.bulb);  // restoreBulb()
+    }
+  }
+}
+
+void runLiveness() {
+  for (std::map<uint32_t, std::pair<int, unsigned long> >::iterator it = outstanding.begin(); it != outstanding.end();) {
+    if (now - it->second.second >= ACK_TIMEOUT_MS) {
+      outstanding.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  for (int i = 0; i < BULBS; i++) {
+    BulbState& b = bulbs[i];
+    if (!b.awaitingReply || now - b.sentAt < ACK_TIMEOUT_MS) continue;
+    b.awaitingReply = false;
+    b.missesTotal++;
+    if (b.alive && ++b.misses >= DEAD_AFTER_MISSES) {
+      b.alive = false;
+      b.lastProbe = now;
+      deaths++;
+    }
+  }
+}
+
+void inputs(int traffic) {
+  for (int n = 0; n < traffic; n++) {
+    int bulb = (int)(rng() % BULBS);
+    BulbState& b = bulbs[bulb];
+    int kind = (int)(rng() % 6);
+    if (kind == 0) {
+      b.want.on = !b.want.on;
+      pushControl(bulb);
+      continue;
+    }
+    if (!b.want.on || !b.alive) continue;  // Streams are not sent to dead bulbs
+    b.want.dimming = 10 + (int)(rng() % 46) * 2;
+    if (kind == 1) b.want.temp = 2200 + (int)(rng() % 4) * 1000;
+    PilotCommand cmd = {};
+    cmd.fields = PILOT_DIMMING;
+    cmd.dimming = (uint8_t)b.want.dimming;
+    if (b.want.temp) {
+      cmd.fields |= PILOT_TEMP;
+      cmd.temp = (uint16_t)b.want.temp;
+    }
+    push(bulb, cmd, PRIORITY_STREAM);
+  }
+}
+
+void sent(int bulb, uint32_t id) {
+  BulbState& b = bulbs[bulb];
+  outstanding[id] = std::make_pair(bulb, now);
+  b.everSent = true;
+  if (!b.awaitingReply) {
+    b.awaitingReply = true;
+    b.sentAt = now;
+  }
+}
+
+void flush() {
+  PassPackets<BULBS> pass;
+  BatchEntry batch[BULBS];
+  int count = 0;
+  int bulb;
+  PilotCommand cmd;
+  while (queue.pop(now, STREAM_INTERVAL_MS, &bulb, &cmd)) {
+    const Desired& w = bulbs[bulb].want;
+    if ((cmd.fields & PILOT_STATE) && cmd.on != w.on) fail("sent a stale on/off", bulb);
+    if ((cmd.fields & PILOT_DIMMING) && cmd.dimming != w.dimming) fail("sent a stale dimming", bulb);
+    if ((cmd.fields & PILOT_TEMP) && cmd.temp != w.temp) fail("sent a stale temp", bulb);
+    BatchEntry& e = batch[count++];
+    e.bulb = bulb;
+    e.id = nextId++;
+    e.cmd = cmd;
+    e.sent = false;
+    pass.command(bulb);
+  }
+  for (int i = 0; i < count; i++) notePacket();
+  if (loopback.sendBatch(batch, count) != count) fail("sendBatch did not send every entry", -1);
+  for (int i = 0; i < count; i++) sent(batch[i].bulb, batch[i].id);
+  commandsSent += (uint32_t)count;
+
+  for (int i = 0; i < BULBS; i++) {
+    BulbState& b = bulbs[i];
+    if (b.alive || now - b.lastProbe < PROBE_INTERVAL_MS) continue;
+    b.lastProbe = now;
+    if (!pass.probe(i)) continue;
+    uint32_t id = nextId++;
+    notePacket();
+    loopback.probe(i, id);
+    sent(i, id);
+  }
+  for (int i = 0; i < BULBS; i++) {
+    if (pass.packets(i) > 1) fail("more than one packet in a pass", i);
+  }
+}
+
+void runPasses(unsigned long passes, int maxTraffic, unsigned long resyncEveryMs) {
+  unsigned long lastResync = now;
+  for (unsigned long p = 0; p < passes && failures == 0; p++) {
+    drainReplies();
+    runLiveness();
+    inputs(maxTraffic ? (int)(rng() % (maxTraffic + 1)) : 0);
+    if (resyncEveryMs && now - lastResync >= resyncEveryMs) {
+      for (int i = 0; i < BULBS; i++) pushControl(i);
+      lastResync = now;
+    }
+    flush();
+    now += PASS_MS;
+  }
+}
+
+int deadCount() {
+  int n = 0;
+  for (int i = 0; i < BULBS; i++) n += bulbs[i].alive ? 0 : 1;
+  return n;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned long passes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+  rng.seed(argc > 2 ? (unsigned)atoi(argv[2]) : 1);
+
+  loopback.dropEvery = 0;
+  runPasses(passes, 3, 0);
+  uint32_t missesClean = 0;
+  for (int i = 0; i < BULBS; i++) missesClean += bulbs[i].missesTotal;
+  if (missesClean || deaths) fail("replies missed without any loss", -1);
+  printf("no loss:      %u packets, %u replies, %u misses, %u deaths\n", packets, replies, missesClean, deaths);
+
+  loopback.dropEvery = 1;
+  runPasses(passes, 3, 500);
+  for (int i = 0; i < BULBS; i++) {
+    if (bulbs[i].everSent && bulbs[i].alive) fail("still alive after total loss", i);
+  }
+  printf("total loss:   %d of %d bulbs dead, %u deaths\n", deadCount(), BULBS, deaths);
+
+  loopback.dropEvery = 3;
+  uint32_t revivedBefore = revivals;
+  runPasses(passes, 3, 500);
+  if (revivals == revivedBefore) fail("no bulb came back under partial loss", -1);
+  printf("1 in 3 lost:  %u revivals, %d dead at the end\n", revivals - revivedBefore, deadCount());
+
+  // Resync once the network is clean, then let everything settle
+  loopback.dropEvery = 0;
+  runPasses(PROBE_INTERVAL_MS / PASS_MS + 1, 0, 0);
+  for (int i = 0; i < BULBS; i++) pushControl(i);
+  runPasses(ACK_TIMEOUT_MS / PASS_MS, 0, 0);
+  for (int i = 0; i < BULBS; i++) {
+    const Desired& w = bulbs[i].want;
+    const LoopbackBackend<BULBS>::Light& l = loopback.lights[i];
+    if (!bulbs[i].alive) fail("dead after the network came back", i);
+    if (l.on != w.on) fail("model light on/off differs", i);
+    if (w.on && l.dimming != w.dimming) fail("model light dimming differs", i);
+    if (w.on && w.temp && l.temp != w.temp) fail("model light temp differs", i);
+  }
+
+  if (replies != packets - lost) fail("replies != packets - losses", -1);
+  if (queued + merged + dropped != pushes) fail("pushes not all accounted for", -1);
+  if (commandsSent != queued) fail("queued slots and commands sent differ", -1);
+  printf("total:        %u pushes (%u merged, %u dropped), %u commands, %u packets, %u lost, %u replies\n",
+    pushes, merged, dropped, commandsSent, packets, lost, replies);
+  printf("%s\n", failures ? "FAILED" : "OK");
+  return failures ? 1 : 0;
+}
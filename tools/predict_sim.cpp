@@ -0,0 +1,196 @@
+// Replays simulated encoder spins through src/brightness_predictor.h and
+// src/command_queue.h and compares lag with and without prediction.
+//
+// Build:  g++ -std=c++17 -O2 -I src -o predict_sim tools/predict_sim.cpp
+// Usage:  ./predict_sim [spins] [seed]
+//
+// Each spin is a run of detents (2% each) at 40-150 detents/s. Most slow
+// down to a stop, like a flick of the knob, and the rest stop abruptly. The
+// controller loop runs every 10 ms as in main.cpp. A packet takes effect at
+// the bulb LATENCY_MS after it is sent.
+//
+// For each send interval the tool reports:
+//   reach X%   how long after the knob the bulb first gets within X points of
+//              the final brightness (negative = the bulb got there first)
+//   settle 2%  time from the last detent until the bulb stays within 2 points
+//              of the final brightness (0 if it was already there)
+//   spin err   mean |bulb - knob| while the knob is turning
+//   packets    packets sent per spin
+//   overshoot  spins where the bulb went more than 2 points past the final level
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "brightness_predictor.h"
+#include "command_queue.h"
+
+namespace {
+
+const int MIN_LEVEL = 10;
+const int MAX_LEVEL = 100;
+const int STEP = 2;
+const unsigned long PASS_MS = 10;
+const unsigned long LATENCY_MS = 15;
+const unsigned long TAIL_MS = 1500;
+
+struct Spin {
+  int start;
+  std::vector<std::pair<unsigned long, int>> detents;  // Time, direction
+};
+
+struct Result {
+  double reach2 = 0, reach5 = 0, settle2 = 0, spinErr = 0, packets = 0;
+  int overshoots = 0;
+  std::vector<double> reach5All;
+};
+
+Spin makeSpin(std::mt19937& rng) {
+  Spin spin;
+  spin.start = MIN_LEVEL + (int)(rng() % 46) * STEP;
+  int dir = spin.start < 55 ? 1 : -1;
+  if (rng() % 4 == 0) dir = -dir;
+
+  double peak = 0.04 + (rng() % 1000) / 1000.0 * 0.11;  // Detents per ms
+  double durationMs = 150 + rng() % 350;
+  bool flick = rng() % 10 < 7;
+  std::uniform_real_distribution<double> jitter(0.85, 1.15);
+
+  double t = 1000, travelled = 0;
+  for (double ms = 0; ms < durationMs; ms += 1) {
+    double v = flick ? peak * (1 - ms / durationMs) : peak;
+    travelled += v * jitter(rng);
+    while (travelled >= 1) {
+      travelled -= 1;
+      spin.detents.push_back({(unsigned long)(t + ms), dir});
+    }
+  }
+  return spin;
+}
+
+Result run(const std::vector<Spin>& spins, unsigned long intervalMs, bool predict) {
+  Result r;
+  for (const Spin& spin : spins) {
+    CommandQueue<1> queue;
+    BrightnessPredictor predictor(MIN_LEVEL, MAX_LEVEL, STEP);
+    predictor.horizonMs = intervalMs / 2.0f + LATENCY_MS;
+    std::vector<std::pair<unsigned long, int>> applied;  // When each packet lands, level
+    std::vector<std::pair<unsigned long, int>> knobTrace;
+    applied.push_back({spin.detents.front().first, spin.start});
+    knobTrace.push_back({spin.detents.front().first, spin.start});
+    int knob = spin.start;
+    int bulb = spin.start;
+    int lastSeen = spin.start;
+    size_t next = 0;
+    unsigned long end = spin.detents.back().first;
+    int final = spin.start;
+    for (const auto& d : spin.detents) final = std::clamp(final + d.second * STEP, MIN_LEVEL, MAX_LEVEL);
+
+    double errSum = 0;
+    int errSamples = 0;
+    int packets = 0;
+    for (unsigned long now = spin.detents.front().first; now <= end + TAIL_MS; now += PASS_MS) {
+      while (next < spin.detents.size() && spin.detents[next].first <= now) {
+        knob = std::clamp(knob + spin.detents[next].second * STEP, MIN_LEVEL, MAX_LEVEL);
+        knobTrace.push_back({spin.detents[next].first, knob});
+        next++;
+      }
+
+      PilotCommand cmd = {};
+      cmd.fields = PILOT_DIMMING;
+      if (knob != lastSeen) {
+        lastSeen = knob;
+        cmd.dimming = (uint8_t)(predict ? predictor.update(now, knob) : knob);
+        queue.push(0, cmd, PRIORITY_STREAM);
+      }
+      int level;
+      if (predict && predictor.correction(now, &level)) {
+        cmd.dimming = (uint8_t)level;
+        queue.push(0, cmd, PRIORITY_STREAM);
+      }
+
+      int target;
+      PilotCommand out;
+      while (queue.pop(now, intervalMs, &target, &out)) {
+        applied.push_back({now + LATENCY_MS, out.dimming});
+        packets++;
+      }
+
+      for (const auto& a : applied) {
+        if (a.first <= now) bulb = a.second;
+      }
+      if (now <= end) {
+        errSum += std::abs(bulb - knob);
+        errSamples++;
+      }
+    }
+
+    // Settling: the last moment the bulb was outside the band, measured per millisecond
+    auto settle = [&](int band) {
+      unsigned long lastOutside = 0;
+      int level = spin.start;
+      size_t i = 0;
+      for (unsigned long t = spin.detents.front().first; t <= end + TAIL_MS; t++) {
+        while (i < applied.size() && applied[i].first <= t) level = applied[i++].second;
+        if (std::abs(level - final) > band) lastOutside = t + 1;
+      }
+      return lastOutside > end ? (double)(lastOutside - end) : 0.0;
+    };
+
+    // First moment a level trace comes within band of the final brightness
+    auto reach = [&](const std::vector<std::pair<unsigned long, int>>& trace, int band) {
+      for (const auto& p : trace) {
+        if (std::abs(p.second - final) <= band) return (double)p.first;
+      }
+      return (double)(end + TAIL_MS);
+    };
+
+    bool overshoot = false;
+    int dir = spin.detents.front().second;
+    for (const auto& a : applied) {
+      if ((a.second - final) * dir > 2) overshoot = true;
+    }
+
+    double r5 = reach(applied, 5) - reach(knobTrace, 5);
+    r.reach2 += reach(applied, 2) - reach(knobTrace, 2);
+    r.reach5 += r5;
+    r.reach5All.push_back(r5);
+    r.settle2 += settle(2);
+    r.spinErr += errSamples ? errSum / errSamples : 0;
+    r.packets += packets;
+    r.overshoots += overshoot ? 1 : 0;
+  }
+
+  double n = (double)spins.size();
+  r.reach2 /= n;
+  r.reach5 /= n;
+  r.settle2 /= n;
+  r.spinErr /= n;
+  r.packets /= n;
+  return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int count = argc > 1 ? atoi(argv[1]) : 2000;
+  unsigned long seed = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1;
+  std::mt19937 rng(seed);
+  std::vector<Spin> spins;
+  for (int i = 0; i < count; i++) spins.push_back(makeSpin(rng));
+
+  printf("%d spins, %lu ms loop, %lu ms latency\n", count, PASS_MS, LATENCY_MS);
+  printf("interval  predictor  reach 2%%  reach 5%%  (p90)  settle 2%%  spin err  packets  overshoot\n");
+  for (unsigned long interval : {0UL, 50UL, 100UL, 200UL}) {
+    for (bool predict : {false, true}) {
+      Result r = run(spins, interval, predict);
+      std::sort(r.reach5All.begin(), r.reach5All.end());
+      printf("%5lu ms  %-9s  %5.1f ms  %5.1f ms  %5.0f  %6.1f ms  %5.2f pt  %7.1f  %8.1f%%\n",
+        interval, predict ? "on" : "off", r.reach2, r.reach5, r.reach5All[r.reach5All.size() * 9 / 10],
+        r.settle2, r.spinErr, r.packets, 100.0 * r.overshoots / count);
+    }
+  }
+  return 0;
+}
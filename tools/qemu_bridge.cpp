@@ -0,0 +1,188 @@
+// Connects the UART2 datagram tunnel of a QEMU_TARGET firmware
+// (src/serial_udp.h) to real UDP, so the emulated dimmer can talk to
+// tools/bulbfarm.cpp.
+//
+// Build:  g++ -std=c++17 -O2 -o qemu_bridge tools/qemu_bridge.cpp
+// Usage:  ./qemu_bridge [--serial 127.0.0.1:5556] [--farm 127.0.0.1:38899]
+//
+// --serial is QEMU's third -serial device (UART2) in TCP server mode. Each
+// bulb address the firmware sends to is given the next bulbfarm port in
+// order of first use (run bulbfarm with --ports); replies are framed back
+// with the bulb's original address as the source. Per-bulb datagram counts
+// are printed on exit (Ctrl-C or when QEMU closes the port).
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const uint8_t SLIP_END = 0xC0;
+const uint8_t SLIP_ESC = 0xDB;
+const uint8_t SLIP_ESC_END = 0xDC;
+const uint8_t SLIP_ESC_ESC = 0xDD;
+const size_t HEADER_LEN = 6;
+const size_t FRAME_MAX = 512;
+
+volatile sig_atomic_t stop = 0;
+
+struct Route {
+  uint8_t ip[4];       // Bulb address as the firmware knows it
+  uint16_t port;
+  unsigned long out = 0;
+  unsigned long in = 0;
+};
+
+bool parseAddr(const char* s, sockaddr_in* addr) {
+  char host[64];
+  const char* colon = strrchr(s, ':');
+  if (!colon || colon - s >= (long)sizeof(host)) return false;
+  memcpy(host, s, colon - s);
+  host[colon - s] = '\0';
+  *addr = {};
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(atoi(colon + 1));
+  return inet_pton(AF_INET, host, &addr->sin_addr) == 1;
+}
+
+void writeFrame(int fd, const uint8_t* data, size_t len) {
+  std::vector<uint8_t> out;
+  out.push_back(SLIP_END);
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] == SLIP_END) {
+      out.push_back(SLIP_ESC);
+      out.push_back(SLIP_ESC_END);
+    } else if (data[i] == SLIP_ESC) {
+      out.push_back(SLIP_ESC);
+      out.push_back(SLIP_ESC_ESC);
+    } else {
+      out.push_back(data[i]);
+    }
+  }
+  out.push_back(SLIP_END);
+  if (write(fd, out.data(), out.size()) < 0) perror("serial write");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* serialArg = "127.0.0.1:5556";
+  const char* farmArg = "127.0.0.1:38899";
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--serial") == 0 && hasValue) serialArg = argv[++i];
+    else if (strcmp(argv[i], "--farm") == 0 && hasValue) farmArg = argv[++i];
+    else {
+      fprintf(stderr, "usage: %s [--serial host:port] [--farm host:port]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  sockaddr_in serialAddr, farmAddr;
+  if (!parseAddr(serialArg, &serialAddr) || !parseAddr(farmArg, &farmAddr)) {
+    fprintf(stderr, "bad address\n");
+    return 2;
+  }
+
+  // QEMU may still be starting: retry for a few seconds
+  int serial = -1;
+  for (int attempt = 0; attempt < 50 && serial < 0; attempt++) {
+    serial = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(serial, (sockaddr*)&serialAddr, sizeof(serialAddr)) < 0) {
+      close(serial);
+      serial = -1;
+      usleep(100000);
+    }
+  }
+  if (serial < 0) {
+    fprintf(stderr, "cannot connect to %s: %s\n", serialArg, strerror(errno));
+    return 1;
+  }
+  int udp = socket(AF_INET, SOCK_DGRAM, 0);
+
+  struct sigaction sa = {};
+  sa.sa_handler = [](int) { stop = 1; };
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  std::vector<Route> routes;
+  std::vector<uint8_t> frame;
+  bool escape = false;
+  unsigned long dropped = 0;
+  printf("bridging %s <-> bulbfarm from %s\n", serialArg, farmArg);
+  fflush(stdout);
+
+  while (!stop) {
+    pollfd fds[2] = {{serial, POLLIN, 0}, {udp, POLLIN, 0}};
+    if (poll(fds, 2, 200) < 0) continue;
+
+    if (fds[0].revents & (POLLIN | POLLHUP)) {
+      uint8_t buf[2048];
+      ssize_t n = read(serial, buf, sizeof(buf));
+      if (n <= 0) break;  // QEMU exited
+      for (ssize_t i = 0; i < n; i++) {
+        uint8_t c = buf[i];
+        if (c == SLIP_END) {
+          if (frame.size() > HEADER_LEN && frame.size() <= FRAME_MAX) {
+            size_t r = 0;
+            while (r < routes.size() && memcmp(routes[r].ip, frame.data(), 4) != 0) r++;
+            if (r == routes.size()) {
+              Route route;
+              memcpy(route.ip, frame.data(), 4);
+              route.port = (uint16_t)((frame[4] << 8) | frame[5]);
+              routes.push_back(route);
+            }
+            sockaddr_in to = farmAddr;
+            to.sin_port = htons(ntohs(farmAddr.sin_port) + r);
+            sendto(udp, frame.data() + HEADER_LEN, frame.size() - HEADER_LEN, 0, (sockaddr*)&to, sizeof(to));
+            routes[r].out++;
+          } else if (!frame.empty()) {
+            dropped++;
+          }
+          frame.clear();
+          escape = false;
+        } else if (c == SLIP_ESC) {
+          escape = true;
+        } else {
+          if (escape) c = c == SLIP_ESC_END ? SLIP_END : c == SLIP_ESC_ESC ? SLIP_ESC : c;
+          escape = false;
+          frame.push_back(c);
+        }
+      }
+    }
+
+    if (fds[1].revents & POLLIN) {
+      uint8_t buf[FRAME_MAX];
+      sockaddr_in from;
+      socklen_t fromLen = sizeof(from);
+      ssize_t n = recvfrom(udp, buf + HEADER_LEN, sizeof(buf) - HEADER_LEN, 0, (sockaddr*)&from, &fromLen);
+      size_t r = ntohs(from.sin_port) - ntohs(farmAddr.sin_port);
+      if (n > 0 && r < routes.size()) {
+        memcpy(buf, routes[r].ip, 4);
+        buf[4] = (uint8_t)(routes[r].port >> 8);
+        buf[5] = (uint8_t)routes[r].port;
+        writeFrame(serial, buf, HEADER_LEN + n);
+        routes[r].in++;
+      }
+    }
+  }
+
+  printf("\n%-15s %7s %7s\n", "bulb", "to", "from");
+  for (const Route& r : routes) {
+    char ip[16];
+    snprintf(ip, sizeof(ip), "%u.%u.%u.%u", r.ip[0], r.ip[1], r.ip[2], r.ip[3]);
+    printf("%-15s %7lu %7lu\n", ip, r.out, r.in);
+  }
+  if (dropped) printf("malformed frames: %lu\n", dropped);
+  return 0;
+}
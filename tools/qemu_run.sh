@@ -0,0 +1,72 @@
+#!/bin/sh
+# Boots the esp32dev-qemu firmware under Espressif's QEMU, bridged to
+# bulbfarm, and prints the cycle-count benchmarks it runs at boot.
+#
+# Usage:  tools/qemu_run.sh [baseline.txt]
+# Needs:  PlatformIO, g++, and qemu-system-xtensa built from
+#         https://github.com/espressif/qemu (QEMU=... to point at it)
+#
+# With a baseline (the BENCH lines saved from an earlier run) the script
+# exits 1 if any case's median grew by more than BENCH_TOLERANCE percent
+# (default 10). -icount keeps the emulated cycle counter tied to executed
+# instructions, so runs are repeatable on any host.
+
+set -e
+cd "$(dirname "$0")/.."
+
+QEMU=${QEMU:-qemu-system-xtensa}
+ESPTOOL=${ESPTOOL:-"python3 $HOME/.platformio/packages/tool-esptoolpy/esptool.py"}
+BOOT_APP0=${BOOT_APP0:-$HOME/.platformio/packages/framework-arduinoespressif32/tools/partitions/boot_app0.bin}
+BENCH_TOLERANCE=${BENCH_TOLERANCE:-10}
+SERIAL_PORT=5556
+BUILD=.pio/build/esp32dev-qemu
+OUT=$BUILD/qemu
+BASELINE=$1
+
+pio run -e esp32dev-qemu
+mkdir -p "$OUT"
+$ESPTOOL --chip esp32 merge_bin --fill-flash-size 4MB -o "$OUT/flash.bin" \
+  0x1000 "$BUILD/bootloader.bin" 0x8000 "$BUILD/partitions.bin" \
+  0xe000 "$BOOT_APP0" 0x10000 "$BUILD/firmware.bin"
+
+g++ -std=c++17 -O2 -o "$OUT/bulbfarm" tools/bulbfarm.cpp
+g++ -std=c++17 -O2 -o "$OUT/qemu_bridge" tools/qemu_bridge.cpp
+
+"$OUT/bulbfarm" -n 2 --addr 127.0.0.1 --ports --report-s 3600 > "$OUT/bulbfarm.log" 2>&1 &
+FARM=$!
+# UART0 = console, UART2 = WiZ datagram tunnel
+"$QEMU" -nographic -machine esp32 -icount 3 \
+  -drive file="$OUT/flash.bin",if=mtd,format=raw \
+  -serial file:"$OUT/uart0.log" -serial null \
+  -serial tcp:127.0.0.1:$SERIAL_PORT,server=on,wait=off > "$OUT/qemu.log" 2>&1 &
+EMU=$!
+"$OUT/qemu_bridge" --serial 127.0.0.1:$SERIAL_PORT --farm 127.0.0.1:38899 > "$OUT/bridge.log" 2>&1 &
+BRIDGE=$!
+trap 'kill $EMU $BRIDGE $FARM 2>/dev/null || true' EXIT
+
+for i in $(seq 120); do
+  grep -q "^BENCH done" "$OUT/uart0.log" 2>/dev/null && break
+  sleep 1
+done
+kill -INT $BRIDGE $FARM 2>/dev/null || true
+sleep 1
+
+if ! grep -q "^BENCH done" "$OUT/uart0.log"; then
+  echo "firmware did not finish the benchmarks; console output in $OUT/uart0.log" >&2
+  exit 1
+fi
+grep "^BENCH " "$OUT/uart0.log" | grep -v "^BENCH done" > "$OUT/bench.txt"
+cat "$OUT/bench.txt"
+cat "$OUT/bridge.log"
+
+[ -n "$BASELINE" ] || exit 0
+awk -v tol="$BENCH_TOLERANCE" '
+  { split($4, m, "="); med = m[2] }
+  NR == FNR { base[$2] = med; next }
+  ($2 in base) && base[$2] > 0 {
+    change = (med - base[$2]) * 100 / base[$2]
+    flag = change > tol ? "  REGRESSION" : ""
+    printf "%-20s %8d -> %8d  %+6.1f%%%s\n", $2, base[$2], med, change, flag
+    if (flag != "") failed = 1
+  }
+  END { exit failed }' "$BASELINE" "$OUT/bench.txt"
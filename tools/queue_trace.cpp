@@ -0,0 +1,270 @@
+// Replays adversarial command traces against src/command_queue.h on the host.
+//
+// Build:  g++ -std=c++17 -O2 -I src -o queue_trace tools/queue_trace.cpp
+// Usage:  ./queue_trace [traces] [seed]
+//
+// Each trace interleaves on/off, brightness and temperature pushes with pops
+// under a random send budget and clock, and applies every popped command to a
+// model bulb with WiZ semantics (dimming or temp alone switches a bulb on).
+// Checked after every step:
+//   - a stream command never switches on a bulb whose latest pushed state is off
+//   - a stream slot is never sent while any control slot is waiting
+//   - stream slots respect the per-bulb interval
+//   - a bulb gets at most one packet per pass, counting probes: each pass
+//     pops what the inputs queued, then sends refresh and dead-bulb probes
+//     the way lightsFlush() does (PassPackets in command_queue.h)
+//   - a dead bulb due for a probe gets a packet (its command or the probe)
+// and once the queue is drained every bulb matches the last pushed state.
+// Exits non-zero on the first violation.
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "command_queue.h"
+
+namespace {
+
+const int BULBS = 4;
+const unsigned long INTERVAL_MS = 50;
+const unsigned long PROBE_INTERVAL_MS = 200;
+
+struct ModelBulb {
+  bool on = false;
+  int dimming = 50;
+  int temp = 2700;
+};
+
+struct Controller {
+  bool on = false;
+  bool stateKnown = false;  // Some on/off has been pushed
+  int dimming = 50;
+  int temp = 2700;
+  bool tempSet = false;
+};
+
+struct Trace {
+  CommandQueue<BULBS> queue;
+  ModelBulb model[BULBS];
+  Controller ctrl[BULBS];
+  bool controlPending[BULBS] = {};
+  unsigned long lastStreamPop[BULBS] = {};
+  bool streamPopped[BULBS] = {};
+  int packetsThisPass[BULBS] = {};
+  bool dead[BULBS] = {};
+  bool refreshRequested[BULBS] = {};
+  unsigned long lastProbe[BULBS] = {};
+  unsigned long now = 1000;
+  unsigned long pops = 0;
+  unsigned long probes = 0;
+};
+
+int failures = 0;
+
+void fail(unsigned long trace, unsigned long step, const char* what, int bulb) {
+  fprintf(stderr, "trace %lu step %lu bulb %d: %s\n", trace, step, bulb, what);
+  failures++;
+}
+
+void pushControl(Trace& t, int bulb, bool on) {
+  PilotCommand cmd = {};
+  cmd.fields = PILOT_STATE;
+  cmd.on = on;
+  if (on) {
+    cmd.fields |= PILOT_DIMMING;
+    cmd.dimming = (uint8_t)t.ctrl[bulb].dimming;
+    if (t.ctrl[bulb].tempSet) {
+      cmd.fields |= PILOT_TEMP;
+      cmd.temp = (uint16_t)t.ctrl[bulb].temp;
+    }
+  }
+  t.queue.push(bulb, cmd, PRIORITY_CONTROL);
+  t.ctrl[bulb].on = on;
+  t.ctrl[bulb].stateKnown = true;
+  t.controlPending[bulb] = true;
+}
+
+void pushStream(Trace& t, int bulb, int dimming, int temp) {
+  PilotCommand cmd = {};
+  cmd.fields = PILOT_DIMMING;
+  cmd.dimming = (uint8_t)dimming;
+  if (temp) {
+    cmd.fields |= PILOT_TEMP;
+    cmd.temp = (uint16_t)temp;
+  }
+  // Like the firmware, streaming only targets lights the controller has on
+  Controller& c = t.ctrl[bulb];
+  c.dimming = dimming;
+  if (temp) {
+    c.temp = temp;
+    c.tempSet = true;
+  }
+  t.queue.push(bulb, cmd, PRIORITY_STREAM);
+}
+
+bool popOne(Trace& t, PassPackets<BULBS>& pass, unsigned long trace, unsigned long step) {
+  int bulb;
+  PilotCommand cmd;
+  if (!t.queue.pop(t.now, INTERVAL_MS, &bulb, &cmd)) return false;
+  t.pops++;
+  pass.command(bulb);
+  t.packetsThisPass[bulb]++;
+
+  bool wasControl = t.controlPending[bulb];
+  for (int i = 0; i < BULBS; i++) {
+    if (!wasControl && t.controlPending[i]) fail(trace, step, "stream sent ahead of waiting control", i);
+  }
+  if (!wasControl) {
+    if (t.streamPopped[bulb] && t.now - t.lastStreamPop[bulb] < INTERVAL_MS) {
+      fail(trace, step, "stream interval violated", bulb);
+    }
+    t.streamPopped[bulb] = true;
+    t.lastStreamPop[bulb] = t.now;
+  }
+  t.controlPending[bulb] = false;
+
+  ModelBulb& m = t.model[bulb];
+  bool wasOn = m.on;
+  if (cmd.fields & PILOT_STATE) m.on = cmd.on;
+  else m.on = true;
+  if (cmd.fields & PILOT_DIMMING) m.dimming = cmd.dimming;
+  if (cmd.fields & PILOT_TEMP) m.temp = cmd.temp;
+
+  const Controller& c = t.ctrl[bulb];
+  if (!wasOn && m.on && c.stateKnown && !c.on) fail(trace, step, "stale update switched light back on", bulb);
+  if (!(cmd.fields & PILOT_STATE) && c.stateKnown && !c.on) fail(trace, step, "stream command sent to light that is off", bulb);
+  return true;
+}
+
+// End of a pass, after the pops: probes as lightsFlush() sends them, then
+// the per-pass checks
+void finishPass(Trace& t, PassPackets<BULBS>& pass, unsigned long trace, unsigned long step) {
+  bool probeDue[BULBS];
+  for (int i = 0; i < BULBS; i++) probeDue[i] = t.dead[i] && t.now - t.lastProbe[i] >= PROBE_INTERVAL_MS;
+
+  for (int i = 0; i < BULBS; i++) {
+    if (!t.refreshRequested[i]) continue;
+    t.refreshRequested[i] = false;
+    if (pass.probe(i)) {
+      t.packetsThisPass[i]++;
+      t.probes++;
+      t.lastProbe[i] = t.now;
+    }
+  }
+  for (int i = 0; i < BULBS; i++) {
+    if (!t.dead[i] || t.now - t.lastProbe[i] < PROBE_INTERVAL_MS) continue;
+    if (pass.probe(i)) {
+      t.packetsThisPass[i]++;
+      t.probes++;
+    }
+    t.lastProbe[i] = t.now;
+  }
+
+  for (int i = 0; i < BULBS; i++) {
+    if (t.packetsThisPass[i] > 1) fail(trace, step, "more than one packet (probe or command) in one pass", i);
+    if (probeDue[i] && t.packetsThisPass[i] == 0) fail(trace, step, "dead bulb due for a probe got no packet", i);
+    if (pass.packets(i) != t.packetsThisPass[i]) fail(trace, step, "PassPackets count differs from packets sent", i);
+    t.packetsThisPass[i] = 0;
+  }
+}
+
+void checkConverged(Trace& t, unsigned long trace) {
+  t.now += INTERVAL_MS * 2;
+  PassPackets<BULBS> pass;
+  while (popOne(t, pass, trace, ~0UL)) {}
+  for (int i = 0; i < BULBS; i++) t.packetsThisPass[i] = 0;  // Draining ignores the per-pass budget
+  if (t.queue.depth() != 0) fail(trace, ~0UL, "queue not drained", -1);
+
+  for (int i = 0; i < BULBS; i++) {
+    const Controller& c = t.ctrl[i];
+    const ModelBulb& m = t.model[i];
+    if (!c.stateKnown) continue;
+    if (m.on != c.on) fail(trace, ~0UL, "final on/off differs", i);
+    if (c.on && m.dimming != c.dimming) fail(trace, ~0UL, "final dimming differs", i);
+    if (c.on && c.tempSet && m.temp != c.temp) fail(trace, ~0UL, "final temp differs", i);
+  }
+}
+
+// Knob spun hard on all bulbs with a long interval, then "all off"
+void runSpinThenAllOff() {
+  Trace t;
+  for (int i = 0; i < BULBS; i++) pushControl(t, i, true);
+  PassPackets<BULBS> pass;
+  while (popOne(t, pass, 0, 0)) {}
+  for (int d = 10; d <= 100; d += 2) {
+    for (int i = 0; i < BULBS; i++) pushStream(t, i, d, 0);
+  }
+  for (int i = 0; i < BULBS; i++) pushControl(t, i, false);
+
+  int sent = 0;
+  int bulb;
+  PilotCommand cmd;
+  while (t.queue.pop(t.now, INTERVAL_MS, &bulb, &cmd)) {
+    sent++;
+    if (!(cmd.fields & PILOT_STATE) || cmd.on) fail(0, 0, "spin+off: expected only off commands", bulb);
+  }
+  if (sent != BULBS) fail(0, 0, "spin+off: expected one packet per bulb", -1);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned long traces = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+  unsigned long seed = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1;
+  std::mt19937 rng(seed);
+  const int temps[] = {2200, 2700, 4000, 6500};
+
+  runSpinThenAllOff();
+
+  unsigned long ran = 0, totalSteps = 0, totalPops = 0, totalProbes = 0;
+  for (unsigned long trace = 1; trace <= traces && failures == 0; trace++) {
+    Trace t;
+    ran++;
+    int steps = 20 + (int)(rng() % 400);
+    for (int step = 0; step < steps; step++) {
+      int bulb = (int)(rng() % BULBS);
+      // Liveness and refreshes change under the inputs
+      if (rng() % 40 == 0) t.dead[bulb] = !t.dead[bulb];
+      if (rng() % 10 == 0) t.refreshRequested[(int)(rng() % BULBS)] = true;
+      switch (rng() % 11) {
+        case 0:
+        case 1:
+          pushControl(t, bulb, rng() % 2);
+          break;
+        case 2:  // "All" toggle, like the encoder double-click
+          for (int i = 0; i < BULBS; i++) pushControl(t, i, !t.ctrl[0].on);
+          break;
+        case 3: {
+          // Stale detent computed before the light went off
+          if (t.ctrl[bulb].on) break;
+          PilotCommand stale = {};
+          stale.fields = PILOT_DIMMING;
+          stale.dimming = 100;
+          t.queue.push(bulb, stale, PRIORITY_STREAM);
+          break;
+        }
+        case 4:
+          if (t.ctrl[bulb].on) pushStream(t, bulb, 10 + (int)(rng() % 46) * 2, temps[rng() % 4]);
+          break;
+        default:
+          if (t.ctrl[bulb].on) pushStream(t, bulb, 10 + (int)(rng() % 46) * 2, 0);
+          break;
+      }
+
+      // Adversarial scheduling: sometimes let a backlog build, sometimes drain
+      t.now += rng() % 30;
+      int budget = (int)(rng() % 4);
+      PassPackets<BULBS> pass;
+      for (int i = 0; i < budget && popOne(t, pass, trace, (unsigned long)step); i++) {}
+      finishPass(t, pass, trace, (unsigned long)step);
+    }
+    checkConverged(t, trace);
+    totalSteps += (unsigned long)steps;
+    totalPops += t.pops;
+    totalProbes += t.probes;
+  }
+
+  printf("%lu traces, %lu pushes, %lu commands, %lu probes, %d violations\n", ran, totalSteps, totalPops,
+    totalProbes, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,461 @@
+// Compiles dimmer rules to the bytecode in src/rules_vm.h.
+//
+// Build:  g++ -std=c++17 -O2 -I src -o rulec tools/rulec.cpp
+// Usage:  ./rulec rules.txt                    (check and disassemble)
+//         ./rulec rules.txt -o rules.bin
+//         ./rulec rules.txt --console    (lines to type or pace into the console)
+//         ./rulec rules.txt --run click study [--at 22:30] [--on study]
+//
+// One rule per line, "#" starts a comment:
+//
+//   tz -7                                  local time = UTC - 7 h (no DST)
+//   when longpress study do brightness 30; on all; consume
+//   when click study if time >= 22:00 || time < 6:00 do temp 2200
+//   when tick if on_minutes(uplight) >= 60 do off uplight
+//
+// Events: boot, tick (every minute), click, doubleclick (encoder only) and
+// longpress, the last three optionally followed by study, uplight or
+// encoder. Conditions compare numbers, times (hh:mm) and hour, minute,
+// time, weekday (0 = Sunday), clock, brightness, temp, on(bulb) and
+// on_minutes(bulb) with == != < <= > >= && || ! and parentheses. Actions:
+// on/off/toggle <study|uplight|all>, brightness <10-100>, temp <2200-6500>, and
+// consume (skip the button's built-in action). All rules matching an event
+// run, in file order.
+//
+// --console prints "rules add <hex>" lines followed by "rules save".
+// --run interprets the program on the host for one event and prints the
+// actions it would take.
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "rules_vm.h"
+
+namespace {
+
+const size_t CONSOLE_CHUNK_BYTES = 26;  // "rules add " + hex fits the 64-char console line
+
+struct Named {
+  const char* name;
+  uint8_t value;
+};
+
+const Named EVENTS[] = {
+  {"boot", RULE_EVENT_BOOT}, {"tick", RULE_EVENT_TICK}, {"click", RULE_EVENT_CLICK},
+  {"doubleclick", RULE_EVENT_DOUBLE_CLICK}, {"longpress", RULE_EVENT_LONG_PRESS},
+};
+const Named BUTTONS[] = {
+  {"study", RULE_BUTTON_STUDY}, {"uplight", RULE_BUTTON_UPLIGHT}, {"encoder", RULE_BUTTON_ENCODER},
+};
+const Named BULBS[] = {{"study", 0}, {"uplight", 1}, {"all", RULE_ALL_BULBS}};
+const Named VARS[] = {
+  {"hour", RULE_VAR_HOUR}, {"minute", RULE_VAR_MINUTE}, {"time", RULE_VAR_TIME},
+  {"weekday", RULE_VAR_WEEKDAY}, {"clock", RULE_VAR_CLOCK}, {"brightness", RULE_VAR_BRIGHTNESS},
+  {"temp", RULE_VAR_TEMP}, {"on", RULE_VAR_ON}, {"on_minutes", RULE_VAR_ON_MINUTES},
+};
+const Named COMPARISONS[] = {
+  {"==", RULE_OP_EQ}, {"!=", RULE_OP_NE}, {"<=", RULE_OP_LE}, {">=", RULE_OP_GE},
+  {"<", RULE_OP_LT}, {">", RULE_OP_GT},
+};
+const char* const OP_NAMES[] = {
+  "end", "push", "var", "eq", "ne", "lt", "le", "gt", "ge", "and", "or", "not",
+  "jump_if_false", "power", "toggle", "brightness", "temp", "consume",
+};
+
+template <size_t N>
+bool lookup(const Named (&table)[N], const std::string& name, uint8_t* value) {
+  for (const Named& n : table) {
+    if (name == n.name) {
+      *value = n.value;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <size_t N>
+const char* nameOf(const Named (&table)[N], uint8_t value) {
+  for (const Named& n : table) {
+    if (n.value == value) return n.name;
+  }
+  return "?";
+}
+
+struct CompileError {
+  std::string message;
+};
+
+class Parser {
+ public:
+  explicit Parser(const std::string& line) { tokenize(line); }
+
+  bool done() const { return pos_ >= tokens_.size(); }
+  const std::string& peek() const {
+    static const std::string end;
+    return done() ? end : tokens_[pos_];
+  }
+  std::string next() {
+    if (done()) throw CompileError{"unexpected end of line"};
+    return tokens_[pos_++];
+  }
+  bool accept(const char* token) {
+    if (peek() != token) return false;
+    pos_++;
+    return true;
+  }
+  void expect(const char* token) {
+    if (!accept(token)) throw CompileError{std::string("expected '") + token + "' before '" + peek() + "'"};
+  }
+
+  int number() {
+    std::string t = next();
+    char* end;
+    long v = strtol(t.c_str(), &end, 10);
+    if (*end == ':') {  // hh:mm as minutes since midnight
+      char* mEnd;
+      long m = strtol(end + 1, &mEnd, 10);
+      if (*mEnd || v < 0 || v > 23 || m < 0 || m > 59) throw CompileError{"bad time '" + t + "'"};
+      return (int)(v * 60 + m);
+    }
+    if (end == t.c_str() || *end) throw CompileError{"expected a number, got '" + t + "'"};
+    if (v < INT16_MIN || v > INT16_MAX) throw CompileError{"number out of range: " + t};
+    return (int)v;
+  }
+
+  uint8_t bulb() {
+    uint8_t b;
+    std::string t = next();
+    if (!lookup(BULBS, t, &b)) throw CompileError{"unknown light '" + t + "'"};
+    return b;
+  }
+
+  // Expressions, lowest precedence first
+  void orExpr(std::vector<uint8_t>& out) {
+    andExpr(out);
+    while (accept("||") || accept("or")) {
+      andExpr(out);
+      out.push_back(RULE_OP_OR);
+    }
+  }
+
+  void andExpr(std::vector<uint8_t>& out) {
+    notExpr(out);
+    while (accept("&&") || accept("and")) {
+      notExpr(out);
+      out.push_back(RULE_OP_AND);
+    }
+  }
+
+  void notExpr(std::vector<uint8_t>& out) {
+    if (accept("!") || accept("not")) {
+      notExpr(out);
+      out.push_back(RULE_OP_NOT);
+      return;
+    }
+    primary(out);
+    uint8_t op;
+    if (lookup(COMPARISONS, peek(), &op)) {
+      next();
+      primary(out);
+      out.push_back(op);
+    }
+  }
+
+  void primary(std::vector<uint8_t>& out) {
+    if (accept("(")) {
+      orExpr(out);
+      expect(")");
+      return;
+    }
+    uint8_t var;
+    if (lookup(VARS, peek(), &var)) {
+      next();
+      uint8_t b = 0;
+      if (var == RULE_VAR_ON || var == RULE_VAR_ON_MINUTES) {
+        expect("(");
+        b = bulb();
+        expect(")");
+      }
+      out.insert(out.end(), {RULE_OP_VAR, var, b});
+      return;
+    }
+    push(out, number());
+  }
+
+  static void push(std::vector<uint8_t>& out, int v) {
+    out.insert(out.end(), {RULE_OP_PUSH, (uint8_t)v, (uint8_t)((unsigned)v >> 8)});
+  }
+
+  void action(std::vector<uint8_t>& out) {
+    std::string t = next();
+    if (t == "on" || t == "off") {
+      push(out, t == "on");
+      out.insert(out.end(), {RULE_OP_POWER, bulb()});
+    } else if (t == "toggle") {
+      out.insert(out.end(), {RULE_OP_TOGGLE, bulb()});
+    } else if (t == "brightness") {
+      push(out, number());
+      out.push_back(RULE_OP_BRIGHTNESS);
+    } else if (t == "temp") {
+      int kelvin = number();
+      if (kelvin < RULE_TEMP_MIN || kelvin > RULE_TEMP_MAX) {
+        throw CompileError{"temp must be " + std::to_string(RULE_TEMP_MIN) + " to " +
+          std::to_string(RULE_TEMP_MAX) + " K"};
+      }
+      push(out, kelvin);
+      out.push_back(RULE_OP_TEMP);
+    } else if (t == "consume") {
+      out.push_back(RULE_OP_CONSUME);
+    } else {
+      throw CompileError{"unknown action '" + t + "'"};
+    }
+  }
+
+ private:
+  void tokenize(const std::string& line) {
+    size_t i = 0;
+    while (i < line.size()) {
+      char c = line[i];
+      if (c == '#') break;
+      if (isspace((unsigned char)c)) {
+        i++;
+      } else if (isalnum((unsigned char)c) || c == '_' || c == '-' || c == ':') {
+        size_t start = i;
+        while (i < line.size() && (isalnum((unsigned char)line[i]) || strchr("_-:", line[i]))) i++;
+        tokens_.push_back(line.substr(start, i - start));
+      } else if (i + 1 < line.size() && strchr("=!<>&|", c) && strchr("=&|", line[i + 1])) {
+        tokens_.push_back(line.substr(i, 2));
+        i += 2;
+      } else {
+        tokens_.push_back(std::string(1, c));
+        i++;
+      }
+    }
+  }
+
+  std::vector<std::string> tokens_;
+  size_t pos_ = 0;
+};
+
+struct Program {
+  int tzMinutes = 0;
+  std::vector<std::vector<uint8_t>> rules;  // event, arg, code length, code
+
+  std::vector<uint8_t> bytes() const {
+    std::vector<uint8_t> out = {(uint8_t)RULES_MAGIC, (uint8_t)(RULES_MAGIC >> 8),
+      (uint8_t)(RULES_MAGIC >> 16), (uint8_t)(RULES_MAGIC >> 24),
+      (uint8_t)tzMinutes, (uint8_t)((unsigned)tzMinutes >> 8), (uint8_t)rules.size()};
+    for (const auto& r : rules) out.insert(out.end(), r.begin(), r.end());
+    return out;
+  }
+};
+
+void compileLine(const std::string& line, Program* program) {
+  Parser p(line);
+  if (p.done()) return;
+  std::string keyword = p.next();
+  if (keyword == "tz") {
+    int hours = p.number();
+    if (hours < -14 || hours > 14) throw CompileError{"tz must be -14 to 14 hours"};
+    program->tzMinutes = hours * 60;
+    if (!p.done()) throw CompileError{"unexpected '" + p.peek() + "'"};
+    return;
+  }
+  if (keyword != "when") throw CompileError{"expected 'when' or 'tz'"};
+
+  uint8_t event, arg = RULE_ANY;
+  std::string e = p.next();
+  if (!lookup(EVENTS, e, &event)) throw CompileError{"unknown event '" + e + "'"};
+  if (lookup(BUTTONS, p.peek(), &arg)) {
+    if (event == RULE_EVENT_BOOT || event == RULE_EVENT_TICK) throw CompileError{e + " takes no button"};
+    p.next();
+  }
+
+  std::vector<uint8_t> condition, actions;
+  if (p.accept("if")) p.orExpr(condition);
+  p.expect("do");
+  p.action(actions);
+  while (p.accept(";")) {
+    if (!p.done()) p.action(actions);
+  }
+  if (!p.done()) throw CompileError{"unexpected '" + p.peek() + "'"};
+
+  std::vector<uint8_t> code = condition;
+  if (!condition.empty()) {
+    if (actions.size() > 255) throw CompileError{"too many actions"};
+    code.insert(code.end(), {RULE_OP_JUMP_IF_FALSE, (uint8_t)actions.size()});
+  }
+  code.insert(code.end(), actions.begin(), actions.end());
+  if (code.size() > 255) throw CompileError{"rule too long (" + std::to_string(code.size()) + " bytes)"};
+
+  std::vector<uint8_t> rule = {event, arg, (uint8_t)code.size()};
+  rule.insert(rule.end(), code.begin(), code.end());
+  program->rules.push_back(rule);
+}
+
+void disassemble(const std::vector<uint8_t>& bytes) {
+  printf("tz %+d min, %u rules, %zu bytes\n", rulesTzMinutes(bytes.data()), bytes[6], bytes.size());
+  size_t at = RULES_HEADER_LEN;
+  for (int r = 0; r < bytes[6]; r++) {
+    uint8_t event = bytes[at], arg = bytes[at + 1], len = bytes[at + 2];
+    printf("rule %d: %s %s (%u bytes)\n", r, nameOf(EVENTS, event),
+      arg == RULE_ANY ? "" : nameOf(BUTTONS, arg), len);
+    const uint8_t* code = &bytes[at + 3];
+    for (size_t pc = 0; pc < len;) {
+      uint8_t op = code[pc];
+      printf("  %3zu  %-13s", pc, OP_NAMES[op]);
+      if (op == RULE_OP_PUSH) printf(" %d", (int16_t)(code[pc + 1] | code[pc + 2] << 8));
+      if (op == RULE_OP_VAR) {
+        uint8_t var = code[pc + 1];
+        printf(" %s", nameOf(VARS, var));
+        if (var == RULE_VAR_ON || var == RULE_VAR_ON_MINUTES) printf("(%s)", nameOf(BULBS, code[pc + 2]));
+      }
+      if (op == RULE_OP_JUMP_IF_FALSE) printf(" -> %zu", pc + 2 + code[pc + 1]);
+      if (op == RULE_OP_POWER || op == RULE_OP_TOGGLE) printf(" %s", nameOf(BULBS, code[pc + 1]));
+      printf("\n");
+      pc += 1 + ruleOperandBytes(op);
+    }
+    at += 3 + len;
+  }
+}
+
+// Host stand-in for the controller, for --run
+struct TraceEnv {
+  int32_t vars[RULE_VAR_COUNT] = {-1, -1, -1, -1, 0, 50, 2700, 0, 0};
+  bool on[2] = {false, false};
+
+  int32_t var(RuleVar v, uint8_t bulb) {
+    if (v == RULE_VAR_ON) return bulb == RULE_ALL_BULBS ? on[0] || on[1] : bulb < 2 && on[bulb];
+    if (v == RULE_VAR_ON_MINUTES) return bulb < 2 && on[bulb] ? vars[v] : 0;
+    return vars[v];
+  }
+
+  void action(RuleOp op, uint8_t bulb, int32_t value) {
+    if (op == RULE_OP_POWER || op == RULE_OP_TOGGLE) {
+      for (int i = 0; i < 2; i++) {
+        if (bulb == RULE_ALL_BULBS || bulb == i) on[i] = op == RULE_OP_POWER ? value != 0 : !on[i];
+      }
+      printf("  %s %s\n", op == RULE_OP_POWER ? (value ? "on" : "off") : "toggle", nameOf(BULBS, bulb));
+    } else {
+      printf("  %s %d\n", OP_NAMES[op], value);
+    }
+  }
+};
+
+int runEvent(const std::vector<uint8_t>& bytes, int argc, char** argv, int i) {
+  uint8_t event, arg = 0;
+  if (i >= argc || !lookup(EVENTS, argv[i], &event)) {
+    fprintf(stderr, "--run needs an event\n");
+    return 2;
+  }
+  i++;
+  if (i < argc && lookup(BUTTONS, argv[i], &arg)) i++;
+
+  TraceEnv env;
+  for (; i < argc; i++) {
+    if (strcmp(argv[i], "--at") == 0 && i + 1 < argc) {
+      int h = 0, m = 0, wd = 1;
+      if (sscanf(argv[++i], "%d:%d", &h, &m) != 2) return 2;
+      if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) wd = atoi(argv[++i]);
+      env.vars[RULE_VAR_HOUR] = h;
+      env.vars[RULE_VAR_MINUTE] = m;
+      env.vars[RULE_VAR_TIME] = h * 60 + m;
+      env.vars[RULE_VAR_WEEKDAY] = wd;
+      env.vars[RULE_VAR_CLOCK] = 1;
+    } else if (strcmp(argv[i], "--on") == 0 && i + 1 < argc) {
+      uint8_t b;
+      if (!lookup(BULBS, argv[++i], &b)) return 2;
+      for (int k = 0; k < 2; k++) env.on[k] = env.on[k] || b == RULE_ALL_BULBS || b == k;
+    } else if (strcmp(argv[i], "--on-minutes") == 0 && i + 1 < argc) {
+      env.vars[RULE_VAR_ON_MINUTES] = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--brightness") == 0 && i + 1 < argc) {
+      env.vars[RULE_VAR_BRIGHTNESS] = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "unknown --run option %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  bool button = event != RULE_EVENT_BOOT && event != RULE_EVENT_TICK;
+  printf("%s %s:\n", nameOf(EVENTS, event), button ? nameOf(BUTTONS, arg) : "");
+  uint8_t result = rulesRun(bytes.data(), bytes.size(), event, arg, env);
+  printf("  -> %s%s\n", result & RULE_RESULT_CONSUMED ? "consumed" : "built-in action runs",
+    result & RULE_RESULT_FAULT ? " (stack fault)" : "");
+
+  // Interpreter cost on this host, for scale
+  auto start = std::chrono::steady_clock::now();
+  const int reps = 100000;
+  volatile uint8_t sink = 0;
+  struct { int32_t var(RuleVar v, uint8_t) { return v; } void action(RuleOp, uint8_t, int32_t) {} } nullEnv;
+  for (int k = 0; k < reps; k++) sink = sink + rulesRun(bytes.data(), bytes.size(), event, arg, nullEnv);
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / reps;
+  printf("  %.0f ns per event on this host\n", ns);
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argv[1][0] == '-') {
+    fprintf(stderr, "usage: %s rules.txt [-o rules.bin | --console | --run event [button] [options]]\n", argv[0]);
+    return 2;
+  }
+  FILE* f = fopen(argv[1], "r");
+  if (!f) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  Program program;
+  char line[512];
+  int lineNo = 0, errors = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lineNo++;
+    try {
+      compileLine(line, &program);
+    } catch (const CompileError& e) {
+      fprintf(stderr, "%s:%d: %s\n", argv[1], lineNo, e.message.c_str());
+      errors++;
+    }
+  }
+  fclose(f);
+  if (errors) return 1;
+  if (program.rules.size() > 255) {
+    fprintf(stderr, "too many rules\n");
+    return 1;
+  }
+
+  std::vector<uint8_t> bytes = program.bytes();
+  if (rulesValidate(bytes.data(), bytes.size()) < 0) {
+    fprintf(stderr, "program is %zu bytes; the dimmer takes at most %zu\n", bytes.size(), RULES_MAX_BYTES);
+    return 1;
+  }
+
+  if (argc >= 4 && strcmp(argv[2], "-o") == 0) {
+    FILE* out = fopen(argv[3], "wb");
+    if (!out || fwrite(bytes.data(), 1, bytes.size(), out) != bytes.size()) {
+      perror(argv[3]);
+      return 1;
+    }
+    fclose(out);
+    printf("%zu rules, %zu bytes -> %s\n", program.rules.size(), bytes.size(), argv[3]);
+  } else if (argc >= 3 && strcmp(argv[2], "--console") == 0) {
+    printf("rules discard\n");
+    for (size_t i = 0; i < bytes.size(); i += CONSOLE_CHUNK_BYTES) {
+      printf("rules add ");
+      for (size_t k = i; k < bytes.size() && k < i + CONSOLE_CHUNK_BYTES; k++) printf("%02x", bytes[k]);
+      printf("\n");
+    }
+    printf("rules save\n");
+  } else if (argc >= 3 && strcmp(argv[2], "--run") == 0) {
+    return runEvent(bytes, argc, argv, 3);
+  } else {
+    disassemble(bytes);
+  }
+  return 0;
+}
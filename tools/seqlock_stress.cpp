@@ -0,0 +1,134 @@
+// Checks the controller snapshot seqlock (src/seqlock.h) under contention
+// and compares it with the obvious mutex-protected copy.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src -o seqlock_stress tools/seqlock_stress.cpp
+// Usage:  ./seqlock_stress [readers] [seconds]   (default 3 readers, 2 s)
+//
+// One writer publishes snapshots whose fields are all derived from the
+// version, as fast as it can; the readers copy them and check every field
+// against the version they got. Any torn copy is counted and fails the run.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "seqlock.h"
+
+namespace {
+
+// Same layout as ControllerSnapshot in dimmer.h
+struct Snapshot {
+  uint32_t version;
+  uint32_t changedAtMs;
+  int32_t brightness;
+  int32_t colorTemp;
+  uint8_t colorTempMode;
+  uint8_t powerMask;
+  uint8_t aliveMask;
+  uint8_t reserved;
+};
+
+Snapshot make(uint32_t v) {
+  Snapshot s;
+  s.version = v;
+  s.changedAtMs = v * 7;
+  s.brightness = (int32_t)(v % 101);
+  s.colorTemp = (int32_t)(2200 + v % 4300);
+  s.colorTempMode = (uint8_t)(v % 3);
+  s.powerMask = (uint8_t)(v & 3);
+  s.aliveMask = (uint8_t)(~v & 3);
+  s.reserved = (uint8_t)(v >> 24);
+  return s;
+}
+
+bool consistent(const Snapshot& s) {
+  Snapshot want = make(s.version);
+  return s.changedAtMs == want.changedAtMs && s.brightness == want.brightness &&
+    s.colorTemp == want.colorTemp && s.colorTempMode == want.colorTempMode &&
+    s.powerMask == want.powerMask && s.aliveMask == want.aliveMask && s.reserved == want.reserved;
+}
+
+struct Result {
+  uint64_t writes = 0;
+  uint64_t reads = 0;
+  uint64_t retries = 0;
+  uint64_t torn = 0;
+  double seconds = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Write, typename Read>
+Result run(int readers, double seconds, Write write, Read read) {
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> reads(0), retries(0), torn(0);
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; r++) {
+    threads.emplace_back([&] {
+      uint64_t n = 0, retry = 0, bad = 0;
+      Snapshot s;
+      while (!stop.load(std::memory_order_relaxed)) {
+        retry += read(&s);
+        if (!consistent(s)) bad++;
+        n++;
+      }
+      reads += n;
+      retries += retry;
+      torn += bad;
+    });
+  }
+
+  Result result;
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+  uint32_t v = 1;
+  while (Clock::now() < end) {
+    for (int i = 0; i < 1024; i++) write(make(v++));
+  }
+  result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  stop = true;
+  for (std::thread& t : threads) t.join();
+  result.writes = v - 1;
+  result.reads = reads;
+  result.retries = retries;
+  result.torn = torn;
+  return result;
+}
+
+void print(const char* name, const Result& r) {
+  printf("%-8s %6.1f ns/write  %6.1f M reads/s  retries %.4f%%  torn %llu\n",
+    name, r.seconds * 1e9 / r.writes, r.reads / r.seconds / 1e6,
+    r.reads ? 100.0 * r.retries / r.reads : 0.0, (unsigned long long)r.torn);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int readers = argc > 1 ? atoi(argv[1]) : 3;
+  double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+  if (readers < 1 || seconds <= 0) {
+    fprintf(stderr, "Usage: %s [readers] [seconds]\n", argv[0]);
+    return 2;
+  }
+
+  static Seqlock<Snapshot> lock;
+  lock.write(make(0));
+  Result seq = run(readers, seconds,
+    [](const Snapshot& s) { lock.write(s); },
+    [](Snapshot* out) { return lock.read(out); });
+
+  static std::mutex mutex;
+  static Snapshot shared = make(0);
+  Result mtx = run(readers, seconds,
+    [](const Snapshot& s) { std::lock_guard<std::mutex> guard(mutex); shared = s; },
+    [](Snapshot* out) { std::lock_guard<std::mutex> guard(mutex); *out = shared; return 0u; });
+
+  printf("%d readers, writer flat out (the firmware publishes at most once per loop pass)\n", readers);
+  print("seqlock", seq);
+  print("mutex", mtx);
+  return seq.torn || mtx.torn ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+// Checks the scheduler's timer wheel (src/timer_wheel.h) against a plain
+// list of deadlines and measures its operations.
+//
+// Build:  g++ -std=c++17 -O2 -I src -o timer_bench tools/timer_bench.cpp
+// Usage:  ./timer_bench [steps] [seed]   (default 2000000, 1)
+//
+// The check starts, restarts and stops random timers (1 ms to 6 h, one-shot
+// and periodic, some from inside callbacks) while time moves in random
+// jumps, including across the 32-bit millis() wrap. After every advance()
+// each timer must have run exactly when the reference says it was due, and
+// nextExpiry() must match the reference's earliest deadline.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "timer_wheel.h"
+
+namespace {
+
+const int TIMERS = 64;
+
+struct Reference {
+  bool active = false;
+  uint32_t expires = 0;
+  uint32_t period = 0;
+};
+
+TimerWheel* wheel;
+WheelTimer* timers[TIMERS];
+Reference ref[TIMERS];
+std::vector<int> fired;
+std::vector<bool> restarted(TIMERS);
+std::mt19937 rng;
+uint32_t clockNow;
+uint64_t restartsFromCallback = 0;
+
+void onFire(void* ctx) {
+  int id = (int)(intptr_t)ctx;
+  fired.push_back(id);
+  // Now and then restart another timer from inside the callback
+  if (rng() % 8 == 0) {
+    int other = (int)(rng() % TIMERS);
+    uint32_t delay = 1 + rng() % 5000;
+    wheel->start(timers[other], clockNow, delay);
+    ref[other] = {true, clockNow + delay, 0};
+    restarted[other] = true;
+    restartsFromCallback++;
+  }
+}
+
+uint32_t randomDelay() {
+  switch (rng() % 4) {
+    case 0: return 1 + rng() % 64;
+    case 1: return 1 + rng() % 5000;
+    case 2: return 1 + rng() % 600000;
+    default: return 1 + rng() % (6 * 3600000);
+  }
+}
+
+bool check(uint64_t steps) {
+  TimerWheel w(0xFFFF0000u);  // Wraps a minute in
+  wheel = &w;
+  clockNow = 0xFFFF0000u;
+  for (int i = 0; i < TIMERS; i++) timers[i] = new WheelTimer(onFire, (void*)(intptr_t)i);
+
+  uint64_t firedTotal = 0;
+  for (uint64_t step = 0; step < steps; step++) {
+    int id = (int)(rng() % TIMERS);
+    switch (rng() % 5) {
+      case 0:
+      case 1: {
+        uint32_t delay = randomDelay();
+        uint32_t period = rng() % 4 == 0 ? randomDelay() : 0;
+        w.start(timers[id], clockNow, delay, period);
+        ref[id] = {true, clockNow + delay, period};
+        break;
+      }
+      case 2:
+        w.stop(timers[id]);
+        ref[id].active = false;
+        break;
+      default: {
+        uint32_t jump = rng() % 3 == 0 ? rng() % 200000 : rng() % 100;
+        uint32_t target = clockNow + jump;
+        std::vector<bool> due(TIMERS);
+        for (int i = 0; i < TIMERS; i++) due[i] = ref[i].active && (int32_t)(ref[i].expires - target) <= 0;
+
+        fired.clear();
+        restarted.assign(TIMERS, false);
+        clockNow = target;
+        uint32_t ran = w.advance(target);
+        firedTotal += ran;
+        if (ran != fired.size()) {
+          printf("step %llu: advance() returned %u, %zu callbacks\n", (unsigned long long)step, ran, fired.size());
+          return false;
+        }
+
+        // Everything due ran, nothing else did. A timer restarted by a
+        // callback may legitimately have been pulled out before its turn.
+        std::vector<int> count(TIMERS, 0);
+        for (int f : fired) count[f]++;
+        for (int i = 0; i < TIMERS; i++) {
+          if (restarted[i]) continue;
+          if (due[i] != (count[i] > 0)) {
+            printf("step %llu: timer %d due %d at %u, ran %d times by %u\n", (unsigned long long)step,
+              i, (int)due[i], ref[i].expires, count[i], target);
+            return false;
+          }
+          if (!due[i]) continue;
+          // One-shots stop; periodics are next due after now
+          if (ref[i].period) {
+            if (!timers[i]->active() || (int32_t)(timers[i]->expires - target) <= 0) {
+              printf("step %llu: periodic timer %d not rescheduled past %u\n", (unsigned long long)step, i, target);
+              return false;
+            }
+            ref[i].expires = timers[i]->expires;
+          } else {
+            ref[i].active = false;
+          }
+        }
+        break;
+      }
+    }
+
+    uint32_t at = 0;
+    bool any = w.nextExpiry(&at);
+    bool refAny = false;
+    uint32_t refAt = 0;
+    for (int i = 0; i < TIMERS; i++) {
+      if (!ref[i].active) continue;
+      if (!refAny || (int32_t)(ref[i].expires - refAt) < 0) refAt = ref[i].expires;
+      refAny = true;
+    }
+    if (any != refAny || (any && at != refAt)) {
+      printf("step %llu: nextExpiry %d/%u, reference %d/%u\n", (unsigned long long)step, any, at, refAny, refAt);
+      return false;
+    }
+  }
+  printf("check: %llu steps, %llu timer runs, %llu restarts from callbacks, OK\n",
+    (unsigned long long)steps, (unsigned long long)firedTotal, (unsigned long long)restartsFromCallback);
+  for (int i = 0; i < TIMERS; i++) delete timers[i];
+  return true;
+}
+
+void noop(void*) {}
+
+using Clock = std::chrono::steady_clock;
+
+double nsSince(Clock::time_point start, uint64_t ops) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops;
+}
+
+void bench() {
+  static TimerWheel w;
+  static std::vector<WheelTimer> many(1024, WheelTimer(noop));
+  const uint64_t OPS = 4000000;
+
+  Clock::time_point start = Clock::now();
+  for (uint64_t i = 0; i < OPS; i++) w.start(&many[i & 1023], 0, 1 + (uint32_t)(i * 7919 % 600000));
+  double restartNs = nsSince(start, OPS);
+
+  start = Clock::now();
+  for (uint64_t i = 0; i < OPS; i++) {
+    w.stop(&many[i & 1023]);
+    w.start(&many[i & 1023], 0, 1 + (uint32_t)(i * 7919 % 600000));
+  }
+  double stopStartNs = nsSince(start, OPS);
+
+  uint32_t at = 0;
+  volatile uint32_t sink = 0;
+  start = Clock::now();
+  for (uint64_t i = 0; i < OPS / 100; i++) {
+    w.nextExpiry(&at);
+    sink = sink + at;
+  }
+  double nextNs = nsSince(start, OPS / 100);
+
+  // A minute of idle time with 1024 timers spread over 10 minutes
+  start = Clock::now();
+  uint32_t ran = w.advance(60000);
+  double minuteUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+  // Same idle minute with one timer, as the loop sees it between heap reports
+  static TimerWheel idle;
+  static WheelTimer one(noop);
+  idle.start(&one, 0, 60000);
+  start = Clock::now();
+  idle.advance(59999);
+  double idleUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+  // nextExpiry() as the loop calls it every pass, with a handful of timers
+  static WheelTimer few[8] = {WheelTimer(noop), WheelTimer(noop), WheelTimer(noop), WheelTimer(noop),
+    WheelTimer(noop), WheelTimer(noop), WheelTimer(noop), WheelTimer(noop)};
+  static const uint32_t FEW_DELAYS[8] = {10, 50, 1000, 2000, 5000, 60000, 900000, 3600000};
+  for (int i = 0; i < 8; i++) idle.start(&few[i], 59999, FEW_DELAYS[i]);
+  start = Clock::now();
+  for (uint64_t i = 0; i < OPS; i++) {
+    idle.nextExpiry(&at);
+    sink = sink + at;
+  }
+  double fewNs = nsSince(start, OPS);
+
+  printf("bench: nextExpiry %.1f ns (8 timers)\n", fewNs);
+  printf("bench: restart %.1f ns  stop+start %.1f ns  nextExpiry %.1f ns (1024 timers)\n",
+    restartNs, stopStartNs, nextNs);
+  printf("bench: advance 60 s with 1024 timers %.1f us (%u ran), idle 60 s with 1 timer %.1f us\n",
+    minuteUs, ran, idleUs);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint64_t steps = argc > 1 ? strtoull(argv[1], NULL, 10) : 2000000;
+  rng.seed(argc > 2 ? (unsigned)atoi(argv[2]) : 1);
+  if (!check(steps)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  bench();
+  return 0;
+}
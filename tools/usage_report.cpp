@@ -0,0 +1,348 @@
+// Summarizes the dimmer's usage history from a dump of the "usage" partition.
+//
+// Build:  g++ -std=c++17 -O2 -I src -o usage_report tools/usage_report.cpp
+// Dump:   esptool.py read_flash 0x290000 0x160000 usage.bin
+// Usage:  ./usage_report usage.bin [--tz hours]
+//         ./usage_report --synth days usage.bin   (write a simulated image)
+//
+// The image is mmap'd and decoded in place. Reported: on-hours per bulb,
+// time-weighted brightness and color temperature distribution, and on-hours
+// by hour of day (once the dimmer has had NTP time).
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "usage_codec.h"
+
+namespace {
+
+const char* const BULB_NAMES[] = {"Study Lamp", "Uplight"};
+const uint32_t IMAGE_SIZE = 0x160000;  // Matches partitions.csv
+
+struct State {
+  uint8_t mask = 0;
+  int dimming = 50;
+  int temp = 0;
+};
+
+struct Report {
+  double onSeconds[USAGE_MAX_BULBS] = {};
+  double dimmingSeconds[11] = {};  // 0-9%, 10-19%, ... 100%
+  double tempSeconds[100] = {};    // By temp / 100
+  double hourSeconds[24] = {};
+  double coveredSeconds = 0;
+  uint32_t firstTime = 0;
+  uint32_t lastTime = 0;
+  unsigned long records = 0;
+  unsigned long sectors = 0;
+  unsigned long boots = 0;
+};
+
+// Credit [t0, t1) to the state that was in effect
+void credit(Report& r, const State& s, double t0, double t1, bool absolute, int tzSeconds) {
+  if (t1 <= t0) return;
+  double dt = t1 - t0;
+  r.coveredSeconds += dt;
+  if (!s.mask) return;
+
+  for (int b = 0; b < USAGE_MAX_BULBS; b++) {
+    if (s.mask & (1 << b)) r.onSeconds[b] += dt;
+  }
+  r.dimmingSeconds[std::min(std::max(s.dimming, 0), 100) / 10] += dt;
+  if (s.temp > 0 && s.temp / 100 < 100) r.tempSeconds[s.temp / 100] += dt;
+
+  if (!absolute) return;
+  double t = t0;
+  while (t < t1) {
+    double local = t + tzSeconds;
+    double hourEnd = (double)((long long)(local / 3600) + 1) * 3600 - tzSeconds;
+    double end = std::min(hourEnd, t1);
+    r.hourSeconds[(long long)(local / 3600) % 24] += end - t;
+    t = end;
+  }
+}
+
+void decode(const uint8_t* image, size_t size, int tzSeconds, Report& r) {
+  struct SectorRef {
+    uint32_t seq;
+    const uint8_t* p;
+  };
+  std::vector<SectorRef> sectors;
+  for (size_t off = 0; off + USAGE_SECTOR_SIZE <= size; off += USAGE_SECTOR_SIZE) {
+    UsageSectorHeader h;
+    memcpy(&h, image + off, sizeof(h));
+    if (h.magic == USAGE_MAGIC) sectors.push_back({h.seq, image + off});
+  }
+  std::sort(sectors.begin(), sectors.end(),
+    [](const SectorRef& a, const SectorRef& b) { return (int32_t)(a.seq - b.seq) < 0; });
+  r.sectors = sectors.size();
+
+  State state;
+  double t = 0;           // Seconds; unix time when absolute
+  bool absolute = false;
+  bool haveState = false;
+
+  for (const SectorRef& sector : sectors) {
+    UsageSectorHeader h;
+    memcpy(&h, sector.p, sizeof(h));
+    if (h.unixTime) {
+      if (haveState && absolute) credit(r, state, t, h.unixTime, absolute, tzSeconds);
+      t = h.unixTime;
+      absolute = true;
+    }
+
+    size_t off = sizeof(h);
+    size_t len;
+    while ((len = usageRecordLength(sector.p + off, USAGE_SECTOR_SIZE - off)) > 0) {
+      const uint8_t* p = sector.p + off;
+      off += len;
+      r.records++;
+
+      uint32_t head = 0, v = 0;
+      size_t n = logGetVarint(p, len, &head);
+      double next = t + (head >> 3);
+      UsageKind kind = (UsageKind)(head & 7);
+      if (kind == USAGE_BOOT || kind == USAGE_TIME) {
+        logGetVarint(p + n, len - n, &v);
+        if (kind == USAGE_BOOT) r.boots++;
+        // Nothing is known about the gap before a boot or clock jump
+        if (kind == USAGE_TIME || !v) {
+          if (haveState) credit(r, state, t, next, absolute, tzSeconds);
+        }
+        if (v) {
+          t = v;
+          absolute = true;
+        } else {
+          t = next;
+          if (kind == USAGE_BOOT) absolute = false;
+        }
+        if (absolute) {
+          if (!r.firstTime) r.firstTime = (uint32_t)t;
+          r.lastTime = (uint32_t)t;
+        }
+        continue;
+      }
+
+      if (haveState) credit(r, state, t, next, absolute, tzSeconds);
+      t = next;
+      if (absolute) {
+        if (!r.firstTime) r.firstTime = (uint32_t)t;
+        r.lastTime = (uint32_t)t;
+      }
+
+      switch (kind) {
+        case USAGE_POWER:
+          state.mask = p[n];
+          break;
+        case USAGE_DIMMING:
+          logGetVarint(p + n, len - n, &v);
+          state.dimming += usageUnzigzag(v);
+          break;
+        case USAGE_TEMP:
+          logGetVarint(p + n, len - n, &v);
+          state.temp = (int)v * 100;
+          break;
+        case USAGE_SNAPSHOT: {
+          state.mask = p[n++];
+          n += logGetVarint(p + n, len - n, &v);
+          state.dimming = (int)v;
+          logGetVarint(p + n, len - n, &v);
+          state.temp = (int)v * 100;
+          break;
+        }
+        default:
+          break;
+      }
+      haveState = true;
+    }
+  }
+}
+
+void printReport(const Report& r, double decodeMs, size_t imageSize) {
+  printf("Image: %zu KB, %lu sectors, %lu records, %lu boots (decoded in %.2f ms)\n",
+    imageSize / 1024, r.sectors, r.records, r.boots, decodeMs);
+  if (r.firstTime) {
+    char from[32], to[32];
+    time_t a = r.firstTime, b = r.lastTime;
+    strftime(from, sizeof(from), "%Y-%m-%d", gmtime(&a));
+    strftime(to, sizeof(to), "%Y-%m-%d", gmtime(&b));
+    printf("Period: %s .. %s (%.1f days recorded)\n", from, to, r.coveredSeconds / 86400);
+  }
+
+  printf("\nOn-hours\n");
+  for (int b = 0; b < USAGE_MAX_BULBS; b++) {
+    if (r.onSeconds[b] == 0) continue;
+    const char* name = b < 2 ? BULB_NAMES[b] : "bulb";
+    printf("  %-10s %8.1f h\n", name, r.onSeconds[b] / 3600);
+  }
+
+  double litSeconds = 0;
+  for (double s : r.dimmingSeconds) litSeconds += s;
+  if (litSeconds == 0) return;
+
+  printf("\nBrightness (share of lit time)\n");
+  for (int i = 0; i <= 10; i++) {
+    if (r.dimmingSeconds[i] == 0) continue;
+    double pct = 100 * r.dimmingSeconds[i] / litSeconds;
+    printf("  %3d%%%s %5.1f%% %s\n", i * 10, i < 10 ? "+" : " ", pct, std::string((size_t)(pct / 2), '#').c_str());
+  }
+
+  printf("\nColor temperature (share of lit time)\n");
+  for (int i = 0; i < 100; i++) {
+    if (r.tempSeconds[i] == 0) continue;
+    printf("  %5dK %5.1f%%\n", i * 100, 100 * r.tempSeconds[i] / litSeconds);
+  }
+
+  double hourTotal = 0;
+  for (double s : r.hourSeconds) hourTotal += s;
+  if (hourTotal == 0) return;
+  printf("\nLit hours by hour of day\n");
+  for (int h = 0; h < 24; h++) {
+    double hours = r.hourSeconds[h] / 3600;
+    printf("  %02d:00 %7.1f h %s\n", h, hours, std::string((size_t)(60 * r.hourSeconds[h] / hourTotal), '#').c_str());
+  }
+}
+
+// Simulated image writer, mirroring usage.cpp
+struct SynthWriter {
+  std::vector<uint8_t> image;
+  uint32_t sectorCount;
+  uint32_t sector;
+  uint32_t seq = 0;
+  size_t offset = 0;
+  uint32_t lastT = 0;
+  State state;
+
+  SynthWriter() : image(IMAGE_SIZE, 0xFF), sectorCount(IMAGE_SIZE / USAGE_SECTOR_SIZE), sector(sectorCount - 1) {}
+
+  void openSector(uint32_t t) {
+    sector = (sector + 1) % sectorCount;
+    std::fill(image.begin() + sector * USAGE_SECTOR_SIZE, image.begin() + (sector + 1) * USAGE_SECTOR_SIZE, 0xFF);
+    UsageSectorHeader h = {USAGE_MAGIC, ++seq, t};
+    memcpy(&image[sector * USAGE_SECTOR_SIZE], &h, sizeof(h));
+    offset = sizeof(h);
+    lastT = t;
+    uint8_t rec[USAGE_RECORD_MAX];
+    size_t n = usagePutHead(rec, 0, USAGE_SNAPSHOT);
+    rec[n++] = state.mask;
+    n += logPutVarint(rec + n, (uint32_t)state.dimming);
+    n += logPutVarint(rec + n, (uint32_t)state.temp / 100);
+    put(rec, n);
+  }
+
+  void put(const uint8_t* rec, size_t n) {
+    memcpy(&image[sector * USAGE_SECTOR_SIZE + offset], rec, n);
+    offset += n;
+  }
+
+  void record(uint32_t t, UsageKind kind, uint32_t value) {
+    if (offset + 2 * USAGE_RECORD_MAX > USAGE_SECTOR_SIZE) {
+      openSector(t);
+      if (kind != USAGE_BOOT && kind != USAGE_TIME) return;
+    }
+    uint8_t rec[USAGE_RECORD_MAX];
+    size_t n = usagePutHead(rec, t - lastT, kind);
+    lastT = t;
+    if (kind == USAGE_POWER) rec[n++] = (uint8_t)value;
+    else n += logPutVarint(rec + n, value);
+    put(rec, n);
+  }
+
+  void power(uint32_t t, uint8_t mask) {
+    state.mask = mask;
+    record(t, USAGE_POWER, mask);
+  }
+  void dimming(uint32_t t, int d) {
+    uint32_t delta = usageZigzag(d - state.dimming);
+    state.dimming = d;
+    record(t, USAGE_DIMMING, delta);
+  }
+  void temp(uint32_t t, int k) {
+    state.temp = k;
+    record(t, USAGE_TEMP, (uint32_t)k / 100);
+  }
+};
+
+int synth(int days, const char* path) {
+  std::mt19937 rng(42);
+  SynthWriter w;
+  const int temps[] = {2200, 2700, 4000, 6500};
+  uint32_t start = 1704067200;  // 2024-01-01 UTC
+  w.openSector(start);
+
+  for (int day = 0; day < days; day++) {
+    uint32_t t = start + (uint32_t)day * 86400 + 17 * 3600 + rng() % 7200;
+    w.power(t, 1 + rng() % 3);
+    if (rng() % 3 == 0) w.temp(t + 5, temps[rng() % 4]);
+    int changes = 2 + (int)(rng() % 10);
+    for (int i = 0; i < changes; i++) {
+      t += 300 + rng() % 2400;
+      w.dimming(t, 10 + 2 * (int)(rng() % 46));
+      if (rng() % 4 == 0) w.power(t + 30, 1 + rng() % 3);
+    }
+    t += 1800 + rng() % 7200;
+    w.power(t, 0);
+  }
+
+  FILE* f = fopen(path, "wb");
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  fwrite(w.image.data(), 1, w.image.size(), f);
+  fclose(f);
+  printf("Wrote %d days to %s (%u sectors used, ring wrapped %u times)\n",
+    days, path, w.seq < w.sectorCount ? w.seq : w.sectorCount, w.seq / w.sectorCount);
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc >= 4 && strcmp(argv[1], "--synth") == 0) return synth(atoi(argv[2]), argv[3]);
+
+  const char* path = nullptr;
+  int tzSeconds = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--tz") == 0 && i + 1 < argc) tzSeconds = (int)(atof(argv[++i]) * 3600);
+    else path = argv[i];
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s usage.bin [--tz hours] | --synth days out.bin\n", argv[0]);
+    return 2;
+  }
+
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    perror(path);
+    return 1;
+  }
+  void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapped == MAP_FAILED) {
+    perror("mmap");
+    return 1;
+  }
+
+  Report report;
+  auto begin = std::chrono::steady_clock::now();
+  decode((const uint8_t*)mapped, (size_t)st.st_size, tzSeconds, report);
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+  printReport(report, ms, (size_t)st.st_size);
+  munmap(mapped, (size_t)st.st_size);
+  close(fd);
+  return 0;
+}
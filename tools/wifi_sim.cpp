@@ -0,0 +1,237 @@
+// Replays forced AP outages against src/wifi_link.h and against the old
+// approach (the core's auto-reconnect plus a WiFi.status() check every
+// 30 s) and prints time-to-recover distributions.
+//
+// Build:  g++ -std=c++17 -O2 -I src -o wifi_sim tools/wifi_sim.cpp
+// Usage:  ./wifi_sim [drops] [seed]
+//
+// The station driver is modelled, not emulated. The timings are typical
+// ESP32 figures:
+//   drop detection  40% of outages deauthenticate the station at once; the
+//                   rest are noticed by beacon timeout after 6 s, and
+//                   outages shorter than that are never noticed at all
+//   cached connect  probes one channel: 60-150 ms to associate, or fails
+//                   with NO_AP_FOUND after 100-200 ms
+//   full scan       1.8-2.6 s over every channel, then associates if the AP
+//                   was up by the end of the scan
+//   DHCP            50-500 ms after association
+//   AP restart      outages over 20 s are AP reboots, and 30% of those come
+//                   back on another channel (auto channel selection)
+// Outages are log-uniform between 0.5 and 60 s. The old approach is given
+// a full-scan retry after every disconnect, whatever the reason (not every
+// core version retries after all of them).
+//
+// Per outage the tool reports, from the moment the AP is back:
+//   recover   the station has an IP again
+//   resume    the controller sends again. WifiLink holds commands while the
+//             link is down and sends them in the 10 ms loop pass that sees
+//             the IP. The old firmware never stopped sending, so it resumed
+//             at once, but everything sent during the outage was lost.
+//   notice    the controller knows the link is back (the next 30 s check in
+//             the old firmware)
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "wifi_link.h"
+
+namespace {
+
+const unsigned long PASS_MS = 10;
+const unsigned long STATUS_CHECK_MS = 30000;
+const unsigned long BEACON_TIMEOUT_MS = 6000;
+const unsigned long GIVE_UP_MS = 180000;
+const uint8_t REASON_BEACON_TIMEOUT = 200;
+const uint8_t REASON_NO_AP_FOUND = 201;
+const uint8_t REASON_DEAUTH_LEAVING = 3;
+const uint8_t AP_BSSID[6] = {0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc};
+
+enum EventKind { EV_ASSOCIATED, EV_GOT_IP, EV_DISCONNECTED };
+
+struct Event {
+  unsigned long at;
+  EventKind kind;
+  uint8_t reason;
+  uint8_t channel;
+};
+
+struct Outage {
+  unsigned long start;     // AP goes away
+  unsigned long back;      // AP up again
+  unsigned long detectAt;  // Station gets the disconnect (0 = never noticed)
+  uint8_t reason;
+  uint8_t channelAfter;
+};
+
+// Station driver: turns connect requests into events, given where the AP is
+class Driver {
+ public:
+  Driver(std::mt19937& rng, const Outage& o) : rng_(rng), o_(o) {}
+
+  bool apUp(unsigned long t) const { return t < o_.start || t >= o_.back; }
+  uint8_t apChannel(unsigned long t) const { return t < o_.start ? 6 : o_.channelAfter; }
+
+  void connect(unsigned long now, bool cached, uint8_t channel) {
+    if (cached) {
+      if (apUp(now) && apChannel(now) == channel) {
+        associate(now + uniform(60, 150));
+      } else {
+        push(now + uniform(100, 200), EV_DISCONNECTED, REASON_NO_AP_FOUND);
+      }
+    } else {
+      unsigned long end = now + uniform(1800, 2600);
+      if (apUp(end)) {
+        associate(end + uniform(60, 150));
+      } else {
+        push(end, EV_DISCONNECTED, REASON_NO_AP_FOUND);
+      }
+    }
+  }
+
+  // Next event due by `now`, in order
+  bool next(unsigned long now, Event* e) {
+    if (events_.empty()) return false;
+    auto it = std::min_element(events_.begin(), events_.end(),
+      [](const Event& a, const Event& b) { return a.at < b.at; });
+    if (it->at > now) return false;
+    *e = *it;
+    events_.erase(it);
+    return true;
+  }
+
+  void push(unsigned long at, EventKind kind, uint8_t reason) {
+    events_.push_back({at, kind, reason, apChannel(at)});
+  }
+
+ private:
+  void associate(unsigned long at) {
+    push(at, EV_ASSOCIATED, 0);
+    push(at + uniform(50, 500), EV_GOT_IP, 0);
+  }
+
+  unsigned long uniform(unsigned long lo, unsigned long hi) {
+    return lo + rng_() % (hi - lo + 1);
+  }
+
+  std::mt19937& rng_;
+  const Outage& o_;
+  std::vector<Event> events_;
+};
+
+struct Result {
+  unsigned long recover;
+  unsigned long resume;
+  unsigned long notice;
+};
+
+Result runEventDriven(std::mt19937& rng, const Outage& o) {
+  Driver driver(rng, o);
+  WifiLink link;
+  link.begin(0);
+  link.associated(6, AP_BSSID);
+  link.gotIp();
+  if (o.detectAt) driver.push(o.detectAt, EV_DISCONNECTED, o.reason);
+
+  unsigned long ipAt = 0;
+  for (unsigned long t = 0; t < o.back + GIVE_UP_MS; t += PASS_MS) {
+    // The loop drains every event the WiFi task queued since the last pass
+    Event e;
+    while (driver.next(t, &e)) {
+      if (e.kind == EV_ASSOCIATED) link.associated(e.channel, AP_BSSID);
+      if (e.kind == EV_GOT_IP) {
+        link.gotIp();
+        if (!ipAt) ipAt = e.at;
+      }
+      if (e.kind == EV_DISCONNECTED) link.disconnected(t, e.reason);
+    }
+    WifiAction action = link.poll(t);
+    if (action != WIFI_ACTION_NONE) driver.connect(t, action == WIFI_ACTION_CONNECT_CACHED, link.cachedChannel());
+    if (ipAt && link.up()) return {ipAt - o.back, t - o.back, t - o.back};
+  }
+  return {GIVE_UP_MS, GIVE_UP_MS, GIVE_UP_MS};
+}
+
+Result runLegacy(std::mt19937& rng, const Outage& o) {
+  Driver driver(rng, o);
+  driver.push(o.detectAt, EV_DISCONNECTED, o.reason);
+
+  // The core reconnects from the event task: every disconnect starts a scan
+  unsigned long ipAt = 0;
+  Event e;
+  for (unsigned long t = 0; t < o.back + GIVE_UP_MS && !ipAt; t++) {
+    while (driver.next(t, &e)) {
+      if (e.kind == EV_DISCONNECTED) driver.connect(t, false, 0);
+      if (e.kind == EV_GOT_IP) ipAt = e.at;
+    }
+  }
+  if (!ipAt) return {GIVE_UP_MS, GIVE_UP_MS, GIVE_UP_MS};
+
+  // Status checks at a fixed 30 s cadence from boot
+  unsigned long noticed = (ipAt / STATUS_CHECK_MS + 1) * STATUS_CHECK_MS;
+  return {ipAt - o.back, ipAt - o.back, noticed - o.back};
+}
+
+void printDistribution(const char* name, std::vector<unsigned long> v) {
+  std::sort(v.begin(), v.end());
+  auto pct = [&](double p) { return v[std::min(v.size() - 1, (size_t)(p * v.size()))]; };
+  double mean = 0;
+  for (unsigned long x : v) mean += x;
+  mean /= v.size();
+  printf("  %-22s %7.0f %7lu %7lu %7lu %7lu\n", name, mean, pct(0.5), pct(0.9), pct(0.99), v.back());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int count = argc > 1 ? atoi(argv[1]) : 2000;
+  unsigned long seed = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1;
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> unit(0, 1);
+
+  std::vector<unsigned long> recoverNew, resumeNew, recoverOld, resumeOld, noticeOld;
+  int unnoticed = 0;
+  for (int i = 0; i < count; i++) {
+    Outage o;
+    o.start = 10000 + rng() % STATUS_CHECK_MS;
+    o.back = o.start + (unsigned long)(500 * std::pow(120.0, unit(rng)));  // 0.5-60 s
+    o.channelAfter = o.back - o.start > 20000 && unit(rng) < 0.3 ? 11 : 6;
+    if (unit(rng) < 0.4) {
+      o.detectAt = o.start + 5;
+      o.reason = REASON_DEAUTH_LEAVING;
+    } else {
+      o.detectAt = o.back > o.start + BEACON_TIMEOUT_MS ? o.start + BEACON_TIMEOUT_MS : 0;
+      o.reason = REASON_BEACON_TIMEOUT;
+    }
+    if (!o.detectAt) {
+      unnoticed++;
+      continue;
+    }
+
+    std::mt19937 a(rng()), b = a;  // Same driver timings for both
+    Result n = runEventDriven(a, o);
+    Result l = runLegacy(b, o);
+    recoverNew.push_back(n.recover);
+    resumeNew.push_back(n.resume);
+    recoverOld.push_back(l.recover);
+    resumeOld.push_back(l.resume);
+    noticeOld.push_back(l.notice);
+  }
+
+  printf("%d outages, %d too short to notice, %zu measured (ms after the AP is back)\n",
+    count, unnoticed, recoverNew.size());
+  printf("  %-22s %7s %7s %7s %7s %7s\n", "", "mean", "p50", "p90", "p99", "max");
+  printf("recover (IP back)\n");
+  printDistribution("auto-reconnect", recoverOld);
+  printDistribution("WifiLink", recoverNew);
+  printf("resume (controller sends again)\n");
+  printDistribution("auto-reconnect", resumeOld);
+  printDistribution("WifiLink", resumeNew);
+  printf("notice (controller knows)\n");
+  printDistribution("30 s status check", noticeOld);
+  printDistribution("WifiLink events", resumeNew);
+  return 0;
+}
@@ -0,0 +1,377 @@
+// Stand-in WiZ clients for measuring what the dimmer's proxy (src/proxy.cpp)
+// saves the bulbs. Run against tools/bulbfarm.cpp.
+//
+// Build:  g++ -std=c++17 -O2 -I src -o wizclients tools/wizclients.cpp
+// Usage:  ./bulbfarm -n 2 --addr 127.0.0.1 --ports
+//         ./wizclients [--proxy] [--interval-ms 0] [--ttl-ms 10000] [--seconds 20]
+//                      [--poll-ms 1000] [--monitor-only] [--bulbs 2] [--addr 127.0.0.1]
+//                      [--port 38899]
+//
+// Two clients per bulb, as on a typical home network:
+//   app         a phone slider: every 4 s a one-second drag sending setPilot
+//               dimming at 20 Hz
+//   automation  a home automation server: getPilot every --poll-ms and a
+//               setPilot temp every 5 s
+// --monitor-only leaves just the getPilot polls, as in a house nobody is
+// adjusting.
+//
+// Without --proxy the clients talk to the bulbs directly. With --proxy they
+// talk to an in-process copy of the dimmer's proxy on WIZ_PROXY_PORT + i,
+// which merges requests into the same CommandQueue the firmware uses and
+// sends it every 10 ms loop pass under --interval-ms. getPilot is answered
+// from the state the bulbs confirmed (acks and getPilot replies) unless it is
+// older than --ttl-ms; then the bulb is asked once and every waiting client
+// gets that answer. The tool prints client requests against packets that
+// reached the bulbs; bulbfarm's own report should agree.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "command_queue.h"
+#include "proxy.h"
+#include "wiz_json.h"
+
+namespace {
+
+const int MAX_BULBS = 16;
+const unsigned long PASS_MS = 10;
+const unsigned long DRAG_EVERY_MS = 4000;
+const unsigned long DRAG_MS = 1000;
+const unsigned long DRAG_STEP_MS = 50;
+const unsigned long TEMP_EVERY_MS = 5000;
+
+struct Counts {
+  unsigned long setPilots = 0;
+  unsigned long getPilots = 0;
+  unsigned long replies = 0;
+};
+
+double nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int udpSocket(const char* ip, int port) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) return -1;
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_pton(AF_INET, ip, &addr.sin_addr);
+  if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+sockaddr_in address(const char* ip, int port) {
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  inet_pton(AF_INET, ip, &addr.sin_addr);
+  return addr;
+}
+
+void sendTo(int fd, const sockaddr_in& to, const char* json) {
+  sendto(fd, json, strlen(json), 0, (const sockaddr*)&to, sizeof(to));
+}
+
+// Count and discard whatever is waiting on a socket
+unsigned long drain(int fd) {
+  char buf[512];
+  unsigned long n = 0;
+  while (recv(fd, buf, sizeof(buf), 0) > 0) n++;
+  return n;
+}
+
+struct Waiter {
+  sockaddr_in from;
+  WizRequest req;
+  unsigned long since;
+};
+
+// The parts of proxy.cpp and lights.cpp that decide what reaches a bulb
+struct Proxy {
+  int fds[MAX_BULBS];
+  int upstream;
+  const sockaddr_in* bulbAddrs;
+  unsigned long ttlMs = PROXY_DEFAULT_STATE_TTL_MS;
+  CommandQueue<MAX_BULBS> queue;
+  PilotCommand desired[MAX_BULBS] = {};
+  PilotCommand acked[MAX_BULBS] = {};
+  unsigned long ackedAt[MAX_BULBS] = {};
+  std::vector<std::pair<uint32_t, PilotCommand>> inFlight[MAX_BULBS];
+  std::vector<Waiter> waiters[MAX_BULBS];
+  bool refresh[MAX_BULBS] = {};
+  uint32_t messageId = 1;
+  unsigned long forwarded = 0, probes = 0, getPilots = 0, cacheHits = 0;
+
+  int bulbAt(const sockaddr_in& from, int bulbCount) const {
+    for (int i = 0; i < bulbCount; i++) {
+      if (bulbAddrs[i].sin_port == from.sin_port && bulbAddrs[i].sin_addr.s_addr == from.sin_addr.s_addr) return i;
+    }
+    return -1;
+  }
+
+  void answer(int bulb, const sockaddr_in& to, const WizRequest& req, unsigned long now) {
+    char reply[192], age[32];
+    if (acked[bulb].fields) {
+      snprintf(age, sizeof(age), ",\"ageMs\":%lu", now - ackedAt[bulb]);
+      wizFormatGetReply(reply, sizeof(reply), req, acked[bulb], age);
+    } else {
+      wizFormatError(reply, sizeof(reply), req, WIZ_ERROR_NO_STATE, "No confirmed state");
+    }
+    sendTo(fds[bulb], to, reply);
+  }
+
+  // Same bookkeeping as handleReply() and applyAck() in lights.cpp
+  void upstreamReply(int bulb, const char* json, unsigned long now) {
+    long id;
+    bool hasId = wizFindInt(json, "\"id\"", &id);
+    PilotCommand state;
+    wizParsePilot(json, &state);
+    auto& flight = inFlight[bulb];
+    if (state.fields && flight.empty()) {
+      acked[bulb] = state;
+      ackedAt[bulb] = now;
+    }
+    for (size_t i = 0; hasId && i < flight.size(); i++) {
+      if (flight[i].first != (uint32_t)id) continue;
+      const PilotCommand& cmd = flight[i].second;
+      if (strstr(json, "\"success\":true")) {
+        acked[bulb].fields |= cmd.fields | PILOT_STATE;
+        acked[bulb].on = (cmd.fields & PILOT_STATE) ? cmd.on : true;
+        if (cmd.fields & PILOT_DIMMING) acked[bulb].dimming = cmd.dimming;
+        if (cmd.fields & PILOT_TEMP) acked[bulb].temp = cmd.temp;
+        ackedAt[bulb] = now;
+      }
+      flight.erase(flight.begin() + i);
+      break;
+    }
+  }
+
+  void handle(int bulb, const char* json, const sockaddr_in& from, unsigned long now) {
+    WizRequest req;
+    wizParseRequest(json, &req);
+    char reply[192];
+    if (req.method == WIZ_SET_PILOT) {
+      PilotCommand cmd = req.pilot;
+      PilotCommand& d = desired[bulb];
+      if (!(cmd.fields & PILOT_STATE) && !d.on) {
+        cmd.fields |= PILOT_STATE;
+        cmd.on = true;
+      }
+      if (cmd.fields & PILOT_STATE) d.on = cmd.on;
+      if (cmd.fields & PILOT_DIMMING) d.dimming = cmd.dimming;
+      if (cmd.fields & PILOT_TEMP) d.temp = cmd.temp;
+      d.fields |= cmd.fields;
+      if (cmd.fields) queue.push(bulb, cmd, (cmd.fields & PILOT_STATE) ? PRIORITY_CONTROL : PRIORITY_STREAM);
+      wizFormatSetReply(reply, sizeof(reply), req);
+    } else if (req.method == WIZ_GET_PILOT) {
+      getPilots++;
+      if (acked[bulb].fields && now - ackedAt[bulb] < ttlMs) {
+        cacheHits++;
+        answer(bulb, from, req, now);
+      } else {
+        if (waiters[bulb].empty()) refresh[bulb] = true;
+        waiters[bulb].push_back({from, req, now});
+      }
+      return;
+    } else {
+      wizFormatError(reply, sizeof(reply), req, WIZ_ERROR_METHOD_NOT_FOUND, "Method not found");
+    }
+    sendTo(fds[bulb], from, reply);
+  }
+
+  void pass(int bulbCount, unsigned long now, unsigned long intervalMs) {
+    char json[512];
+    sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t len;
+    while ((len = recvfrom(upstream, json, sizeof(json) - 1, 0, (sockaddr*)&from, &fromLen)) > 0) {
+      json[len] = '\0';
+      int bulb = bulbAt(from, bulbCount);
+      if (bulb >= 0) upstreamReply(bulb, json, now);
+      fromLen = sizeof(from);
+    }
+
+    for (int i = 0; i < bulbCount; i++) {
+      // Waiters: answered once the state is confirmed after they asked, or after ACK_TIMEOUT_MS
+      auto& w = waiters[i];
+      if (!w.empty() && ((acked[i].fields && ackedAt[i] >= w.front().since) || now - w.front().since >= 1000)) {
+        for (const Waiter& x : w) answer(i, x.from, x.req, now);
+        w.clear();
+      }
+      while ((len = recvfrom(fds[i], json, sizeof(json) - 1, 0, (sockaddr*)&from, &fromLen)) > 0) {
+        json[len] = '\0';
+        handle(i, json, from, now);
+        fromLen = sizeof(from);
+      }
+    }
+
+    bool commanded[MAX_BULBS] = {};
+    int bulb;
+    PilotCommand cmd;
+    while (queue.pop(now, intervalMs, &bulb, &cmd)) {
+      char params[64];
+      wizFormatPilot(params, sizeof(params), cmd);
+      uint32_t id = messageId++;
+      snprintf(json, sizeof(json), "{\"id\":%u,\"method\":\"setPilot\",\"params\":{%s}}", id, params);
+      sendTo(upstream, bulbAddrs[bulb], json);
+      inFlight[bulb].push_back({id, cmd});
+      if (inFlight[bulb].size() > 4) inFlight[bulb].erase(inFlight[bulb].begin());
+      commanded[bulb] = true;
+      forwarded++;
+    }
+    for (int i = 0; i < bulbCount; i++) {
+      if (!refresh[i]) continue;
+      refresh[i] = false;
+      if (commanded[i]) continue;  // Its ack refreshes the cache
+      snprintf(json, sizeof(json), "{\"id\":%u,\"method\":\"getPilot\",\"params\":{}}", messageId++);
+      sendTo(upstream, bulbAddrs[i], json);
+      probes++;
+    }
+  }
+};
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+    "usage: %s [--proxy] [--interval-ms 0] [--ttl-ms 10000] [--seconds 20]\n"
+    "          [--poll-ms 1000] [--monitor-only] [--bulbs 2] [--addr 127.0.0.1]\n"
+    "          [--port 38899]\n", argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool useProxy = false, monitorOnly = false;
+  unsigned long intervalMs = 0, pollMs = 1000, ttlMs = PROXY_DEFAULT_STATE_TTL_MS;
+  double seconds = 20;
+  int bulbCount = 2;
+  const char* ip = "127.0.0.1";
+  int basePort = 38899;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (strcmp(arg, "--proxy") == 0) useProxy = true;
+    else if (strcmp(arg, "--monitor-only") == 0) monitorOnly = true;
+    else if (strcmp(arg, "--interval-ms") == 0 && hasValue) intervalMs = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(arg, "--ttl-ms") == 0 && hasValue) ttlMs = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(arg, "--seconds") == 0 && hasValue) seconds = atof(argv[++i]);
+    else if (strcmp(arg, "--poll-ms") == 0 && hasValue) pollMs = strtoul(argv[++i], nullptr, 10);
+    else if (strcmp(arg, "--bulbs") == 0 && hasValue) bulbCount = atoi(argv[++i]);
+    else if (strcmp(arg, "--addr") == 0 && hasValue) ip = argv[++i];
+    else if (strcmp(arg, "--port") == 0 && hasValue) basePort = atoi(argv[++i]);
+    else { usage(argv[0]); return 2; }
+  }
+  if (bulbCount < 1 || bulbCount > MAX_BULBS || pollMs == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  sockaddr_in bulbAddrs[MAX_BULBS], targets[MAX_BULBS];
+  for (int i = 0; i < bulbCount; i++) {
+    bulbAddrs[i] = address(ip, basePort + i);
+    targets[i] = useProxy ? address("127.0.0.1", WIZ_PROXY_PORT + i) : bulbAddrs[i];
+  }
+
+  Proxy proxy;
+  proxy.bulbAddrs = bulbAddrs;
+  proxy.ttlMs = ttlMs;
+  if (useProxy) {
+    proxy.upstream = udpSocket("0.0.0.0", 0);
+    for (int i = 0; i < bulbCount; i++) {
+      proxy.fds[i] = udpSocket("127.0.0.1", WIZ_PROXY_PORT + i);
+      if (proxy.fds[i] < 0) {
+        fprintf(stderr, "cannot bind proxy port %d: %s\n", WIZ_PROXY_PORT + i, strerror(errno));
+        return 1;
+      }
+    }
+  }
+  int app = udpSocket("0.0.0.0", 0);
+  int automation = udpSocket("0.0.0.0", 0);
+  if (app < 0 || automation < 0 || (useProxy && proxy.upstream < 0)) {
+    fprintf(stderr, "socket: %s\n", strerror(errno));
+    return 1;
+  }
+
+  Counts appCounts, autoCounts;
+  uint32_t id = 1;
+  char json[256];
+  double start = nowMs();
+  unsigned long end = (unsigned long)(seconds * 1e3);
+  unsigned long lastDrag[MAX_BULBS] = {}, lastPoll[MAX_BULBS] = {}, lastTemp[MAX_BULBS] = {};
+
+  for (unsigned long now = 0; now < end; now += PASS_MS) {
+    while (nowMs() - start < now) usleep(200);
+
+    for (int i = 0; i < bulbCount; i++) {
+      // Stagger bulbs so their bursts do not line up
+      unsigned long t = now + i * 700;
+
+      unsigned long inCycle = t % DRAG_EVERY_MS;
+      if (!monitorOnly && inCycle < DRAG_MS && t - lastDrag[i] >= DRAG_STEP_MS) {
+        lastDrag[i] = t;
+        int dimming = 30 + (int)(inCycle * 50 / DRAG_MS);
+        snprintf(json, sizeof(json), "{\"id\":%u,\"method\":\"setPilot\",\"params\":{\"dimming\":%d}}", id++, dimming);
+        sendTo(app, targets[i], json);
+        appCounts.setPilots++;
+      }
+
+      if (t - lastPoll[i] >= pollMs) {
+        lastPoll[i] = t;
+        snprintf(json, sizeof(json), "{\"id\":%u,\"method\":\"getPilot\",\"params\":{}}", id++);
+        sendTo(automation, targets[i], json);
+        autoCounts.getPilots++;
+      }
+      if (!monitorOnly && t - lastTemp[i] >= TEMP_EVERY_MS) {
+        lastTemp[i] = t;
+        int temp = 2200 + (int)((t / TEMP_EVERY_MS) % 5) * 100;
+        snprintf(json, sizeof(json), "{\"id\":%u,\"method\":\"setPilot\",\"params\":{\"temp\":%d}}", id++, temp);
+        sendTo(automation, targets[i], json);
+        autoCounts.setPilots++;
+      }
+    }
+
+    if (useProxy) proxy.pass(bulbCount, now, intervalMs);
+    appCounts.replies += drain(app);
+    autoCounts.replies += drain(automation);
+  }
+
+  // Let the last replies arrive
+  for (int i = 0; i < 3; i++) {
+    usleep(50000);
+    if (useProxy) proxy.pass(bulbCount, end + 1000, 0);  // Past the waiters' timeout
+  }
+  appCounts.replies += drain(app);
+  autoCounts.replies += drain(automation);
+
+  unsigned long requests = appCounts.setPilots + appCounts.getPilots + autoCounts.setPilots + autoCounts.getPilots;
+  unsigned long bulbGets = useProxy ? proxy.probes : appCounts.getPilots + autoCounts.getPilots;
+  unsigned long bulbPackets = useProxy ? proxy.forwarded + proxy.probes : requests;
+  printf("%s, %d bulbs, %.0f s, interval %lu ms, poll %lu ms",
+    useProxy ? "via proxy" : "direct", bulbCount, seconds, intervalMs, pollMs);
+  if (useProxy) printf(", ttl %lu ms", ttlMs);
+  printf("\n");
+  printf("%-11s %9s %9s %8s\n", "client", "setPilot", "getPilot", "replies");
+  printf("%-11s %9lu %9lu %8lu\n", "app", appCounts.setPilots, appCounts.getPilots, appCounts.replies);
+  printf("%-11s %9lu %9lu %8lu\n", "automation", autoCounts.setPilots, autoCounts.getPilots, autoCounts.replies);
+  if (useProxy) printf("getPilot answered from cache: %lu of %lu\n", proxy.cacheHits, proxy.getPilots);
+  printf("client requests: %lu  packets to bulbs: %lu (%.1f/s per bulb), getPilot: %lu\n",
+    requests, bulbPackets, bulbPackets / seconds / bulbCount, bulbGets);
+  return 0;
+}
@@ -0,0 +1,644 @@
+// WebSocket client swarm for the dimmer's /ws push (src/web.cpp), and a
+// host stand-in for the dimmer side to run it against.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -I src -o wsswarm tools/wsswarm.cpp
+// Usage:  ./wsswarm [--addr 127.0.0.1] [--port 80] [--clients 10] [--changes 100]
+//                   [--interval-ms 100]
+//         ./wsswarm --serve [--addr 127.0.0.1] [--port 8080] [--send-us 200] [--inline]
+//                   [--report-s 10]
+//
+// The swarm opens --clients WebSockets, checks that each gets a snapshot,
+// then has the first client send a brightness command every --interval-ms.
+// For every change it times command to delta at each client and counts
+// the clients that never saw it. Keep --interval-ms above the 50 ms push
+// interval, or changes merge and count as missed.
+//
+// --serve plays the dimmer: a network thread stands in for AsyncTCP and
+// only queues, a loop thread makes 10 ms passes applying commands, and
+// frames go out the way the firmware sends them, from a push thread woken
+// by the loop, at most every 50 ms. Each send also blocks for --send-us per
+// client, a model of a WebSocket send waiting for the ESP32's TCP/IP task
+// (not a measurement). --inline sends from the loop thread instead, as the
+// firmware used to. Both print how long the loop's passes took, which is
+// what moving the sends off the loop buys.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "web.h"
+
+namespace {
+
+const double PUSH_INTERVAL_MS = 50;  // web.cpp
+const double PASS_MS = 10;
+
+volatile sig_atomic_t stopRequested = 0;
+
+void onSignal(int) { stopRequested = 1; }
+
+double nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// --- WebSocket framing ---
+
+uint32_t rol(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+std::string sha1(const std::string& in) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+  std::string m = in;
+  uint64_t bits = (uint64_t)in.size() * 8;
+  m += (char)0x80;
+  while (m.size() % 64 != 56) m += (char)0;
+  for (int i = 7; i >= 0; i--) m += (char)(bits >> (i * 8));
+  for (size_t off = 0; off < m.size(); off += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      const unsigned char* p = (const unsigned char*)m.data() + off + i * 4;
+      w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    }
+    for (int i = 16; i < 80; i++) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+      else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+      else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+      else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+      uint32_t t = rol(a, 5) + f + e + k + w[i];
+      e = d; d = c; c = rol(b, 30); b = a; a = t;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+  }
+  std::string out;
+  for (int i = 0; i < 5; i++) {
+    for (int j = 3; j >= 0; j--) out += (char)(h[i] >> (j * 8));
+  }
+  return out;
+}
+
+std::string base64(const std::string& in) {
+  static const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < in.size(); i += 3) {
+    uint32_t v = (uint32_t)(unsigned char)in[i] << 16;
+    if (i + 1 < in.size()) v |= (uint32_t)(unsigned char)in[i + 1] << 8;
+    if (i + 2 < in.size()) v |= (unsigned char)in[i + 2];
+    out += table[v >> 18 & 63];
+    out += table[v >> 12 & 63];
+    out += i + 1 < in.size() ? table[v >> 6 & 63] : '=';
+    out += i + 2 < in.size() ? table[v & 63] : '=';
+  }
+  return out;
+}
+
+std::string acceptKey(const std::string& key) {
+  return base64(sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC11B65"));
+}
+
+// One binary frame, masked when a client sends it
+std::string encodeFrame(const uint8_t* data, size_t len, bool mask) {
+  std::string f;
+  f += (char)0x82;
+  f += (char)((mask ? 0x80 : 0) | len);  // Frames here are never over 125 bytes
+  uint8_t key[4] = {0x12, 0x34, 0x56, 0x78};
+  if (mask) f.append((const char*)key, 4);
+  for (size_t i = 0; i < len; i++) f += (char)(mask ? data[i] ^ key[i % 4] : data[i]);
+  return f;
+}
+
+// Take one complete frame off the front of buf; false if there is none yet
+bool decodeFrame(std::string& buf, int* opcode, std::string* payload) {
+  if (buf.size() < 2) return false;
+  const unsigned char* p = (const unsigned char*)buf.data();
+  bool masked = p[1] & 0x80;
+  size_t len = p[1] & 0x7F, at = 2;
+  if (len == 126) {
+    if (buf.size() < 4) return false;
+    len = (size_t)p[2] << 8 | p[3];
+    at = 4;
+  } else if (len == 127) {
+    return false;  // Not used by either side
+  }
+  if (buf.size() < at + (masked ? 4 : 0) + len) return false;
+  const unsigned char* key = p + at;
+  if (masked) at += 4;
+  payload->assign(buf, at, len);
+  for (size_t i = 0; masked && i < len; i++) (*payload)[i] ^= key[i % 4];
+  *opcode = p[0] & 0x0F;
+  buf.erase(0, at + len);
+  return true;
+}
+
+std::string headerValue(const std::string& head, const char* name) {
+  size_t len = strlen(name);
+  for (size_t p = head.find("\r\n"); p != std::string::npos; p = head.find("\r\n", p + 2)) {
+    if (strncasecmp(head.c_str() + p + 2, name, len) == 0 && head[p + 2 + len] == ':') {
+      size_t start = head.find_first_not_of(' ', p + 3 + len);
+      return head.substr(start, head.find("\r\n", start) - start);
+    }
+  }
+  return "";
+}
+
+// --- Stand-in dimmer ---
+
+struct Controller {
+  std::mutex lock;  // The firmware's seqlock
+  uint32_t version = 1;
+  uint8_t fields[WEB_FIELD_COUNT] = {50, 1, 27, 3};
+};
+
+struct Server {
+  Controller state;
+  bool inlinePush = false;
+  double sendUs = 200;
+
+  std::mutex clientsLock;  // AsyncWebSocket's client list
+  std::map<int, bool> clients;  // fd -> handshake done
+
+  std::mutex queueLock;
+  std::deque<std::pair<uint8_t, uint8_t> > commands;
+  std::deque<int> hellos;
+
+  std::mutex wakeLock;
+  std::condition_variable wake;
+  bool woken = false;
+
+  // Push side only
+  uint8_t published[WEB_FIELD_COUNT];
+  bool publishedValid = false;
+  uint32_t publishedVersion = 0;
+  double lastPush = 0;
+
+  // Counters, read by the report
+  std::mutex countersLock;
+  unsigned long frames = 0, passes = 0;
+  double fanoutSumUs = 0, fanoutMaxUs = 0, passSumUs = 0, passMaxUs = 0;
+};
+
+void sendFrame(Server& s, int fd, const uint8_t* data, size_t len) {
+  std::string f = encodeFrame(data, len, false);
+  send(fd, f.data(), f.size(), MSG_NOSIGNAL);
+  std::this_thread::sleep_for(std::chrono::microseconds((long)s.sendUs));
+}
+
+void pushState(Server& s) {
+  uint8_t current[WEB_FIELD_COUNT];
+  {
+    std::lock_guard<std::mutex> g(s.state.lock);
+    s.publishedVersion = s.state.version;
+    memcpy(current, s.state.fields, sizeof(current));
+  }
+  uint8_t frame[2 + WEB_FIELD_COUNT];
+  size_t len = 2;
+  uint8_t changed = 0;
+  for (int i = 0; i < WEB_FIELD_COUNT; i++) {
+    if (s.publishedValid && current[i] == s.published[i]) continue;
+    changed |= 1 << i;
+    frame[len++] = current[i];
+  }
+  if (!changed) return;
+  memcpy(s.published, current, sizeof(current));
+  s.publishedValid = true;
+  s.lastPush = nowMs();
+
+  frame[0] = WEB_FRAME_DELTA;
+  frame[1] = changed;
+  double start = nowMs();
+  int sent = 0;
+  {
+    std::lock_guard<std::mutex> g(s.clientsLock);
+    for (auto& c : s.clients) {
+      if (!c.second) continue;
+      sendFrame(s, c.first, frame, len);
+      sent++;
+    }
+  }
+  if (!sent) return;
+  double us = (nowMs() - start) * 1e3;
+  std::lock_guard<std::mutex> g(s.countersLock);
+  s.frames++;
+  s.fanoutSumUs += us;
+  s.fanoutMaxUs = std::max(s.fanoutMaxUs, us);
+}
+
+void sendSnapshots(Server& s) {
+  std::deque<int> hellos;
+  {
+    std::lock_guard<std::mutex> g(s.queueLock);
+    hellos.swap(s.hellos);
+  }
+  uint8_t frame[1 + WEB_FIELD_COUNT];
+  frame[0] = WEB_FRAME_SNAPSHOT;
+  memcpy(frame + 1, s.published, sizeof(s.published));
+  std::lock_guard<std::mutex> g(s.clientsLock);
+  for (int fd : hellos) {
+    if (s.clients.count(fd)) sendFrame(s, fd, frame, sizeof(frame));
+  }
+}
+
+// Push due? Then push; returns ms until it will be, or -1 for nothing to do
+double pushIfDue(Server& s) {
+  uint32_t version;
+  {
+    std::lock_guard<std::mutex> g(s.state.lock);
+    version = s.state.version;
+  }
+  if (s.publishedValid && version == s.publishedVersion) return -1;
+  double sinceLast = nowMs() - s.lastPush;
+  if (sinceLast < PUSH_INTERVAL_MS) return PUSH_INTERVAL_MS - sinceLast;
+  pushState(s);
+  return -1;
+}
+
+void pushThread(Server& s) {
+  pushIfDue(s);
+  while (!stopRequested) {
+    double wait = pushIfDue(s);
+    sendSnapshots(s);
+    std::unique_lock<std::mutex> g(s.wakeLock);
+    s.wake.wait_for(g, std::chrono::microseconds((long)((wait < 0 ? 100 : wait) * 1e3)),
+      [&] { return s.woken; });
+    s.woken = false;
+  }
+}
+
+void wakePush(Server& s) {
+  std::lock_guard<std::mutex> g(s.wakeLock);
+  s.woken = true;
+  s.wake.notify_one();
+}
+
+void loopThread(Server& s) {
+  double nextPass = nowMs();
+  while (!stopRequested) {
+    double wait = nextPass - nowMs();
+    if (wait > 0) std::this_thread::sleep_for(std::chrono::microseconds((long)(wait * 1e3)));
+    nextPass += PASS_MS;
+    double start = nowMs();
+
+    std::deque<std::pair<uint8_t, uint8_t> > commands;
+    {
+      std::lock_guard<std::mutex> g(s.queueLock);
+      commands.swap(s.commands);
+    }
+    bool changed = false;
+    {
+      std::lock_guard<std::mutex> g(s.state.lock);
+      for (auto& c : commands) {
+        if (c.first == WEB_OP_BRIGHTNESS && s.state.fields[WEB_FIELD_BRIGHTNESS] != c.second) {
+          s.state.fields[WEB_FIELD_BRIGHTNESS] = c.second;
+          changed = true;
+        }
+      }
+      if (changed) s.state.version++;
+    }
+    if (s.inlinePush) {
+      pushIfDue(s);
+      sendSnapshots(s);
+    } else if (changed) {
+      wakePush(s);
+    }
+
+    double us = (nowMs() - start) * 1e3;
+    std::lock_guard<std::mutex> g(s.countersLock);
+    s.passes++;
+    s.passSumUs += us;
+    s.passMaxUs = std::max(s.passMaxUs, us);
+  }
+}
+
+void report(Server& s) {
+  size_t clients;
+  {
+    std::lock_guard<std::mutex> g(s.clientsLock);
+    clients = s.clients.size();
+  }
+  std::lock_guard<std::mutex> g(s.countersLock);
+  printf("--- %zu clients, %lu frames pushed from the %s\n", clients, s.frames,
+    s.inlinePush ? "loop" : "push thread");
+  if (s.frames) {
+    printf("    fan-out: %.0f us avg, %.0f us max\n", s.fanoutSumUs / s.frames, s.fanoutMaxUs);
+  }
+  if (s.passes) {
+    printf("    loop pass: %.0f us avg, %.0f us max over %lu passes\n",
+      s.passSumUs / s.passes, s.passMaxUs, s.passes);
+  }
+  fflush(stdout);
+}
+
+// Network thread, the AsyncTCP stand-in: accepts, upgrades and queues
+void handleInput(Server& s, int fd, std::string& buf) {
+  bool upgraded;
+  {
+    std::lock_guard<std::mutex> g(s.clientsLock);
+    upgraded = s.clients[fd];
+  }
+  if (!upgraded) {
+    size_t end = buf.find("\r\n\r\n");
+    if (end == std::string::npos) return;
+    std::string head = buf.substr(0, end);
+    buf.erase(0, end + 4);
+    std::string reply =
+      "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+      "Sec-WebSocket-Accept: " + acceptKey(headerValue(head, "Sec-WebSocket-Key")) + "\r\n\r\n";
+    {
+      std::lock_guard<std::mutex> g(s.clientsLock);
+      send(fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+      s.clients[fd] = true;
+    }
+    {
+      std::lock_guard<std::mutex> g(s.queueLock);
+      s.hellos.push_back(fd);
+    }
+    wakePush(s);
+  }
+  int opcode;
+  std::string payload;
+  while (decodeFrame(buf, &opcode, &payload)) {
+    if (opcode != 2 || payload.size() != 2) continue;
+    std::lock_guard<std::mutex> g(s.queueLock);
+    s.commands.push_back(std::make_pair((uint8_t)payload[0], (uint8_t)payload[1]));
+  }
+}
+
+int serve(const sockaddr_in& addr, Server& s, double reportEveryMs) {
+  int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int one = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (listenFd < 0 || bind(listenFd, (const sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 64) < 0) {
+    fprintf(stderr, "cannot listen on port %d: %s\n", ntohs(addr.sin_port), strerror(errno));
+    return 1;
+  }
+  int epfd = epoll_create1(0);
+  epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.fd = listenFd;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, listenFd, &ev);
+
+  printf("Dimmer stand-in on port %d, %.0f us per send, pushing from the %s\n",
+    ntohs(addr.sin_port), s.sendUs, s.inlinePush ? "loop" : "push thread");
+  fflush(stdout);
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  std::thread loop(loopThread, std::ref(s));
+  std::thread push;
+  if (!s.inlinePush) push = std::thread(pushThread, std::ref(s));
+
+  std::map<int, std::string> buffers;
+  double lastReport = nowMs();
+  epoll_event events[64];
+  while (!stopRequested) {
+    int ready = epoll_wait(epfd, events, 64, 100);
+    for (int e = 0; e < ready; e++) {
+      int fd = events[e].data.fd;
+      if (fd == listenFd) {
+        int client;
+        while ((client = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+          setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          epoll_event cev = {};
+          cev.events = EPOLLIN;
+          cev.data.fd = client;
+          epoll_ctl(epfd, EPOLL_CTL_ADD, client, &cev);
+          std::lock_guard<std::mutex> g(s.clientsLock);
+          s.clients[client] = false;
+        }
+        continue;
+      }
+      char buf[4096];
+      ssize_t got;
+      bool closed = false;
+      while ((got = recv(fd, buf, sizeof(buf), 0)) > 0) buffers[fd].append(buf, (size_t)got);
+      if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) closed = true;
+      handleInput(s, fd, buffers[fd]);
+      if (closed) {
+        std::lock_guard<std::mutex> g(s.clientsLock);
+        s.clients.erase(fd);
+        buffers.erase(fd);
+        close(fd);
+      }
+    }
+    if (reportEveryMs > 0 && nowMs() - lastReport >= reportEveryMs) {
+      lastReport = nowMs();
+      report(s);
+    }
+  }
+
+  wakePush(s);
+  loop.join();
+  if (push.joinable()) push.join();
+  report(s);
+  for (auto& c : s.clients) close(c.first);
+  close(listenFd);
+  close(epfd);
+  return 0;
+}
+
+// --- Swarm ---
+
+struct Client {
+  int fd = -1;
+  std::string in;
+  bool snapshot = false;
+  int brightness = -1;
+  unsigned long frames = 0;
+};
+
+int connectClient(const sockaddr_in& addr, Client& c, std::mt19937& rng) {
+  c.fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (connect(c.fd, (const sockaddr*)&addr, sizeof(addr)) < 0) return -1;
+
+  std::string nonce;
+  for (int i = 0; i < 16; i++) nonce += (char)rng();
+  std::string key = base64(nonce);
+  char host[32];
+  snprintf(host, sizeof(host), "%s:%d", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+  std::string req = std::string("GET /ws HTTP/1.1\r\nHost: ") + host +
+    "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\n"
+    "Sec-WebSocket-Key: " + key + "\r\n\r\n";
+  send(c.fd, req.data(), req.size(), MSG_NOSIGNAL);
+
+  size_t end;
+  while ((end = c.in.find("\r\n\r\n")) == std::string::npos) {
+    char buf[1024];
+    ssize_t got = recv(c.fd, buf, sizeof(buf), 0);
+    if (got <= 0) return -1;
+    c.in.append(buf, (size_t)got);
+  }
+  std::string head = c.in.substr(0, end);
+  c.in.erase(0, end + 4);
+  if (head.compare(0, 12, "HTTP/1.1 101") != 0 || headerValue(head, "Sec-WebSocket-Accept") != acceptKey(key)) {
+    return -1;
+  }
+  return 0;
+}
+
+// Read whatever has arrived on c; returns false if the connection closed
+bool readFrames(Client& c) {
+  char buf[4096];
+  ssize_t got = recv(c.fd, buf, sizeof(buf), MSG_DONTWAIT);
+  if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) return false;
+  if (got > 0) c.in.append(buf, (size_t)got);
+  int opcode;
+  std::string p;
+  while (decodeFrame(c.in, &opcode, &p)) {
+    if (opcode != 2 || p.empty()) continue;
+    c.frames++;
+    if (p[0] == WEB_FRAME_SNAPSHOT && p.size() == 1 + WEB_FIELD_COUNT) {
+      c.snapshot = true;
+      c.brightness = (uint8_t)p[1 + WEB_FIELD_BRIGHTNESS];
+    } else if (p[0] == WEB_FRAME_DELTA && p.size() >= 2 && (p[1] & (1 << WEB_FIELD_BRIGHTNESS))) {
+      c.brightness = (uint8_t)p[2];  // Brightness is field 0, so always first
+    }
+  }
+  return true;
+}
+
+int swarm(const sockaddr_in& addr, int count, int changes, double intervalMs) {
+  std::mt19937 rng(1);
+  std::vector<Client> clients(count);
+  for (int i = 0; i < count; i++) {
+    // The snapshot can arrive with the upgrade reply
+    if (connectClient(addr, clients[i], rng) < 0 || !readFrames(clients[i])) {
+      fprintf(stderr, "client %d: WebSocket upgrade failed: %s\n", i, strerror(errno));
+      return 1;
+    }
+  }
+
+  std::vector<pollfd> fds(count);
+  auto pump = [&](double untilMs) {
+    for (;;) {
+      double left = untilMs - nowMs();
+      if (left <= 0) return true;
+      for (int i = 0; i < count; i++) fds[i] = {clients[i].fd, POLLIN, 0};
+      poll(fds.data(), fds.size(), (int)left + 1);
+      for (int i = 0; i < count; i++) {
+        if ((fds[i].revents & (POLLIN | POLLHUP)) && !readFrames(clients[i])) {
+          fprintf(stderr, "client %d: connection closed\n", i);
+          return false;
+        }
+      }
+    }
+  };
+  if (!pump(nowMs() + 500)) return 1;
+  int snapshots = 0;
+  for (const Client& c : clients) snapshots += c.snapshot ? 1 : 0;
+
+  printf("%d clients, %d of them got a snapshot, %d brightness changes every %.0f ms\n",
+    count, snapshots, changes, intervalMs);
+  std::vector<double> latencies;
+  unsigned long missed = 0;
+  for (int n = 0; n < changes; n++) {
+    int value = 30 + (n % 2 ? 40 : 0) + n % 10;
+    uint8_t cmd[2] = {WEB_OP_BRIGHTNESS, (uint8_t)value};
+    std::string f = encodeFrame(cmd, sizeof(cmd), true);
+    double sentAt = nowMs();
+    send(clients[0].fd, f.data(), f.size(), MSG_NOSIGNAL);
+
+    std::vector<bool> seen(count, false);
+    double deadline = sentAt + intervalMs;
+    for (;;) {
+      for (int i = 0; i < count; i++) fds[i] = {clients[i].fd, POLLIN, 0};
+      double left = deadline - nowMs();
+      if (left <= 0) break;
+      poll(fds.data(), fds.size(), (int)left + 1);
+      double t = nowMs();
+      for (int i = 0; i < count; i++) {
+        if (!(fds[i].revents & (POLLIN | POLLHUP))) continue;
+        if (!readFrames(clients[i])) {
+          fprintf(stderr, "client %d: connection closed\n", i);
+          return 1;
+        }
+        if (!seen[i] && clients[i].brightness == value) {
+          seen[i] = true;
+          latencies.push_back(t - sentAt);
+        }
+      }
+    }
+    for (int i = 0; i < count; i++) missed += seen[i] ? 0 : 1;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  if (!latencies.empty()) {
+    double sum = 0;
+    for (double l : latencies) sum += l;
+    printf("command to delta at each client: %.1f ms avg, %.1f ms p50, %.1f ms p99, %.1f ms max\n",
+      sum / latencies.size(), latencies[latencies.size() / 2],
+      latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)], latencies.back());
+  }
+  unsigned long frames = 0;
+  for (const Client& c : clients) frames += c.frames;
+  printf("%lu frames received, %lu client-changes missed\n", frames, missed);
+  for (Client& c : clients) close(c.fd);
+  return snapshots == count && missed == 0 ? 0 : 1;
+}
+
+void usage(const char* argv0) {
+  fprintf(stderr,
+    "usage: %s [--addr 127.0.0.1] [--port 80] [--clients 10] [--changes 100] [--interval-ms 100]\n"
+    "       %s --serve [--addr 127.0.0.1] [--port 8080] [--send-us 200] [--inline] [--report-s 10]\n",
+    argv0, argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* addrText = "127.0.0.1";
+  int port = -1;
+  int clients = 10, changes = 100;
+  double intervalMs = 100, reportEveryMs = 10000;
+  bool serveMode = false;
+  Server server;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (strcmp(arg, "--addr") == 0 && hasValue) addrText = argv[++i];
+    else if (strcmp(arg, "--port") == 0 && hasValue) port = atoi(argv[++i]);
+    else if (strcmp(arg, "--clients") == 0 && hasValue) clients = atoi(argv[++i]);
+    else if (strcmp(arg, "--changes") == 0 && hasValue) changes = atoi(argv[++i]);
+    else if (strcmp(arg, "--interval-ms") == 0 && hasValue) intervalMs = atof(argv[++i]);
+    else if (strcmp(arg, "--serve") == 0) serveMode = true;
+    else if (strcmp(arg, "--send-us") == 0 && hasValue) server.sendUs = atof(argv[++i]);
+    else if (strcmp(arg, "--inline") == 0) server.inlinePush = true;
+    else if (strcmp(arg, "--report-s") == 0 && hasValue) reportEveryMs = atof(argv[++i]) * 1e3;
+    else { usage(argv[0]); return 2; }
+  }
+  if (port < 0) port = serveMode ? 8080 : 80;
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  if (inet_pton(AF_INET, addrText, &addr.sin_addr) != 1 || clients < 1) {
+    usage(argv[0]);
+    return 2;
+  }
+  return serveMode ? serve(addr, server, reportEveryMs) : swarm(addr, clients, changes, intervalMs);
+}